@@ -88,6 +88,9 @@ bcmsdh_attach(osl_t *osh, void *sdioh, ulong *regsva)
 	/* Report the BAR, to fix if needed */
 	bcmsdh->sbwad = SI_ENUM_BASE;
 
+	/* Batched register reads fall back to one access per register without it */
+	bcmsdh->regbuf = (uint32 *)MALLOC(osh, BCMSDH_REGBATCH_MAX);
+
 	/* save the handler locally */
 	l_bcmsdh = bcmsdh;
 
@@ -100,6 +103,8 @@ bcmsdh_detach(osl_t *osh, void *sdh)
 	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
 
 	if (bcmsdh != NULL) {
+		if (bcmsdh->regbuf)
+			MFREE(osh, bcmsdh->regbuf, BCMSDH_REGBATCH_MAX);
 		MFREE(osh, bcmsdh, sizeof(bcmsdh_info_t));
 	}
 
@@ -462,6 +467,65 @@ bcmsdh_reg_write(void *sdh, uint32 addr, uint size, uint32 data)
 	return 0xFFFFFFFF;
 }
 
+int
+bcmsdh_reg_read_batch(void *sdh, uint32 base, const uint16 *offs, uint32 *vals, uint n)
+{
+	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
+	SDIOH_API_RC status;
+	uint32 addr;
+	uint lo, hi, i;
+	int err;
+
+	if (!bcmsdh)
+		bcmsdh = l_bcmsdh;
+
+	ASSERT(bcmsdh->init_success);
+	ASSERT(n > 0);
+
+	lo = hi = offs[0];
+	for (i = 1; i < n; i++) {
+		lo = MIN(lo, offs[i]);
+		hi = MAX(hi, offs[i]);
+	}
+	addr = base + lo;
+
+	/* Too far apart for one transfer: read them one at a time */
+	if (!bcmsdh->regbuf || (hi + 4 - lo > BCMSDH_REGBATCH_MAX) ||
+	    ((addr & ~SBSDIO_SB_OFT_ADDR_MASK) != ((base + hi) & ~SBSDIO_SB_OFT_ADDR_MASK))) {
+		for (i = 0; i < n; i++) {
+			vals[i] = bcmsdh_reg_read(bcmsdh, base + offs[i], 4);
+			if (bcmsdh->regfail)
+				return BCME_SDIO_ERROR;
+		}
+		return 0;
+	}
+
+	BCMSDH_INFO(("%s:fun = 1, addr = 0x%x, len = %d\n", __FUNCTION__, addr, hi + 4 - lo));
+
+	if ((err = bcmsdhsdio_set_sbaddr_window(bcmsdh, addr, FALSE))) {
+		bcmsdh->regfail = TRUE;
+		return err;
+	}
+
+	addr &= SBSDIO_SB_OFT_ADDR_MASK;
+	addr |= SBSDIO_SB_ACCESS_2_4B_FLAG;
+
+	status = sdioh_request_buffer(bcmsdh->sdioh, SDIOH_DATA_PIO, SDIOH_DATA_INC,
+	                              SDIOH_READ, SDIO_FUNC_1, addr, 4, hi + 4 - lo,
+	                              (uint8 *)bcmsdh->regbuf, NULL);
+	bcmsdh->regfail = !(SDIOH_API_SUCCESS(status));
+	if (bcmsdh->regfail) {
+		BCMSDH_ERROR(("%s: error reading addr 0x%04x len %d\n",
+		              __FUNCTION__, addr, hi + 4 - lo));
+		return BCME_SDIO_ERROR;
+	}
+
+	for (i = 0; i < n; i++)
+		vals[i] = ltoh32(bcmsdh->regbuf[(offs[i] - lo) / 4]);
+
+	return 0;
+}
+
 bool
 bcmsdh_regfail(void *sdh)
 {
@@ -485,10 +549,12 @@ bcmsdh_recv_buf(void *sdh, uint32 addr, uint fn, uint flags,
 	BCMSDH_INFO(("%s:fun = %d, addr = 0x%x, size = %d\n",
 	             __FUNCTION__, fn, addr, nbytes));
 
+#ifndef BCMSDIOH_ASYNC
 	/* Async not implemented yet */
 	ASSERT(!(flags & SDIO_REQ_ASYNC));
 	if (flags & SDIO_REQ_ASYNC)
 		return BCME_UNSUPPORTED;
+#endif /* !BCMSDIOH_ASYNC */
 
 	if ((err = bcmsdhsdio_set_sbaddr_window(bcmsdh, addr, FALSE)))
 		return err;
@@ -500,6 +566,17 @@ bcmsdh_recv_buf(void *sdh, uint32 addr, uint fn, uint flags,
 	if (width == 4)
 		addr |= SBSDIO_SB_ACCESS_2_4B_FLAG;
 
+#ifdef BCMSDIOH_ASYNC
+	if (flags & SDIO_REQ_ASYNC) {
+		ASSERT(pkt);
+		status = sdioh_request_packet_async(bcmsdh->sdioh, incr_fix, SDIOH_READ, fn, addr,
+		                                    pkt, complete_fn, handle);
+		if (status == SDIOH_API_RC_UNSUPPORTED)
+			return BCME_UNSUPPORTED;
+		return (SDIOH_API_SUCCESS(status) ? BCME_PENDING : BCME_SDIO_ERROR);
+	}
+#endif /* BCMSDIOH_ASYNC */
+
 	status = sdioh_request_buffer(bcmsdh->sdioh, SDIOH_DATA_PIO, incr_fix,
 	                              SDIOH_READ, fn, addr, width, nbytes, buf, pkt);
 
@@ -523,10 +600,12 @@ bcmsdh_send_buf(void *sdh, uint32 addr, uint fn, uint flags,
 	BCMSDH_INFO(("%s:fun = %d, addr = 0x%x, size = %d\n",
 	            __FUNCTION__, fn, addr, nbytes));
 
+#ifndef BCMSDIOH_ASYNC
 	/* Async not implemented yet */
 	ASSERT(!(flags & SDIO_REQ_ASYNC));
 	if (flags & SDIO_REQ_ASYNC)
 		return BCME_UNSUPPORTED;
+#endif /* !BCMSDIOH_ASYNC */
 
 	if ((err = bcmsdhsdio_set_sbaddr_window(bcmsdh, addr, FALSE)))
 		return err;
@@ -538,12 +617,46 @@ bcmsdh_send_buf(void *sdh, uint32 addr, uint fn, uint flags,
 	if (width == 4)
 		addr |= SBSDIO_SB_ACCESS_2_4B_FLAG;
 
+#ifdef BCMSDIOH_ASYNC
+	if (flags & SDIO_REQ_ASYNC) {
+		ASSERT(pkt);
+		status = sdioh_request_packet_async(bcmsdh->sdioh, incr_fix, SDIOH_WRITE, fn, addr,
+		                                    pkt, complete_fn, handle);
+		if (status == SDIOH_API_RC_UNSUPPORTED)
+			return BCME_UNSUPPORTED;
+		return (SDIOH_API_SUCCESS(status) ? BCME_PENDING : BCME_ERROR);
+	}
+#endif /* BCMSDIOH_ASYNC */
+
 	status = sdioh_request_buffer(bcmsdh->sdioh, SDIOH_DATA_PIO, incr_fix,
 	                              SDIOH_WRITE, fn, addr, width, nbytes, buf, pkt);
 
 	return (SDIOH_API_SUCCESS(status) ? 0 : BCME_ERROR);
 }
 
+#ifdef BCMSDIOH_ASYNC
+int
+bcmsdh_async_flush(void *sdh)
+{
+	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
+	SDIOH_API_RC status;
+
+	ASSERT(bcmsdh);
+
+	status = sdioh_request_async_flush(bcmsdh->sdioh);
+	return (SDIOH_API_SUCCESS(status) ? 0 : BCME_ERROR);
+}
+
+void
+bcmsdh_async_dump(void *sdh, struct bcmstrbuf *strbuf)
+{
+	bcmsdh_info_t *bcmsdh = (bcmsdh_info_t *)sdh;
+
+	ASSERT(bcmsdh);
+	sdioh_async_dump(bcmsdh->sdioh, strbuf);
+}
+#endif /* BCMSDIOH_ASYNC */
+
 int
 bcmsdh_rwdata(void *sdh, uint rw, uint32 addr, uint8 *buf, uint nbytes)
 {
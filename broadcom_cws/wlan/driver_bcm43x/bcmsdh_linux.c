@@ -441,6 +441,11 @@ module_param(sd_hiok, uint, 0);
 extern uint sd_f2_blocksize;
 module_param(sd_f2_blocksize, int, 0);
 
+#if defined(BCMSDIOH_ASYNC) && !defined(BCMSDIOH_STD)
+extern uint sd_async;	/* Host sets up the mmc context, pipelined cmd53 is ok */
+module_param(sd_async, uint, 0);
+#endif
+
 #ifdef BCMSDIOH_STD
 extern int sd_uhsimode;
 module_param(sd_uhsimode, int, 0);
@@ -60,6 +60,11 @@ static void IRQHandlerF2(struct sdio_func *func);
 #endif /* !defined(OOB_INTR_ONLY) */
 static int sdioh_sdmmc_get_cisaddr(sdioh_info_t *sd, uint32 regaddr);
 extern int sdio_reset_comm(struct mmc_card *card);
+#ifdef SDIOH_SDMMC_ASYNC
+static void sdioh_async_drain(sdioh_info_t *sd);
+#else
+#define sdioh_async_drain(sd)
+#endif /* SDIOH_SDMMC_ASYNC */
 
 #define DEFAULT_SDIO_F2_BLKSIZE		512
 #ifndef CUSTOM_SDIO_F2_BLKSIZE
@@ -77,6 +82,9 @@ uint sd_clock = 1;		/* Default to SD Clock turned ON */
 uint sd_hiok = FALSE;	/* Don't use hi-speed mode by default */
 uint sd_msglevel = 0x01;
 uint sd_use_dma = TRUE;
+#ifdef BCMSDIOH_ASYNC
+uint sd_async = FALSE;
+#endif /* BCMSDIOH_ASYNC */
 
 #ifndef CUSTOM_RXCHAIN
 #define CUSTOM_RXCHAIN 0
@@ -170,6 +178,13 @@ sdioh_attach(osl_t *osh, struct sdio_func *func)
 		sd_err(("%s: func 1 or 2 is null \n", __FUNCTION__));
 		goto fail;
 	}
+#ifdef SDIOH_SDMMC_ASYNC
+	/* mmc_start_req() waits on the host context, which the mmc core only sets
+	 * up for block queues. The platform says so with sd_async when its host
+	 * driver does it for SDIO cards too.
+	 */
+	sd->async_ok = (sd_async != 0);
+#endif /* SDIOH_SDMMC_ASYNC */
 	sdio_set_drvdata(sd->func[1], sd);
 
 	sdio_claim_host(sd->func[1]);
@@ -209,6 +224,8 @@ sdioh_detach(osl_t *osh, sdioh_info_t *sd)
 
 	if (sd) {
 
+		sdioh_async_drain(sd);
+
 		/* Disable Function 2 */
 		if (sd->func[2]) {
 			sdio_claim_host(sd->func[2]);
@@ -791,6 +808,7 @@ sdioh_request_byte(sdioh_info_t *sd, uint rw, uint func, uint regaddr, uint8 *by
 
 	DHD_PM_RESUME_WAIT(sdioh_request_byte_wait);
 	DHD_PM_RESUME_RETURN_ERROR(SDIOH_API_RC_FAIL);
+	sdioh_async_drain(sd);
 	if(rw) { /* CMD52 Write */
 		if (func == 0) {
 			/* Can only directly write to some F0 registers.  Handle F2 enable
@@ -893,6 +911,7 @@ sdioh_request_word(sdioh_info_t *sd, uint cmd_type, uint rw, uint func, uint add
 		sd_err(("%s: Only CMD52 allowed to F0.\n", __FUNCTION__));
 		return SDIOH_API_RC_FAIL;
 	}
+	sdioh_async_drain(sd);
 
 	sd_info(("%s: cmd_type=%d, rw=%d, func=%d, addr=0x%05x, nbytes=%d\n",
 	         __FUNCTION__, cmd_type, rw, func, addr, nbytes));
@@ -1075,6 +1094,249 @@ sdioh_request_packet_chain(sdioh_info_t *sd, uint fix_inc, uint write, uint func
 	return SDIOH_API_RC_SUCCESS;
 }
 
+#ifdef BCMSDIOH_ASYNC
+#ifdef SDIOH_SDMMC_ASYNC
+static int
+sdioh_async_err_check(struct mmc_card *card, struct mmc_async_req *areq)
+{
+	sdioh_async_req_t *req = container_of(areq, sdioh_async_req_t, areq);
+
+	if (req->cmd.error)
+		return MMC_BLK_CMD_ERR;
+	if (req->dat.error)
+		return MMC_BLK_DATA_ERR;
+	return MMC_BLK_SUCCESS;
+}
+
+static void
+sdioh_async_complete(sdioh_info_t *sd, struct mmc_async_req *areq, int err)
+{
+	sdioh_async_req_t *req = container_of(areq, sdioh_async_req_t, areq);
+
+	ASSERT(sd->async_inflight[req->rw] > 0);
+	sd->async_inflight[req->rw]--;
+	sd->async_cmplt[req->rw]++;
+	if (err) {
+		sd->async_errs[req->rw]++;
+		sd_err(("%s: CMD53 %s failed, cmd err %d data err %d\n", __FUNCTION__,
+			req->rw ? "write" : "read", req->cmd.error, req->dat.error));
+		if (!sd->async_chain_err)
+			sd->async_chain_err = err;
+	}
+
+	/* the chain fails if any of its cmd53s did */
+	if (req->cmplt_fn) {
+		err = sd->async_chain_err;
+		sd->async_chain_err = 0;
+		req->cmplt_fn(req->cmplt_arg, err ? BCME_SDIO_ERROR : BCME_OK, FALSE);
+	}
+}
+
+/* Start areq (NULL to only wait) after completing the request currently on the bus.
+ * Host must be claimed. Returns non-zero if either the previous request failed or
+ * areq could not be started.
+ */
+static int
+sdioh_async_start(sdioh_info_t *sd, struct mmc_async_req *areq)
+{
+	struct mmc_host *host = sd->func[1]->card->host;
+	struct mmc_async_req *done;
+	int err = 0;
+
+	if (areq) {
+		sdioh_async_req_t *req = container_of(areq, sdioh_async_req_t, areq);
+
+		sd->async_depth[req->rw][MIN(sd->async_inflight[req->rw],
+			SDIOH_ASYNC_DEPTH - 1)]++;
+		sd->async_inflight[req->rw]++;
+	}
+
+	done = mmc_start_req(host, areq, &err);
+	if (done)
+		sdioh_async_complete(sd, done, err);
+
+	/* the new request is not started when the previous one failed */
+	if (err && areq)
+		sd->async_inflight[container_of(areq, sdioh_async_req_t, areq)->rw]--;
+
+	return err;
+}
+
+static void
+sdioh_async_drain(sdioh_info_t *sd)
+{
+	if (!sd->async_claimed)
+		return;
+
+	sdioh_async_start(sd, NULL);
+	sdio_release_host(sd->func[1]);
+	sd->async_claimed = FALSE;
+}
+#endif /* SDIOH_SDMMC_ASYNC */
+
+/* Same scatter-gather layout as sdioh_request_packet_chain, but each cmd53 is
+ * handed to the host controller while the previous one is still on the bus.
+ * The request slots are used in turn, so at most SDIOH_ASYNC_DEPTH cmd53s are
+ * owned by this layer at any time.
+ */
+extern SDIOH_API_RC
+sdioh_request_packet_async(sdioh_info_t *sd, uint fix_inc, uint write, uint func,
+	uint32 addr, void *pkt, sdioh_async_cmplt_fn_t cmplt_fn, void *handle)
+{
+#ifdef SDIOH_SDMMC_ASYNC
+	bool fifo = (fix_inc == SDIOH_DATA_FIX);
+	void *pnext;
+	uint ttl_len, pkt_offset;
+	uint blk_size;
+	uint max_blk_count;
+	uint max_req_size;
+	uint32 sg_count;
+	struct sdio_func *sdio_func = sd->func[func];
+	struct mmc_host *host = sdio_func->card->host;
+	sdioh_async_req_t *req;
+
+	sd_trace(("%s: Enter\n", __FUNCTION__));
+	ASSERT(pkt);
+	if (!sd->async_ok)
+		return SDIOH_API_RC_UNSUPPORTED;
+	DHD_PM_RESUME_WAIT(sdioh_request_packet_wait);
+	DHD_PM_RESUME_RETURN_ERROR(SDIOH_API_RC_FAIL);
+
+	blk_size = sd->client_block_size[func];
+	max_blk_count = min(host->max_blk_count, (uint)MAX_IO_RW_EXTENDED_BLK);
+	max_req_size = min(max_blk_count * blk_size, host->max_req_size);
+
+	if (!sd->async_claimed) {
+		sdio_claim_host(sd->func[1]);
+		sd->async_claimed = TRUE;
+	}
+
+	pkt_offset = 0;
+	pnext = pkt;
+
+	while (pnext != NULL) {
+		req = &sd->async_req[sd->async_slot];
+		ttl_len = 0;
+		sg_count = 0;
+		memset(&req->mrq, 0, sizeof(struct mmc_request));
+		memset(&req->cmd, 0, sizeof(struct mmc_command));
+		memset(&req->dat, 0, sizeof(struct mmc_data));
+		sg_init_table(req->sg_list, ARRAYSIZE(req->sg_list));
+
+		while (pnext != NULL && ttl_len < max_req_size) {
+			int pkt_len;
+			int sg_data_size;
+			uint8 *pdata = (uint8*)PKTDATA(sd->osh, pnext);
+
+			ASSERT(pdata != NULL);
+			pkt_len = PKTLEN(sd->osh, pnext);
+			if (sg_count >= ARRAYSIZE(req->sg_list)) {
+				sd_err(("%s: sg list entries exceed limit\n", __FUNCTION__));
+				goto fail;
+			}
+			pdata += pkt_offset;
+
+			sg_data_size = pkt_len - pkt_offset;
+			if (sg_data_size > max_req_size - ttl_len)
+				sg_data_size = max_req_size - ttl_len;
+			if (sg_data_size > host->max_seg_size)
+				sg_data_size = host->max_seg_size;
+			sg_set_buf(&req->sg_list[sg_count++], pdata, sg_data_size);
+
+			ttl_len += sg_data_size;
+			pkt_offset += sg_data_size;
+			if (pkt_offset == pkt_len) {
+				pnext = PKTNEXT(sd->osh, pnext);
+				pkt_offset = 0;
+			}
+		}
+
+		req->dat.sg = req->sg_list;
+		req->dat.sg_len = sg_count;
+		req->dat.flags = write ? MMC_DATA_WRITE : MMC_DATA_READ;
+		req->cmd.opcode = 53; /* SD_IO_RW_EXTENDED */
+		req->cmd.arg = write ? 1<<31 : 0;
+		req->cmd.arg |= (func & 0x7) << 28;
+		req->cmd.arg |= fifo ? 0 : 1<<26;
+		req->cmd.arg |= (addr & 0x1FFFF) << 9;
+		if (ttl_len % blk_size == 0) {
+			req->dat.blksz = blk_size;
+			req->dat.blocks = ttl_len / blk_size;
+			req->cmd.arg |= 1<<27;
+			req->cmd.arg |= req->dat.blocks & 0x1FF;
+		} else if (ttl_len < blk_size) {
+			/* short single frame, byte mode */
+			req->dat.blksz = ttl_len;
+			req->dat.blocks = 1;
+			req->cmd.arg |= ttl_len & 0x1FF;
+		} else {
+			sd_err(("%s, data length %d not aligned to block size %d\n",
+				__FUNCTION__,  ttl_len, blk_size));
+			goto fail;
+		}
+		req->cmd.flags = MMC_RSP_SPI_R5 | MMC_RSP_R5 | MMC_CMD_ADTC;
+		req->mrq.cmd = &req->cmd;
+		req->mrq.data = &req->dat;
+		req->areq.mrq = &req->mrq;
+		req->areq.err_check = sdioh_async_err_check;
+		req->rw = write;
+		req->cmplt_fn = (pnext == NULL) ? cmplt_fn : NULL;
+		req->cmplt_arg = handle;
+		mmc_set_data_timeout(&req->dat, sdio_func->card);
+		if (!fifo)
+			addr += ttl_len;
+
+		if (sdioh_async_start(sd, &req->areq))
+			goto fail;
+		sd->async_slot = (sd->async_slot + 1) % SDIOH_ASYNC_DEPTH;
+	}
+
+	sd_trace(("%s: Exit\n", __FUNCTION__));
+	return SDIOH_API_RC_SUCCESS;
+
+fail:
+	/* anything already queued for this chain completes without a callback,
+	 * the caller gets the failure here
+	 */
+	sdioh_async_drain(sd);
+	sd->async_chain_err = 0;
+	return SDIOH_API_RC_FAIL;
+#else
+	return SDIOH_API_RC_UNSUPPORTED;
+#endif /* SDIOH_SDMMC_ASYNC */
+}
+
+extern SDIOH_API_RC
+sdioh_request_async_flush(sdioh_info_t *sd)
+{
+	sdioh_async_drain(sd);
+	return SDIOH_API_RC_SUCCESS;
+}
+
+extern void
+sdioh_async_dump(sdioh_info_t *sd, struct bcmstrbuf *strbuf)
+{
+#ifdef SDIOH_SDMMC_ASYNC
+	uint rw, i;
+
+	if (!sd->async_ok) {
+		bcm_bprintf(strbuf, "async cmd53 off, set sd_async if the host supports it\n");
+		return;
+	}
+	for (rw = SDIOH_READ; rw <= SDIOH_WRITE; rw++) {
+		bcm_bprintf(strbuf, "async %s: cmplt %u errs %u inflight %u depth",
+			rw ? "tx" : "rx", sd->async_cmplt[rw], sd->async_errs[rw],
+			sd->async_inflight[rw]);
+		for (i = 0; i < SDIOH_ASYNC_DEPTH; i++)
+			bcm_bprintf(strbuf, " %u", sd->async_depth[rw][i]);
+		bcm_bprintf(strbuf, "\n");
+	}
+#else
+	bcm_bprintf(strbuf, "async cmd53 not supported by this kernel\n");
+#endif /* SDIOH_SDMMC_ASYNC */
+}
+#endif /* BCMSDIOH_ASYNC */
+
 static SDIOH_API_RC
 sdioh_buffer_tofrom_bus(sdioh_info_t *sd, uint fix_inc, uint write, uint func,
                      uint addr, uint8 *buf, uint len)
@@ -1140,6 +1402,7 @@ sdioh_request_buffer(sdioh_info_t *sd, uint pio_dma, uint fix_inc, uint write, u
 	sd_trace(("%s: Enter\n", __FUNCTION__));
 	DHD_PM_RESUME_WAIT(sdioh_request_buffer_wait);
 	DHD_PM_RESUME_RETURN_ERROR(SDIOH_API_RC_FAIL);
+	sdioh_async_drain(sd);
 
 	if (pkt) {
 		/* packet chain, only used for tx/rx glom, all packets length
@@ -1395,6 +1658,8 @@ sdioh_start(sdioh_info_t *sd, int stage)
 int
 sdioh_stop(sdioh_info_t *sd)
 {
+	sdioh_async_drain(sd);
+
 	/* MSM7201A Android sdio stack has bug with interrupt
 		So internaly within SDIO stack they are polling
 		which cause issue when device is turned off. So
@@ -2225,6 +2225,17 @@ bcm_bitcount(uint8 *bitmap, uint length)
 	return bitcount;
 }
 
+/* log2 histogram bin of val: bin 0 < 2, bin i < 2^(i+1), the last one open ended */
+uint
+bcm_log2_bin(uint32 val, uint nbins)
+{
+	uint bin;
+
+	for (bin = 0; (val >>= 1) && (bin < nbins - 1); bin++)
+		;
+	return bin;
+}
+
 #ifdef BCMDRIVER
 
 /* Initialization of bcmstrbuf structure */
@@ -2278,6 +2289,18 @@ bcm_bprhex(struct bcmstrbuf *b, const char *msg, bool newline, uint8 *buf, int l
 		bcm_bprintf(b, "\n");
 }
 
+/* Histogram counts, " %u" each, up to the last non-empty bin */
+void
+bcm_bprhist(struct bcmstrbuf *b, const uint32 *bins, uint nbins)
+{
+	uint i, last;
+
+	for (last = nbins; last > 0 && !bins[last - 1]; last--)
+		;
+	for (i = 0; i < last; i++)
+		bcm_bprintf(b, " %u", bins[i]);
+}
+
 void
 bcm_inc_bytes(uchar *num, int num_bytes, uint8 amount)
 {
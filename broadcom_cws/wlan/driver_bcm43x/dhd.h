@@ -48,6 +48,15 @@
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 27)) && defined(CONFIG_HAS_WAKELOCK)
 #include <linux/wakelock.h>
 #endif /* (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 27)) && defined (CONFIG_HAS_WAKELOCK) */
+#if defined(DHD_NAPI) && (LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 29))
+#undef DHD_NAPI		/* needs napi_gro_receive */
+#endif
+#if defined(DHD_TXSTAGE) && (LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 36))
+#undef DHD_TXSTAGE	/* needs get_cpu_ptr */
+#endif
+#if defined(DHD_TXMQ) && (LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 31))
+#undef DHD_TXMQ		/* needs ndo_select_queue */
+#endif
 /* The kernel threading is sdio-specific */
 struct task_struct;
 struct sched_param;
@@ -173,6 +182,84 @@ typedef struct reorder_info {
 #define TCPACK_SUP_DELAYTX	2
 #endif /* DHDTCPACK_SUPPRESS */
 
+/* Settings sent during bring-up without waiting for each response, see
+ * dhd_iov_batch_add(). Entries stay busy until the dongle answers; a gen
+ * bump makes answers from an abandoned batch harmless.
+ */
+#define DHD_IOV_BATCH_MAX	8
+typedef struct dhd_iov_batch_ent {
+	const char *name;	/* for error reports, must be a string literal */
+	uint16 gen;
+	bool busy;
+} dhd_iov_batch_ent_t;
+
+typedef struct dhd_iov_batch {
+	dhd_iov_batch_ent_t ent[DHD_IOV_BATCH_MAX];
+	uint16 gen;
+	uint inflight;		/* sent and not answered yet */
+	uint kick;		/* wake condition, set by every answer */
+	uint queued;		/* sent without waiting since dhd_iov_batch_begin */
+	int err;		/* first error the dongle reported since the last flush */
+} dhd_iov_batch_t;
+
+/* Per event type counters kept by wl_host_event. dpc_* is the time spent in
+ * wl_host_event itself, bin[] is the time from rx to the end of the cfg80211
+ * handler in log2 us buckets: bin[0] < 2us, bin[i] < 2^(i+1) us, last open ended.
+ */
+#define DHD_EVT_NBINS	20
+typedef struct dhd_evt_stat {
+	uint32 cnt;		/* events received */
+	uint32 dpc_us;		/* total time in wl_host_event */
+	uint32 dpc_max_us;
+	uint32 done;		/* events the cfg80211 handler finished */
+	uint32 max_us;		/* longest rx to handler completion */
+	uint32 bin[DHD_EVT_NBINS];
+} dhd_evt_stat_t;
+
+/* Data path latency stages. Every dhd_lat_sample'th frame carries a
+ * dhd_lat_tag_t through the driver; each stage is the time between two
+ * of its stamps, kept in log2 us buckets like dhd_evt_stat_t. The "latstats"
+ * iovar reads them; the debugfs "latency" file exists only with DHD_DBG_LAT.
+ */
+enum {
+	DHD_LAT_TX_HOST,	/* dhd_start_xmit to bus: header push, wlfc queues */
+	DHD_LAT_TX_QUEUE,	/* wait in the bus txq */
+	DHD_LAT_TX_GLOM,	/* dequeue to CMD53: padding, glom chain */
+	DHD_LAT_TX_CMD53,	/* CMD53 issue to completion */
+	DHD_LAT_TX_TOTAL,
+	DHD_LAT_RX_DPC,		/* ISR to DPC, every interrupt */
+	DHD_LAT_RX_READ,	/* DPC, or previous delivery, to frame read */
+	DHD_LAT_RX_PROC,	/* dhd_rx_frame up to the stack or rx queue */
+	DHD_LAT_RX_QUEUE,	/* wait in the rxf ring or NAPI queue */
+	DHD_LAT_RX_STACK,	/* netif_rx/napi_gro_receive */
+	DHD_LAT_RX_TOTAL,	/* ISR to stack done */
+	DHD_LAT_MAX
+};
+
+#define DHD_LAT_NBINS	20
+typedef struct dhd_lat_stat {
+	uint32 cnt;
+	uint32 max_us;
+	uint32 bin[DHD_LAT_NBINS];
+} dhd_lat_stat_t;
+
+/* Trace stamps, kept in the packet tag past the space dhd_pkttag_t uses */
+typedef struct dhd_lat_tag {
+	uint32 t0;		/* driver entry (tx) or ISR (rx), us; 0 if not traced */
+	uint32 ts;		/* end of the previous stage */
+} dhd_lat_tag_t;
+
+#define DHD_LAT_TAG_OFFSET	40
+#define DHD_LAT_TAG(pkt)	((dhd_lat_tag_t *)((uint8 *)PKTTAG(pkt) + DHD_LAT_TAG_OFFSET))
+#define DHD_LAT_STAMP(dhdp, pkt, stage) do { \
+	if (DHD_LAT_TAG(pkt)->t0) \
+		dhd_lat_stamp((dhdp), DHD_LAT_TAG(pkt), (stage)); \
+} while (0)
+#define DHD_LAT_DONE(dhdp, pkt, stage, total) do { \
+	if (DHD_LAT_TAG(pkt)->t0) \
+		dhd_lat_done((dhdp), DHD_LAT_TAG(pkt), (stage), (total)); \
+} while (0)
+
 /* Common structure for module and instance linkage */
 typedef struct dhd_pub {
 	/* Linkage ponters */
@@ -192,6 +279,8 @@ typedef struct dhd_pub {
 	bool dongle_reset;  /* TRUE = DEVRESET put dongle into reset */
 	enum dhd_bus_state busstate;
 	uint hdrlen;		/* Total DHD header length (proto + bus) */
+	uint tx_headroom;	/* Tx headroom the bus may use beyond hdrlen */
+	uint tx_tailroom;	/* Tx tailroom the bus pads into */
 	uint maxctl;		/* Max size rxctl request from proto to bus */
 	uint rxsz;		/* Rx buffer size bus module should use */
 	uint8 wme_dp;	/* wme discard priority */
@@ -309,9 +398,33 @@ typedef struct dhd_pub {
 	struct reorder_info *reorder_bufs[WLHOST_REORDERDATA_MAXFLOWS];
 	char  fw_capabilities[WLC_IOCTL_SMLEN];
 	#define MAXSKBPEND 1024
-	void *skbbuf[MAXSKBPEND];
-	uint32 store_idx;
-	uint32 sent_idx;
+	void *skbbuf[MAXSKBPEND];	/* rxf ring, DPC produces, rxf thread consumes */
+	uint32 store_idx;		/* Written by the producer only */
+	uint32 sent_idx;		/* Written by the consumer only */
+	void *rxf_pend;			/* Chains held back while the ring is full */
+	void *rxf_pend_tail;
+	uint32 rxf_pend_cnt;		/* Number of chains in rxf_pend */
+	uint32 rxf_hiwat;		/* Ring occupancy high-water mark */
+	uint32 rxf_stalls;		/* Chains that found the ring full */
+	uint32 rxf_wakeups;		/* rxf thread wakeups */
+	uint32 rxf_drops;		/* Chains dropped, backlog overflow */
+#ifdef DHD_NAPI
+	uint32 rx_napi_polls;		/* NAPI poll calls */
+	uint32 rx_napi_pkts;		/* Frames handed to GRO */
+	uint32 rx_napi_budget_out;	/* Polls that ran out of budget */
+	uint32 rx_napi_hiwat;		/* NAPI queue high-water mark */
+#endif /* DHD_NAPI */
+#ifdef DHD_TXQ_LOCKSTAT
+	uint32 txq_lock_cnt;		/* txq lock acquisitions */
+	uint32 txq_lock_contended;	/* Acquisitions that found the lock held */
+	uint32 txq_lock_hold_max;	/* Longest hold, ns */
+	uint64 txq_lock_hold_ns;	/* Total hold time, ns */
+#endif /* DHD_TXQ_LOCKSTAT */
+#ifdef DHD_TXSTAGE
+	uint32 txstage_pulls;		/* Non-empty staging pulls */
+	uint32 txstage_pkts;		/* Frames moved from staging to the bus */
+	uint32 txstage_hiwat;		/* Most frames moved in one pull */
+#endif /* DHD_TXSTAGE */
 #ifdef DHDTCPACK_SUPPRESS
 	uint8 tcpack_sup_mode;		/* TCPACK suppress mode */
 	void *tcpack_sup_module;	/* TCPACK suppress module */
@@ -319,6 +432,12 @@ typedef struct dhd_pub {
 #if defined(ARP_OFFLOAD_SUPPORT)
 	uint32 arp_version;
 #endif
+	dhd_iov_batch_t iov_batch;	/* used by dhd_preinit_ioctls */
+	uint32 preinit_ms;		/* Duration of the last dhd_preinit_ioctls */
+	uint32 evt_rx_us;		/* rx time of the event being dispatched, 0 if none */
+	dhd_evt_stat_t evt_stat[WLC_E_LAST];
+	uint32 lat_seq;			/* frames seen by dhd_lat_pick */
+	dhd_lat_stat_t lat_stat[DHD_LAT_MAX];
 #ifdef CUSTOM_SET_CPUCORE
 	struct task_struct * current_dpc;
 	struct task_struct * current_rxf;
@@ -520,6 +639,13 @@ extern unsigned int dhd_os_get_ioctl_resp_timeout(void);
 extern void dhd_os_set_ioctl_resp_timeout(unsigned int timeout_msec);
 
 extern int dhd_os_get_image_block(char * buf, int len, void * image);
+#ifdef DHD_DBG_CONSOLE
+/* Keep a dongle console line in the ring read through <debugfs>/dhd/console */
+extern void dhd_dbg_console_line(char *line, int len);
+#endif /* DHD_DBG_CONSOLE */
+/* Read the next image block in the background; one read outstanding at a time */
+extern void dhd_os_get_image_block_async(char * buf, int len, void * image);
+extern int dhd_os_get_image_block_wait(void);
 extern void * dhd_os_open_image(char * filename);
 extern void dhd_os_close_image(void * image);
 extern void dhd_os_wd_timer(void *bus, uint wdtick);
@@ -527,6 +653,12 @@ extern void dhd_os_sdlock(dhd_pub_t * pub);
 extern void dhd_os_sdunlock(dhd_pub_t * pub);
 extern void dhd_os_sdlock_txq(dhd_pub_t * pub);
 extern void dhd_os_sdunlock_txq(dhd_pub_t * pub);
+#ifdef DHD_TXSTAGE
+/* Per-CPU tx staging, filled without the txq lock and pulled by the DPC */
+extern bool dhd_os_txstage_push(dhd_pub_t *pub, void *pkt);
+extern void *dhd_os_txstage_pull(dhd_pub_t *pub, uint *cnt);
+extern uint dhd_os_txstage_len(dhd_pub_t *pub);
+#endif /* DHD_TXSTAGE */
 extern void dhd_os_sdlock_rxq(dhd_pub_t * pub);
 extern void dhd_os_sdunlock_rxq(dhd_pub_t * pub);
 extern void dhd_os_sdlock_sndup_rxq(dhd_pub_t * pub);
@@ -602,10 +734,27 @@ extern int net_os_send_hang_message(struct net_device *dev);
 extern int wl_host_event(dhd_pub_t *dhd_pub, int *idx, void *pktdata,
                          wl_event_msg_t *, void **data_ptr);
 extern void wl_event_to_host_order(wl_event_msg_t * evt);
+/* Account an event handled in the cfg80211 thread, rx_us from evt_rx_us */
+extern void dhd_event_stat_done(dhd_pub_t *dhd_pub, uint32 type, uint32 rx_us);
+extern bool dhd_lat_pick(dhd_pub_t *dhd_pub);
+extern void dhd_lat_account(dhd_pub_t *dhd_pub, int stage, uint32 us);
+extern void dhd_lat_stamp(dhd_pub_t *dhd_pub, dhd_lat_tag_t *lat, int stage);
+extern void dhd_lat_done(dhd_pub_t *dhd_pub, dhd_lat_tag_t *lat, int stage, int total);
+extern int dhd_lat_dump(dhd_pub_t *dhd_pub, char *buf, int buflen);
 
 extern int dhd_wl_ioctl(dhd_pub_t *dhd_pub, int ifindex, wl_ioctl_t *ioc, void *buf, int len);
 extern int dhd_wl_ioctl_cmd(dhd_pub_t *dhd_pub, int cmd, void *arg, int len, uint8 set,
                             int ifindex);
+/* Pipelined set ioctls/iovars on interface 0. add returns once the request is
+ * sent; failures are logged and the first one since the previous flush is
+ * returned by flush. Flush before a plain ioctl, the batch can hold every
+ * control slot.
+ */
+extern uint dhd_preinit_batch;
+extern void dhd_iov_batch_begin(dhd_pub_t *dhd);
+extern int dhd_iov_batch_add(dhd_pub_t *dhd, const char *name, int cmd, void *arg, int len);
+extern int dhd_iov_batch_iovar(dhd_pub_t *dhd, const char *name, void *param, int plen);
+extern int dhd_iov_batch_flush(dhd_pub_t *dhd);
 extern void dhd_common_init(osl_t *osh);
 
 extern int dhd_do_driver_init(struct net_device *net);
@@ -665,6 +814,9 @@ extern int wl_iw_send_priv_event(struct net_device *dev, char *flag);
 /* Watchdog timer interval */
 extern uint dhd_watchdog_ms;
 
+/* Trace one data frame in this many, 0 to stop */
+extern uint dhd_lat_sample;
+
 #if defined(DHD_DEBUG)
 /* Console output poll interval */
 extern uint dhd_console_ms;
@@ -62,13 +62,18 @@ extern int dhd_bus_txdata(struct dhd_bus *bus, void *txp);
 
 
 /* Send/receive a control message to/from the dongle.
- * Expects caller to enforce a single outstanding transaction.
+ * txctl expects the caller to send one message at a time. Responses are
+ * handed to dhd_prot_ctl_complete(); rxctl waits until it sets *rxlen.
  */
 extern int dhd_bus_txctl(struct dhd_bus *bus, uchar *msg, uint msglen);
-extern int dhd_bus_rxctl(struct dhd_bus *bus, uchar *msg, uint msglen);
+extern int dhd_bus_rxctl(struct dhd_bus *bus, uint *rxlen);
 
 /* Watchdog timer function */
 extern bool dhd_bus_watchdog(dhd_pub_t *dhd);
+/* ms until the bus watchdog has work again, 0 if only bus activity can give it some */
+extern uint dhd_bus_watchdog_due(dhd_pub_t *dhd);
+/* Frame entering the tx path, lets the bus start waking the clock early */
+extern void dhd_bus_clk_early(dhd_pub_t *dhd);
 
 extern int dhd_bus_oob_intr_register(dhd_pub_t *dhdp);
 extern void dhd_bus_oob_intr_unregister(dhd_pub_t *dhdp);
@@ -48,7 +48,6 @@
 #endif
 
 
-#define RETRIES 2		/* # of retries to retrieve matching ioctl response */
 #define BUS_HEADER_LEN	(24+DHD_SDALIGN)	/* Must be at least SDPCM_RESERVE
 				 * defined in dhd_sdio.c (amount of header tha might be added)
 				 * plus any space that might be needed for alignment padding.
@@ -56,23 +55,187 @@
 #define ROUND_UP_MARGIN	2048	/* Biggest SDIO block size possible for
 				 * round off at the end of buffer
 				 */
+#define CDC_MAX_PENDING	4	/* # of control messages that may be in flight to the dongle */
 
-typedef struct dhd_prot {
-	uint16 reqid;
-	uint8 pending;
-	uint32 lastcmd;
+/* dhd_bus_txctl pushes the bus header in front of msg; buf must directly follow msg */
+typedef struct cdc_msgbuf {
 	uint8 bus_header[BUS_HEADER_LEN];
 	cdc_ioctl_t msg;
 	unsigned char buf[WLC_IOCTL_MAXLEN + ROUND_UP_MARGIN];
+} cdc_msgbuf_t;
+
+/* A control message in flight, matched to its response by reqid */
+typedef struct cdc_req {
+	uint8 state;
+	uint16 reqid;
+	uint rxlen;			/* response length, set by dhd_prot_ctl_complete */
+	uint msglen;			/* room for the response in mb */
+	uint32 start;			/* OSL_SYSUPTIME() when the request was sent */
+	dhd_prot_ioctl_cb_t cb;		/* only for dhd_prot_ioctl_submit */
+	void *cb_arg;
+	cdc_msgbuf_t *mb;
+} cdc_req_t;
+
+#define CDC_REQ_FREE	0
+#define CDC_REQ_PENDING	1	/* sent, no response yet */
+#define CDC_REQ_DONE	2	/* submitted request handed to its callback */
+
+typedef struct dhd_prot {
+	uint16 reqid;
+	uint8 pending;			/* # of requests in flight */
+	uint avail;			/* # of free requests, dhd_prot_ioctl waits on it */
+	uint32 lastcmd;
+	uint32 unmatched;		/* responses nobody was waiting for */
+	cdc_req_t req[CDC_MAX_PENDING];
+	cdc_msgbuf_t msgbuf;		/* buffer of req[0], the others are allocated at attach */
 } dhd_prot_t;
 
 
+static void
+dhdcdc_req_put(dhd_pub_t *dhd, cdc_req_t *req)
+{
+	dhd_prot_t *prot = dhd->prot;
+	unsigned long flags;
+
+	flags = dhd_os_spin_lock(dhd);
+	req->state = CDC_REQ_FREE;
+	req->cb = NULL;
+	prot->pending--;
+	prot->avail++;
+	dhd_os_spin_unlock(dhd, flags);
+
+	/* Let a dhd_prot_ioctl waiting for a free request have this one */
+	dhd_os_ioctl_resp_wake(dhd);
+}
+
+static void
+dhdcdc_req_done(dhd_pub_t *dhd, cdc_req_t *req, int ret)
+{
+	cdc_ioctl_t *msg = &req->mb->msg;
+	uint len = 0;
+
+	if (ret >= 0) {
+		len = MIN(req->rxlen, req->msglen) - sizeof(cdc_ioctl_t);
+		ret = 0;
+		/* Check the ERROR flag */
+		if (ltoh32(msg->flags) & CDCF_IOC_ERROR) {
+			ret = ltoh32(msg->status);
+			/* Cache error from dongle */
+			dhd->dongle_error = ret;
+		}
+	}
+
+	req->cb(dhd, req->cb_arg, ret, req->mb->buf, len);
+	dhdcdc_req_put(dhd, req);
+}
+
+/* Take a free request and give it the next reqid, NULL if all are in flight */
+static cdc_req_t *
+dhdcdc_req_get(dhd_pub_t *dhd, dhd_prot_ioctl_cb_t cb, void *cb_arg)
+{
+	dhd_prot_t *prot = dhd->prot;
+	cdc_req_t *req = NULL;
+	unsigned long flags;
+	int i;
+
+	flags = dhd_os_spin_lock(dhd);
+	for (i = 0; i < CDC_MAX_PENDING; i++) {
+		if (prot->req[i].mb && (prot->req[i].state == CDC_REQ_FREE)) {
+			req = &prot->req[i];
+			break;
+		}
+	}
+	if (req) {
+		req->state = CDC_REQ_PENDING;
+		req->reqid = ++prot->reqid;
+		req->rxlen = 0;
+		req->start = OSL_SYSUPTIME();
+		req->cb = cb;
+		req->cb_arg = cb_arg;
+		prot->pending++;
+		prot->avail--;
+	}
+	dhd_os_spin_unlock(dhd, flags);
+
+	return req;
+}
+
+/* Nobody waits on a submitted request, so the bus watchdog times them out, and
+ * so does anyone about to take a request. Returns the ms until the next one
+ * would time out, 0 if none is in flight.
+ */
+uint
+dhd_prot_ctl_expire(dhd_pub_t *dhd)
+{
+	dhd_prot_t *prot = dhd->prot;
+	uint32 tmo = dhd_os_get_ioctl_resp_timeout();
+	cdc_req_t *expired;
+	uint32 now, age;
+	unsigned long flags;
+	uint next;
+	int i;
+
+	if (prot == NULL)
+		return 0;
+
+	do {
+		expired = NULL;
+		next = 0;
+		now = OSL_SYSUPTIME();
+		flags = dhd_os_spin_lock(dhd);
+		for (i = 0; i < CDC_MAX_PENDING; i++) {
+			cdc_req_t *r = &prot->req[i];
+
+			if ((r->state != CDC_REQ_PENDING) || (r->cb == NULL))
+				continue;
+			age = now - r->start;
+			if (age <= tmo) {
+				if (!next || ((tmo - age + 1) < next))
+					next = tmo - age + 1;
+			} else if (expired == NULL) {
+				r->state = CDC_REQ_DONE;
+				expired = r;
+			}
+		}
+		dhd_os_spin_unlock(dhd, flags);
+
+		if (expired) {
+			DHD_ERROR(("%s: request id %d timed out\n", __FUNCTION__,
+				expired->reqid));
+			dhdcdc_req_done(dhd, expired, -ETIMEDOUT);
+		}
+	} while (expired);
+
+	return next;
+}
+
+static void
+dhdcdc_req_fill(cdc_req_t *req, int ifidx, uint cmd, void *buf, uint len, uint8 action)
+{
+	cdc_ioctl_t *msg = &req->mb->msg;
+
+	memset(msg, 0, sizeof(cdc_ioctl_t));
+
+	msg->cmd = htol32(cmd);
+	msg->len = htol32(len);
+	msg->flags = (req->reqid << CDCF_IOC_ID_SHIFT);
+	CDC_SET_IF_IDX(msg, ifidx);
+	/* add additional action bits */
+	msg->flags |= ((action & WL_IOCTL_ACTION_MASK) << CDCF_IOC_ACTION_SHIFT);
+	if (action & WL_IOCTL_ACTION_SET)
+		msg->flags |= CDCF_IOC_SET;
+	msg->flags = htol32(msg->flags);
+
+	if (buf)
+		memcpy(req->mb->buf, buf, len);
+	req->msglen = len + sizeof(cdc_ioctl_t);
+}
+
 static int
-dhdcdc_msg(dhd_pub_t *dhd)
+dhdcdc_msg(dhd_pub_t *dhd, cdc_req_t *req)
 {
 	int err = 0;
-	dhd_prot_t *prot = dhd->prot;
-	int len = ltoh32(prot->msg.len) + sizeof(cdc_ioctl_t);
+	int len = ltoh32(req->mb->msg.len) + sizeof(cdc_ioctl_t);
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
@@ -86,39 +249,34 @@ dhdcdc_msg(dhd_pub_t *dhd)
 		len = CDC_MAX_MSG_SIZE;
 
 	/* Send request */
-	err = dhd_bus_txctl(dhd->bus, (uchar*)&prot->msg, len);
+	err = dhd_bus_txctl(dhd->bus, (uchar*)&req->mb->msg, len);
 
 	DHD_OS_WAKE_UNLOCK(dhd);
 	return err;
 }
 
 static int
-dhdcdc_cmplt(dhd_pub_t *dhd, uint32 id, uint32 len)
+dhdcdc_cmplt(dhd_pub_t *dhd, cdc_req_t *req)
 {
 	int ret;
-	int cdc_len = len + sizeof(cdc_ioctl_t);
-	dhd_prot_t *prot = dhd->prot;
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
-
-	do {
-		ret = dhd_bus_rxctl(dhd->bus, (uchar*)&prot->msg, cdc_len);
-		if (ret < 0)
-			break;
-	} while (CDC_IOC_ID(ltoh32(prot->msg.flags)) != id);
-
+	/* Let other callers send their requests while this one waits for its response */
+	dhd_os_proto_unblock(dhd);
+	ret = dhd_bus_rxctl(dhd->bus, &req->rxlen);
+	dhd_os_proto_block(dhd);
 
 	return ret;
 }
 
 static int
-dhdcdc_query_ioctl(dhd_pub_t *dhd, int ifidx, uint cmd, void *buf, uint len, uint8 action)
+dhdcdc_query_ioctl(dhd_pub_t *dhd, cdc_req_t *req, int ifidx, uint cmd, void *buf, uint len,
+	uint8 action)
 {
-	dhd_prot_t *prot = dhd->prot;
-	cdc_ioctl_t *msg = &prot->msg;
-	int ret = 0, retries = 0;
-	uint32 id, flags = 0;
+	cdc_ioctl_t *msg = &req->mb->msg;
+	int ret = 0;
+	uint32 flags = 0;
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 	DHD_CTL(("%s: cmd %d len %d\n", __FUNCTION__, cmd, len));
@@ -139,49 +297,26 @@ dhdcdc_query_ioctl(dhd_pub_t *dhd, int ifidx, uint cmd, void *buf, uint len, uin
 		}
 	}
 
-	memset(msg, 0, sizeof(cdc_ioctl_t));
+	dhdcdc_req_fill(req, ifidx, cmd, buf, len, action);
 
-	msg->cmd = htol32(cmd);
-	msg->len = htol32(len);
-	msg->flags = (++prot->reqid << CDCF_IOC_ID_SHIFT);
-	CDC_SET_IF_IDX(msg, ifidx);
-	/* add additional action bits */
-	action &= WL_IOCTL_ACTION_MASK;
-	msg->flags |= (action << CDCF_IOC_ACTION_SHIFT);
-	msg->flags = htol32(msg->flags);
-
-	if (buf)
-		memcpy(prot->buf, buf, len);
-
-	if ((ret = dhdcdc_msg(dhd)) < 0) {
+	if ((ret = dhdcdc_msg(dhd, req)) < 0) {
 		if (!dhd->hang_was_sent)
 		DHD_ERROR(("dhdcdc_query_ioctl: dhdcdc_msg failed w/status %d\n", ret));
 		goto done;
 	}
 
-retry:
 	/* wait for interrupt and get first fragment */
-	if ((ret = dhdcdc_cmplt(dhd, prot->reqid, len)) < 0)
+	if ((ret = dhdcdc_cmplt(dhd, req)) < 0)
 		goto done;
 
 	flags = ltoh32(msg->flags);
-	id = (flags & CDCF_IOC_ID_MASK) >> CDCF_IOC_ID_SHIFT;
-
-	if ((id < prot->reqid) && (++retries < RETRIES))
-		goto retry;
-	if (id != prot->reqid) {
-		DHD_ERROR(("%s: %s: unexpected request id %d (expected %d)\n",
-		           dhd_ifname(dhd, ifidx), __FUNCTION__, id, prot->reqid));
-		ret = -EINVAL;
-		goto done;
-	}
 
 	/* Copy info buffer */
 	if (buf)
 	{
 		if (ret < (int)len)
 			len = ret;
-		memcpy(buf, (void*) prot->buf, len);
+		memcpy(buf, (void*) req->mb->buf, len);
 	}
 
 	/* Check the ERROR flag */
@@ -198,12 +333,12 @@ done:
 
 
 static int
-dhdcdc_set_ioctl(dhd_pub_t *dhd, int ifidx, uint cmd, void *buf, uint len, uint8 action)
+dhdcdc_set_ioctl(dhd_pub_t *dhd, cdc_req_t *req, int ifidx, uint cmd, void *buf, uint len,
+	uint8 action)
 {
-	dhd_prot_t *prot = dhd->prot;
-	cdc_ioctl_t *msg = &prot->msg;
+	cdc_ioctl_t *msg = &req->mb->msg;
 	int ret = 0;
-	uint32 flags, id;
+	uint32 flags;
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 	DHD_CTL(("%s: cmd %d len %d\n", __FUNCTION__, cmd, len));
@@ -220,37 +355,17 @@ dhdcdc_set_ioctl(dhd_pub_t *dhd, int ifidx, uint cmd, void *buf, uint len, uint8
 		return -EIO;
 	}
 
-	memset(msg, 0, sizeof(cdc_ioctl_t));
+	dhdcdc_req_fill(req, ifidx, cmd, buf, len, action);
 
-	msg->cmd = htol32(cmd);
-	msg->len = htol32(len);
-	msg->flags = (++prot->reqid << CDCF_IOC_ID_SHIFT);
-	CDC_SET_IF_IDX(msg, ifidx);
-	/* add additional action bits */
-	action &= WL_IOCTL_ACTION_MASK;
-	msg->flags |= (action << CDCF_IOC_ACTION_SHIFT) | CDCF_IOC_SET;
-	msg->flags = htol32(msg->flags);
-
-	if (buf)
-		memcpy(prot->buf, buf, len);
-
-	if ((ret = dhdcdc_msg(dhd)) < 0) {
+	if ((ret = dhdcdc_msg(dhd, req)) < 0) {
 		DHD_ERROR(("%s: dhdcdc_msg failed w/status %d\n", __FUNCTION__, ret));
 		goto done;
 	}
 
-	if ((ret = dhdcdc_cmplt(dhd, prot->reqid, len)) < 0)
+	if ((ret = dhdcdc_cmplt(dhd, req)) < 0)
 		goto done;
 
 	flags = ltoh32(msg->flags);
-	id = (flags & CDCF_IOC_ID_MASK) >> CDCF_IOC_ID_SHIFT;
-
-	if (id != prot->reqid) {
-		DHD_ERROR(("%s: %s: unexpected request id %d (expected %d)\n",
-		           dhd_ifname(dhd, ifidx), __FUNCTION__, id, prot->reqid));
-		ret = -EINVAL;
-		goto done;
-	}
 
 	/* Check the ERROR flag */
 	if (flags & CDCF_IOC_ERROR)
@@ -269,8 +384,11 @@ int
 dhd_prot_ioctl(dhd_pub_t *dhd, int ifidx, wl_ioctl_t * ioc, void * buf, int len)
 {
 	dhd_prot_t *prot = dhd->prot;
+	cdc_req_t *req;
 	int ret = -1;
 	uint8 action;
+	bool pending;
+	int timeleft = 1;
 
 	if ((dhd->busstate == DHD_BUS_DOWN) || dhd->hang_was_sent) {
 		DHD_ERROR(("%s : bus is down. we have nothing to do\n", __FUNCTION__));
@@ -284,23 +402,35 @@ dhd_prot_ioctl(dhd_pub_t *dhd, int ifidx, wl_ioctl_t * ioc, void * buf, int len)
 	if (len > WLC_IOCTL_MAXLEN)
 		goto done;
 
-	if (prot->pending == TRUE) {
-		DHD_ERROR(("CDC packet is pending!!!! cmd=0x%x (%lu) lastcmd=0x%x (%lu)\n",
-			ioc->cmd, (unsigned long)ioc->cmd, prot->lastcmd,
-			(unsigned long)prot->lastcmd));
-		if ((ioc->cmd == WLC_SET_VAR) || (ioc->cmd == WLC_GET_VAR)) {
-			DHD_TRACE(("iovar cmd=%s\n", (char*)buf));
+	/* All requests in flight: wait for one to be released, as for a response.
+	 * Their owners need the proto lock to finish, so drop it meanwhile.
+	 */
+	dhd_prot_ctl_expire(dhd);
+	while ((req = dhdcdc_req_get(dhd, NULL, NULL)) == NULL) {
+		if (timeleft == 0) {
+			DHD_ERROR(("CDC packets are pending!!!! cmd=0x%x (%lu) "
+				"lastcmd=0x%x (%lu)\n", ioc->cmd, (unsigned long)ioc->cmd,
+				prot->lastcmd, (unsigned long)prot->lastcmd));
+			if ((ioc->cmd == WLC_SET_VAR) || (ioc->cmd == WLC_GET_VAR)) {
+				DHD_TRACE(("iovar cmd=%s\n", (char*)buf));
+			}
+			goto done;
 		}
-		goto done;
+		dhd_os_proto_unblock(dhd);
+		timeleft = dhd_os_ioctl_resp_wait(dhd, &prot->avail, &pending);
+		dhd_os_proto_block(dhd);
+		/* A submitted request may have run out its time meanwhile */
+		dhd_prot_ctl_expire(dhd);
+		if ((dhd->busstate == DHD_BUS_DOWN) || dhd->hang_was_sent)
+			goto done;
 	}
 
-	prot->pending = TRUE;
 	prot->lastcmd = ioc->cmd;
 	action = ioc->set;
 	if (action & WL_IOCTL_ACTION_SET)
-		ret = dhdcdc_set_ioctl(dhd, ifidx, ioc->cmd, buf, len, action);
+		ret = dhdcdc_set_ioctl(dhd, req, ifidx, ioc->cmd, buf, len, action);
 	else {
-		ret = dhdcdc_query_ioctl(dhd, ifidx, ioc->cmd, buf, len, action);
+		ret = dhdcdc_query_ioctl(dhd, req, ifidx, ioc->cmd, buf, len, action);
 		if (ret > 0)
 			ioc->used = ret - sizeof(cdc_ioctl_t);
 	}
@@ -309,7 +439,7 @@ dhd_prot_ioctl(dhd_pub_t *dhd, int ifidx, wl_ioctl_t * ioc, void * buf, int len)
 	if (ret >= 0)
 		ret = 0;
 	else {
-		cdc_ioctl_t *msg = &prot->msg;
+		cdc_ioctl_t *msg = &req->mb->msg;
 		ioc->needed = ltoh32(msg->len); /* len == needed when set/query fails from dongle */
 	}
 
@@ -323,13 +453,88 @@ dhd_prot_ioctl(dhd_pub_t *dhd, int ifidx, wl_ioctl_t * ioc, void * buf, int len)
 		dhd->wme_dp = (uint8) ltoh32(val);
 	}
 
-	prot->pending = FALSE;
+	dhdcdc_req_put(dhd, req);
 
 done:
 
 	return ret;
 }
 
+int
+dhd_prot_ioctl_submit(dhd_pub_t *dhd, int ifidx, wl_ioctl_t *ioc, void *buf, int len,
+	dhd_prot_ioctl_cb_t cb, void *arg)
+{
+	cdc_req_t *req;
+	int ret;
+
+	if ((dhd->busstate == DHD_BUS_DOWN) || dhd->hang_was_sent)
+		return BCME_NOTUP;
+
+	if ((len > WLC_IOCTL_MAXLEN) || (cb == NULL))
+		return BCME_BADARG;
+
+	dhd_prot_ctl_expire(dhd);
+	if ((req = dhdcdc_req_get(dhd, cb, arg)) == NULL)
+		return BCME_BUSY;
+
+	dhdcdc_req_fill(req, ifidx, ioc->cmd, buf, len, ioc->set);
+
+	/* dhd_bus_txctl takes one control frame at a time */
+	dhd_os_proto_block(dhd);
+	ret = dhdcdc_msg(dhd, req);
+	dhd_os_proto_unblock(dhd);
+
+	if (ret < 0) {
+		DHD_ERROR(("%s: dhdcdc_msg failed w/status %d\n", __FUNCTION__, ret));
+		dhdcdc_req_put(dhd, req);
+		return ret;
+	}
+
+	return BCME_OK;
+}
+
+int
+dhd_prot_ctl_complete(dhd_pub_t *dhd, uchar *msg, uint msglen)
+{
+	dhd_prot_t *prot = dhd->prot;
+	cdc_req_t *req = NULL;
+	unsigned long flags;
+	uint32 id;
+	int i;
+
+	if ((prot == NULL) || (msglen < sizeof(cdc_ioctl_t)))
+		return BCME_BADLEN;
+
+	id = CDC_IOC_ID(ltoh32(((cdc_ioctl_t *)msg)->flags));
+
+	flags = dhd_os_spin_lock(dhd);
+	for (i = 0; i < CDC_MAX_PENDING; i++) {
+		if ((prot->req[i].state == CDC_REQ_PENDING) && (prot->req[i].reqid == id)) {
+			req = &prot->req[i];
+			break;
+		}
+	}
+	if (req) {
+		bcopy(msg, &req->mb->msg, MIN(msglen, req->msglen));
+		req->rxlen = msglen;
+		if (req->cb)
+			req->state = CDC_REQ_DONE;
+	} else
+		prot->unmatched++;
+	dhd_os_spin_unlock(dhd, flags);
+
+	if (req == NULL) {
+		DHD_ERROR(("%s: unexpected request id %d (last %d)\n",
+		           __FUNCTION__, id, prot->reqid));
+		return BCME_NOTFOUND;
+	}
+
+	if (req->cb)
+		dhdcdc_req_done(dhd, req, (int)msglen);
+
+	return BCME_OK;
+}
+
 int
 dhd_prot_iovar_op(dhd_pub_t *dhdp, const char *name,
                   void *params, int plen, void *arg, int len, bool set)
@@ -340,7 +545,8 @@ dhd_prot_iovar_op(dhd_pub_t *dhdp, const char *name,
 void
 dhd_prot_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 {
-	bcm_bprintf(strbuf, "Protocol CDC: reqid %d\n", dhdp->prot->reqid);
+	bcm_bprintf(strbuf, "Protocol CDC: reqid %d pending %d/%d unmatched %u\n",
+		dhdp->prot->reqid, dhdp->prot->pending, CDC_MAX_PENDING, dhdp->prot->unmatched);
 #ifdef PROP_TXSTATUS
 	dhd_wlfc_dump(dhdp, strbuf);
 #endif
@@ -458,6 +664,7 @@ int
 dhd_prot_attach(dhd_pub_t *dhd)
 {
 	dhd_prot_t *cdc;
+	int i;
 
 	if (!(cdc = (dhd_prot_t *)DHD_OS_PREALLOC(dhd, DHD_PREALLOC_PROT, sizeof(dhd_prot_t)))) {
 		DHD_ERROR(("%s: kmalloc failed\n", __FUNCTION__));
@@ -466,11 +673,21 @@ dhd_prot_attach(dhd_pub_t *dhd)
 	memset(cdc, 0, sizeof(dhd_prot_t));
 
 	/* ensure that the msg buf directly follows the cdc msg struct */
-	if ((uintptr)(&cdc->msg + 1) != (uintptr)cdc->buf) {
+	if ((uintptr)(&cdc->msgbuf.msg + 1) != (uintptr)cdc->msgbuf.buf) {
 		DHD_ERROR(("dhd_prot_t is not correctly defined\n"));
 		goto fail;
 	}
 
+	cdc->req[0].mb = &cdc->msgbuf;
+	for (i = 1; i < CDC_MAX_PENDING; i++) {
+		/* run with fewer requests in flight rather than fail */
+		if (!(cdc->req[i].mb = MALLOC(dhd->osh, sizeof(cdc_msgbuf_t)))) {
+			DHD_ERROR(("%s: only %d control requests\n", __FUNCTION__, i));
+			break;
+		}
+	}
+	cdc->avail = i;
+
 	dhd->prot = cdc;
 #ifdef BDC
 	dhd->hdrlen += BDC_HEADER_LEN;
@@ -488,9 +705,15 @@ fail:
 void
 dhd_prot_detach(dhd_pub_t *dhd)
 {
+	int i;
+
 #ifdef PROP_TXSTATUS
 	dhd_wlfc_deinit(dhd);
 #endif
+	for (i = 1; i < CDC_MAX_PENDING; i++) {
+		if (dhd->prot->req[i].mb)
+			MFREE(dhd->osh, dhd->prot->req[i].mb, sizeof(cdc_msgbuf_t));
+	}
 	DHD_OS_PREFREE(dhd, dhd->prot, sizeof(dhd_prot_t));
 	dhd->prot = NULL;
 }
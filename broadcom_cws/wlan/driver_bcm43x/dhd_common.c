@@ -144,6 +144,8 @@ enum {
 #endif
 	IOV_CHANGEMTU,
 	IOV_HOSTREORDER_FLOWS,
+	IOV_EVSTATS,
+	IOV_LATSTATS,
 #ifdef DHDTCPACK_SUPPRESS
 	IOV_TCPACK_SUPPRESS,
 #endif /* DHDTCPACK_SUPPRESS */
@@ -187,6 +189,8 @@ const bcm_iovar_t dhd_iovars[] = {
 	{"changemtu", IOV_CHANGEMTU, 0, IOVT_UINT32, 0 },
 	{"host_reorder_flows", IOV_HOSTREORDER_FLOWS, 0, IOVT_BUFFER,
 	(WLHOST_REORDERDATA_MAXFLOWS + 1) },
+	{"evstats",	IOV_EVSTATS,	0,	IOVT_BUFFER,	DHD_IOCTL_MAXLEN },
+	{"latstats",	IOV_LATSTATS,	0,	IOVT_BUFFER,	DHD_IOCTL_MAXLEN },
 #ifdef DHDTCPACK_SUPPRESS
 	{"tcpack_suppress",	IOV_TCPACK_SUPPRESS,	0,	IOVT_UINT8,	0 },
 #endif /* DHDTCPACK_SUPPRESS */
@@ -219,6 +223,8 @@ dhd_dump(dhd_pub_t *dhdp, char *buf, int buflen)
 	bcm_bprintf(strbuf, "pub.iswl %d pub.drv_version %ld pub.mac %s\n",
 	            dhdp->iswl, dhdp->drv_version, bcm_ether_ntoa(&dhdp->mac, eabuf));
 	bcm_bprintf(strbuf, "pub.bcmerror %d tickcnt %u\n", dhdp->bcmerror, dhdp->tickcnt);
+	bcm_bprintf(strbuf, "preinit %u ms, %u ioctls pipelined\n",
+	            dhdp->preinit_ms, dhdp->iov_batch.queued);
 
 	bcm_bprintf(strbuf, "dongle stats:\n");
 	bcm_bprintf(strbuf, "tx_packets %lu tx_bytes %lu tx_errors %lu tx_dropped %lu\n",
@@ -240,8 +246,20 @@ dhd_dump(dhd_pub_t *dhdp, char *buf, int buflen)
 	            dhdp->rx_ctlpkts, dhdp->rx_ctlerrs, dhdp->rx_dropped);
 	bcm_bprintf(strbuf, "rx_readahead_cnt %lu tx_realloc %lu\n",
 	            dhdp->rx_readahead_cnt, dhdp->tx_realloc);
+	bcm_bprintf(strbuf, "rxf hiwat %u stalls %u wakeups %u drops %u\n",
+	            dhdp->rxf_hiwat, dhdp->rxf_stalls, dhdp->rxf_wakeups, dhdp->rxf_drops);
+#ifdef DHD_NAPI
+	bcm_bprintf(strbuf, "napi polls %u pkts %u budget_out %u hiwat %u\n",
+	            dhdp->rx_napi_polls, dhdp->rx_napi_pkts, dhdp->rx_napi_budget_out,
+	            dhdp->rx_napi_hiwat);
+#endif /* DHD_NAPI */
 	bcm_bprintf(strbuf, "\n");
 
+#ifdef DHDTCPACK_SUPPRESS
+	dhd_tcpack_dump(dhdp, strbuf);
+	bcm_bprintf(strbuf, "\n");
+#endif /* DHDTCPACK_SUPPRESS */
+
 	/* Add any prot info */
 	dhd_prot_dump(dhdp, strbuf);
 	bcm_bprintf(strbuf, "\n");
@@ -252,6 +270,63 @@ dhd_dump(dhd_pub_t *dhdp, char *buf, int buflen)
 	return (!strbuf->size ? BCME_BUFTOOSHORT : 0);
 }
 
+static int
+dhd_event_stat_dump(dhd_pub_t *dhdp, char *buf, int buflen)
+{
+	struct bcmstrbuf b;
+	struct bcmstrbuf *strbuf = &b;
+	dhd_evt_stat_t *es;
+	const char *name;
+	uint type, i;
+
+	bcm_binit(strbuf, buf, buflen);
+
+	bcm_bprintf(strbuf, "event cnt dpc_avg dpc_max done max_us: log2 us bins\n");
+	for (type = 0; type < WLC_E_LAST; type++) {
+		es = &dhdp->evt_stat[type];
+		if (!es->cnt && !es->done)
+			continue;
+
+		name = "UNKNOWN";
+		for (i = 0; i < (uint)bcmevent_names_size; i++)
+			if (bcmevent_names[i].event == type)
+				name = bcmevent_names[i].name;
+
+		bcm_bprintf(strbuf, "%s(%u) %u %u %u %u %u:", name, type, es->cnt,
+			es->cnt ? es->dpc_us / es->cnt : 0, es->dpc_max_us,
+			es->done, es->max_us);
+		bcm_bprhist(strbuf, es->bin, DHD_EVT_NBINS);
+		bcm_bprintf(strbuf, "\n");
+	}
+
+	return (!strbuf->size ? BCME_BUFTOOSHORT : 0);
+}
+
+int
+dhd_lat_dump(dhd_pub_t *dhdp, char *buf, int buflen)
+{
+	static const char *lat_names[DHD_LAT_MAX] = {
+		"tx_host", "tx_queue", "tx_glom", "tx_cmd53", "tx_total",
+		"rx_dpc", "rx_read", "rx_proc", "rx_queue", "rx_stack", "rx_total"
+	};
+	struct bcmstrbuf b;
+	struct bcmstrbuf *strbuf = &b;
+	dhd_lat_stat_t *ls;
+	uint stage;
+
+	bcm_binit(strbuf, buf, buflen);
+
+	bcm_bprintf(strbuf, "sample 1/%u, stage cnt max_us: log2 us bins\n", dhd_lat_sample);
+	for (stage = 0; stage < DHD_LAT_MAX; stage++) {
+		ls = &dhdp->lat_stat[stage];
+		bcm_bprintf(strbuf, "%s %u %u:", lat_names[stage], ls->cnt, ls->max_us);
+		bcm_bprhist(strbuf, ls->bin, DHD_LAT_NBINS);
+		bcm_bprintf(strbuf, "\n");
+	}
+
+	return (!strbuf->size ? BCME_BUFTOOSHORT : 0);
+}
+
 int
 dhd_wl_ioctl_cmd(dhd_pub_t *dhd_pub, int cmd, void *arg, int len, uint8 set, int ifindex)
 {
@@ -294,6 +369,160 @@ dhd_wl_ioctl(dhd_pub_t *dhd_pub, int ifindex, wl_ioctl_t *ioc, void *buf, int le
 	return ret;
 }
 
+/* Send bring-up settings without waiting for each response (0 waits for each one) */
+uint dhd_preinit_batch = TRUE;
+
+static void
+dhd_iov_batch_cb(dhd_pub_t *dhd, void *arg, int ret, void *buf, uint len)
+{
+	dhd_iov_batch_t *batch = &dhd->iov_batch;
+	dhd_iov_batch_ent_t *ent = (dhd_iov_batch_ent_t *)arg;
+	const char *name = ent->name;
+	unsigned long flags;
+
+	flags = dhd_os_spin_lock(dhd);
+	if (ent->gen == batch->gen) {
+		if ((ret < 0) && (batch->err == 0))
+			batch->err = ret;
+		batch->inflight--;
+		batch->kick = 1;
+	}
+	ent->busy = FALSE;
+	dhd_os_spin_unlock(dhd, flags);
+
+	if (ret < 0)
+		DHD_ERROR(("%s: %s failed %d\n", __FUNCTION__, name, ret));
+}
+
+void
+dhd_iov_batch_begin(dhd_pub_t *dhd)
+{
+	dhd_iov_batch_t *batch = &dhd->iov_batch;
+	unsigned long flags;
+
+	flags = dhd_os_spin_lock(dhd);
+	batch->gen++;
+	batch->inflight = 0;
+	batch->queued = 0;
+	batch->err = 0;
+	dhd_os_spin_unlock(dhd, flags);
+}
+
+int
+dhd_iov_batch_add(dhd_pub_t *dhd, const char *name, int cmd, void *arg, int len)
+{
+	dhd_iov_batch_t *batch = &dhd->iov_batch;
+	dhd_iov_batch_ent_t *ent;
+	wl_ioctl_t ioc;
+	unsigned long flags;
+	bool pending;
+	int i, ret;
+
+	memset(&ioc, 0, sizeof(ioc));
+	ioc.cmd = cmd;
+	ioc.buf = arg;
+	ioc.len = len;
+	ioc.set = TRUE;
+
+	while (dhd_preinit_batch) {
+		ent = NULL;
+		flags = dhd_os_spin_lock(dhd);
+		batch->kick = 0;
+		for (i = 0; i < DHD_IOV_BATCH_MAX; i++) {
+			if (!batch->ent[i].busy) {
+				ent = &batch->ent[i];
+				ent->busy = TRUE;
+				ent->name = name;
+				ent->gen = batch->gen;
+				batch->inflight++;
+				break;
+			}
+		}
+		dhd_os_spin_unlock(dhd, flags);
+
+		/* Every entry still waits on an abandoned batch */
+		if (ent == NULL)
+			break;
+
+		ret = dhd_prot_ioctl_submit(dhd, 0, &ioc, arg, len, dhd_iov_batch_cb, ent);
+		if (ret == BCME_OK) {
+			batch->queued++;
+			return BCME_OK;
+		}
+
+		flags = dhd_os_spin_lock(dhd);
+		ent->busy = FALSE;
+		batch->inflight--;
+		i = batch->inflight;
+		dhd_os_spin_unlock(dhd, flags);
+
+		if (ret != BCME_BUSY) {
+			DHD_ERROR(("%s: %s failed %d\n", __FUNCTION__, name, ret));
+			return ret;
+		}
+
+		/* Control slots are taken by someone else, nothing of ours to wait for */
+		if (i == 0)
+			break;
+
+		/* Wait for one of ours to be answered */
+		if (dhd_os_ioctl_resp_wait(dhd, &batch->kick, &pending) == 0) {
+			DHD_ERROR(("%s: %s timed out waiting for a control slot\n",
+				__FUNCTION__, name));
+			return -ETIMEDOUT;
+		}
+	}
+
+	if ((ret = dhd_wl_ioctl(dhd, 0, &ioc, arg, len)) < 0)
+		DHD_ERROR(("%s: %s failed %d\n", __FUNCTION__, name, ret));
+	return ret;
+}
+
+int
+dhd_iov_batch_iovar(dhd_pub_t *dhd, const char *name, void *param, int plen)
+{
+	char iovbuf[WLC_IOCTL_SMLEN];
+	uint len;
+
+	len = bcm_mkiovar((char *)name, (char *)param, plen, iovbuf, sizeof(iovbuf));
+	if (len == 0)
+		return BCME_BUFTOOSHORT;
+
+	return dhd_iov_batch_add(dhd, name, WLC_SET_VAR, iovbuf, len);
+}
+
+int
+dhd_iov_batch_flush(dhd_pub_t *dhd)
+{
+	dhd_iov_batch_t *batch = &dhd->iov_batch;
+	unsigned long flags;
+	bool pending;
+	uint inflight;
+	int err;
+
+	for (;;) {
+		flags = dhd_os_spin_lock(dhd);
+		batch->kick = 0;
+		inflight = batch->inflight;
+		err = batch->err;
+		if (inflight == 0)
+			batch->err = 0;
+		dhd_os_spin_unlock(dhd, flags);
+
+		if (inflight == 0)
+			break;
+
+		if (dhd_os_ioctl_resp_wait(dhd, &batch->kick, &pending) == 0) {
+			DHD_ERROR(("%s: %d requests unanswered\n", __FUNCTION__, inflight));
+			/* Late answers must not count against the next batch */
+			dhd_iov_batch_begin(dhd);
+			return -ETIMEDOUT;
+		}
+	}
+
+	return err;
+}
+
 static int
 dhd_doiovar(dhd_pub_t *dhd_pub, const bcm_iovar_t *vi, uint32 actionid, const char *name,
             void *params, int plen, void *arg, int len, int val_size)
@@ -359,6 +588,14 @@ dhd_doiovar(dhd_pub_t *dhd_pub, const bcm_iovar_t *vi, uint32 actionid, const ch
 		bcmerror = dhd_dump(dhd_pub, arg, len);
 		break;
 
+	case IOV_GVAL(IOV_EVSTATS):
+		bcmerror = dhd_event_stat_dump(dhd_pub, arg, len);
+		break;
+
+	case IOV_GVAL(IOV_LATSTATS):
+		bcmerror = dhd_lat_dump(dhd_pub, arg, len);
+		break;
+
 #ifdef DHD_DEBUG
 	case IOV_GVAL(IOV_DCONSOLE_POLL):
 		int_val = (int32)dhd_console_ms;
@@ -383,6 +620,14 @@ dhd_doiovar(dhd_pub_t *dhd_pub, const bcm_iovar_t *vi, uint32 actionid, const ch
 		dhd_pub->rx_dropped = 0;
 		dhd_pub->rx_readahead_cnt = 0;
 		dhd_pub->tx_realloc = 0;
+		dhd_pub->rxf_hiwat = dhd_pub->rxf_stalls = 0;
+		dhd_pub->rxf_wakeups = dhd_pub->rxf_drops = 0;
+		bzero(dhd_pub->evt_stat, sizeof(dhd_pub->evt_stat));
+		bzero(dhd_pub->lat_stat, sizeof(dhd_pub->lat_stat));
+#ifdef DHD_NAPI
+		dhd_pub->rx_napi_polls = dhd_pub->rx_napi_pkts = 0;
+		dhd_pub->rx_napi_budget_out = dhd_pub->rx_napi_hiwat = 0;
+#endif /* DHD_NAPI */
 		dhd_pub->wd_dpc_sched = 0;
 		memset(&dhd_pub->dstats, 0, sizeof(dhd_pub->dstats));
 		dhd_bus_clearcounts(dhd_pub);
@@ -1129,6 +1374,64 @@ wl_show_host_event(wl_event_msg_t *event, void *event_data)
 }
 #endif /* SHOW_EVENTS */
 
+void
+dhd_event_stat_done(dhd_pub_t *dhd_pub, uint32 type, uint32 rx_us)
+{
+	dhd_evt_stat_t *es;
+	uint32 us;
+
+	if (!rx_us || (type >= WLC_E_LAST))
+		return;
+
+	es = &dhd_pub->evt_stat[type];
+	us = OSL_SYSUPTIME_US() - rx_us;
+	es->done++;
+	if (us > es->max_us)
+		es->max_us = us;
+	es->bin[bcm_log2_bin(us, DHD_EVT_NBINS)]++;
+}
+
+/* Sampling decision for a new frame. Stage counters are updated from the xmit,
+ * DPC and rxf contexts without a lock; a lost increment is fine for these.
+ */
+bool
+dhd_lat_pick(dhd_pub_t *dhd_pub)
+{
+	uint rate = dhd_lat_sample;
+
+	return rate && ((++dhd_pub->lat_seq % rate) == 0);
+}
+
+void
+dhd_lat_account(dhd_pub_t *dhd_pub, int stage, uint32 us)
+{
+	dhd_lat_stat_t *ls = &dhd_pub->lat_stat[stage];
+
+	ls->cnt++;
+	if (us > ls->max_us)
+		ls->max_us = us;
+	ls->bin[bcm_log2_bin(us, DHD_LAT_NBINS)]++;
+}
+
+/* Close a stage of a traced frame, see DHD_LAT_STAMP */
+void
+dhd_lat_stamp(dhd_pub_t *dhd_pub, dhd_lat_tag_t *lat, int stage)
+{
+	uint32 now = OSL_SYSUPTIME_US();
+
+	dhd_lat_account(dhd_pub, stage, now - lat->ts);
+	lat->ts = now;
+}
+
+/* Close the last stage and the total; the frame is not traced after this */
+void
+dhd_lat_done(dhd_pub_t *dhd_pub, dhd_lat_tag_t *lat, int stage, int total)
+{
+	dhd_lat_stamp(dhd_pub, lat, stage);
+	dhd_lat_account(dhd_pub, total, lat->ts - lat->t0);
+	lat->t0 = 0;
+}
+
 int
 wl_host_event(dhd_pub_t *dhd_pub, int *ifidx, void *pktdata,
               wl_event_msg_t *event, void **data_ptr)
@@ -1139,6 +1442,7 @@ wl_host_event(dhd_pub_t *dhd_pub, int *ifidx, void *pktdata,
 	uint32 type, status, datalen;
 	uint16 flags;
 	int evlen;
+	uint32 rx_us = OSL_SYSUPTIME_US();
 
 	if (bcmp(BRCM_OUI, &pvt_data->bcm_hdr.oui[0], DOT11_OUI_LEN)) {
 		DHD_ERROR(("%s: mismatched OUI, bailing\n", __FUNCTION__));
@@ -1289,6 +1593,18 @@ wl_host_event(dhd_pub_t *dhd_pub, int *ifidx, void *pktdata,
 		break;
 	}
 
+	if (type < WLC_E_LAST) {
+		dhd_evt_stat_t *es = &dhd_pub->evt_stat[type];
+		uint32 us = OSL_SYSUPTIME_US() - rx_us;
+
+		es->cnt++;
+		es->dpc_us += us;
+		if (us > es->dpc_max_us)
+			es->dpc_max_us = us;
+		/* picked up by wl_cfg80211_event for the end to end time */
+		dhd_pub->evt_rx_us = rx_us;
+	}
+
 #ifdef SHOW_EVENTS
 	wl_show_host_event(event, (void *)event_data);
 #endif /* SHOW_EVENTS */
@@ -117,32 +117,43 @@ pkt_frag_t pkt_frag_info(osl_t *osh, void *p)
 
 #ifdef DHDTCPACK_SUPPRESS
 
-typedef struct {
-	void *pkt_in_q;			/* TCP ACK packet that is already in txq or DelayQ */
-	void *pkt_ether_hdr;	/* Ethernet header pointer of pkt_in_q */
-} tcpack_info_t;
+/* SRC/DST ip addrs followed by SRC/DST tcp ports, as in the IP and TCP headers */
+#define TCPACK_FLOW_KEY_LEN	(IPV4_ADDR_LEN * 2 + TCP_PORT_LEN * 2)
 
 typedef struct _tdata_psh_info_t {
 	uint32 end_seq;			/* end seq# of a received TCP PSH DATA pkt */
 	struct _tdata_psh_info_t *next;	/* next pointer of the link chain */
 } tdata_psh_info_t;
 
-typedef struct {
-	uint8 src_ip_addr[IPV4_ADDR_LEN];	/* SRC ip addrs of this TCP stream */
-	uint8 dst_ip_addr[IPV4_ADDR_LEN];	/* DST ip addrs of this TCP stream */
-	uint8 src_tcp_port[TCP_PORT_LEN];	/* SRC tcp ports of this TCP stream */
-	uint8 dst_tcp_port[TCP_PORT_LEN];	/* DST tcp ports of this TCP stream */
+/* A TCP stream, keyed in the direction our TCP ACKs are sent */
+typedef struct tcpack_flow {
+	uint8 key[TCPACK_FLOW_KEY_LEN];	/* ip addrs and tcp ports of this TCP stream */
+	struct tcpack_flow *hash_next;	/* next flow in the hash bucket, or in the free chain */
+	struct tcpack_flow *lru_prev;	/* LRU chain, most recently used first */
+	struct tcpack_flow *lru_next;
+	void *pkt_in_q;			/* TCP ACK packet that is already in txq or DelayQ */
+	void *pkt_ether_hdr;	/* Ethernet header pointer of pkt_in_q */
 	tdata_psh_info_t *tdata_psh_info_head;	/* Head of received TCP PSH DATA chain */
 	tdata_psh_info_t *tdata_psh_info_tail;	/* Tail of received TCP PSH DATA chain */
-	uint32 last_used_time;	/* The last time this tcpdata_info was used(in ms) */
-} tcpdata_info_t;
+	uint32 last_used_time;	/* The last time this flow was used(in ms) */
+	uint32 ack_cnt;			/* TCP ACKs sent on this flow */
+	uint32 ack_sup_cnt;		/* TCP ACKs replaced by a newer one in txq */
+	uint32 psh_cnt;			/* TCP PSH DATA received on this flow */
+} tcpack_flow_t;
 
 /* TCPACK SUPPRESS module */
 typedef struct {
-	int tcpack_info_cnt;
-	tcpack_info_t tcpack_info_tbl[TCPACK_INFO_MAXNUM];	/* Info of TCP ACK to send */
-	int tcpdata_info_cnt;
-	tcpdata_info_t tcpdata_info_tbl[TCPDATA_INFO_MAXNUM];	/* Info of received TCP DATA */
+	uint alloc_size;		/* size of this module with flow_hash and flow_tbl */
+	uint flow_max;			/* number of flows and of hash buckets, power of 2 */
+	tcpack_flow_t **flow_hash;	/* hash buckets of flows in use */
+	tcpack_flow_t *flow_tbl;	/* all flow elements */
+	tcpack_flow_t *flow_free;	/* free flow elements chain */
+	tcpack_flow_t flow_lru;		/* LRU chain anchor, lru_prev is the oldest flow */
+	int flow_cnt;			/* Number of flows in use */
+	int tcpack_info_cnt;	/* Number of flows with a TCP ACK in txq */
+	uint32 flow_evicted;	/* flows reused while still active because all were in use */
+	uint32 flow_aged;		/* flows freed after TCPDATA_INFO_TIMEOUT of inactivity */
+	uint tdata_psh_info_num;	/* Number of tdata_psh_info elements in pool */
 	tdata_psh_info_t *tdata_psh_info_pool;	/* Pointer to tdata_psh_info elements pool */
 	tdata_psh_info_t *tdata_psh_info_free;	/* free tdata_psh_info elements chain in pool */
 #ifdef DHDTCPACK_SUP_DBG
@@ -150,6 +161,9 @@ typedef struct {
 #endif /* DHDTCPACK_SUP_DBG */
 } tcpack_sup_module_t;
 
+/* Max number of TCP streams tracked, sampled when suppression is turned on */
+uint dhd_tcpack_flows = TCPACK_FLOWS_DEFAULT;
+
 #if defined(DEBUG_COUNTER) && defined(DHDTCPACK_SUP_DBG)
 counter_tbl_t tack_tbl = {"tcpACK", 0, 1000, 10, {0, }, 1};
 #endif /* DEBUG_COUNTER && DHDTCPACK_SUP_DBG */
@@ -211,18 +225,19 @@ static int _tdata_psh_info_pool_init(dhd_pub_t *dhdp,
 	ASSERT(tcpack_sup_mod->tdata_psh_info_pool == NULL);
 	ASSERT(tcpack_sup_mod->tdata_psh_info_free == NULL);
 
+	tcpack_sup_mod->tdata_psh_info_num = TCPDATA_PSH_INFO_PER_FLOW * tcpack_sup_mod->flow_max;
 	tdata_psh_info_pool =
-		MALLOC(dhdp->osh, sizeof(tdata_psh_info_t) * TCPDATA_PSH_INFO_MAXNUM);
+		MALLOC(dhdp->osh, sizeof(tdata_psh_info_t) * tcpack_sup_mod->tdata_psh_info_num);
 
 	if (tdata_psh_info_pool == NULL)
 		return BCME_NOMEM;
-	bzero(tdata_psh_info_pool, sizeof(tdata_psh_info_t) * TCPDATA_PSH_INFO_MAXNUM);
+	bzero(tdata_psh_info_pool, sizeof(tdata_psh_info_t) * tcpack_sup_mod->tdata_psh_info_num);
 #ifdef DHDTCPACK_SUP_DBG
 	tcpack_sup_mod->psh_info_enq_num = 0;
 #endif /* DHDTCPACK_SUP_DBG */
 
 	/* Enqueue newly allocated tcpdata psh info elements to the pool */
-	for (i = 0; i < TCPDATA_PSH_INFO_MAXNUM; i++)
+	for (i = 0; i < tcpack_sup_mod->tdata_psh_info_num; i++)
 		_tdata_psh_info_pool_enq(tcpack_sup_mod, &tdata_psh_info_pool[i]);
 
 	ASSERT(tcpack_sup_mod->tdata_psh_info_free != NULL);
@@ -235,6 +250,7 @@ static void _tdata_psh_info_pool_deinit(dhd_pub_t *dhdp,
 	tcpack_sup_module_t *tcpack_sup_mod)
 {
 	uint i;
+	tcpack_flow_t *flow;
 	tdata_psh_info_t *tdata_psh_info;
 
 	DHD_TRACE(("%s %d: Enter\n", __FUNCTION__, __LINE__));
@@ -245,15 +261,15 @@ static void _tdata_psh_info_pool_deinit(dhd_pub_t *dhdp,
 		return;
 	}
 
-	for (i = 0; i < tcpack_sup_mod->tcpdata_info_cnt; i++) {
-		tcpdata_info_t *tcpdata_info = &tcpack_sup_mod->tcpdata_info_tbl[i];
-		/* Return tdata_psh_info elements allocated to each tcpdata_info to the pool */
-		while ((tdata_psh_info = tcpdata_info->tdata_psh_info_head)) {
-			tcpdata_info->tdata_psh_info_head = tdata_psh_info->next;
+	for (flow = tcpack_sup_mod->flow_lru.lru_next; flow != &tcpack_sup_mod->flow_lru;
+		flow = flow->lru_next) {
+		/* Return tdata_psh_info elements allocated to each flow to the pool */
+		while ((tdata_psh_info = flow->tdata_psh_info_head)) {
+			flow->tdata_psh_info_head = tdata_psh_info->next;
 			tdata_psh_info->next = NULL;
 			_tdata_psh_info_pool_enq(tcpack_sup_mod, tdata_psh_info);
 		}
-		tcpdata_info->tdata_psh_info_tail = NULL;
+		flow->tdata_psh_info_tail = NULL;
 	}
 #ifdef DHDTCPACK_SUP_DBG
 	DHD_ERROR(("%s %d: PSH INFO ENQ %d\n",
@@ -267,14 +283,164 @@ static void _tdata_psh_info_pool_deinit(dhd_pub_t *dhdp,
 		tdata_psh_info->next = NULL;
 		i++;
 	}
-	ASSERT(i == TCPDATA_PSH_INFO_MAXNUM);
+	ASSERT(i == tcpack_sup_mod->tdata_psh_info_num);
 	MFREE(dhdp->osh, tcpack_sup_mod->tdata_psh_info_pool,
-		sizeof(tdata_psh_info_t) * TCPDATA_PSH_INFO_MAXNUM);
+		sizeof(tdata_psh_info_t) * tcpack_sup_mod->tdata_psh_info_num);
 	tcpack_sup_mod->tdata_psh_info_pool = NULL;
 
 	return;
 }
 
+static tcpack_sup_module_t*
+_tcpack_sup_module_alloc(dhd_pub_t *dhdp)
+{
+	tcpack_sup_module_t *tcpack_sup_mod;
+	uint flow_max = 1;
+	uint alloc_size;
+	uint i;
+
+	/* Flows and hash buckets are 1:1, round up to a power of 2 for the hash mask */
+	while (flow_max < MIN(dhd_tcpack_flows, TCPACK_FLOWS_MAX))
+		flow_max <<= 1;
+
+	alloc_size = sizeof(tcpack_sup_module_t) +
+		flow_max * (sizeof(tcpack_flow_t *) + sizeof(tcpack_flow_t));
+	tcpack_sup_mod = MALLOC(dhdp->osh, alloc_size);
+	if (tcpack_sup_mod == NULL)
+		return NULL;
+	bzero(tcpack_sup_mod, alloc_size);
+
+	tcpack_sup_mod->alloc_size = alloc_size;
+	tcpack_sup_mod->flow_max = flow_max;
+	tcpack_sup_mod->flow_hash = (tcpack_flow_t **)(tcpack_sup_mod + 1);
+	tcpack_sup_mod->flow_tbl = (tcpack_flow_t *)(tcpack_sup_mod->flow_hash + flow_max);
+	for (i = 0; i < flow_max; i++) {
+		tcpack_sup_mod->flow_tbl[i].hash_next = tcpack_sup_mod->flow_free;
+		tcpack_sup_mod->flow_free = &tcpack_sup_mod->flow_tbl[i];
+	}
+	tcpack_sup_mod->flow_lru.lru_prev = &tcpack_sup_mod->flow_lru;
+	tcpack_sup_mod->flow_lru.lru_next = &tcpack_sup_mod->flow_lru;
+
+	return tcpack_sup_mod;
+}
+
+/* Build the key of the flow a TCP packet belongs to, seen from our TCP ACK side */
+static void
+_tcpack_flow_key(uint8 *ip_hdr, uint8 *tcp_hdr, bool from_peer, uint8 *key)
+{
+	if (from_peer) {
+		bcopy(&ip_hdr[IPV4_DEST_IP_OFFSET], &key[0], IPV4_ADDR_LEN);
+		bcopy(&ip_hdr[IPV4_SRC_IP_OFFSET], &key[IPV4_ADDR_LEN], IPV4_ADDR_LEN);
+		bcopy(&tcp_hdr[TCP_DEST_PORT_OFFSET], &key[IPV4_ADDR_LEN * 2], TCP_PORT_LEN);
+		bcopy(&tcp_hdr[TCP_SRC_PORT_OFFSET],
+			&key[IPV4_ADDR_LEN * 2 + TCP_PORT_LEN], TCP_PORT_LEN);
+	} else {
+		bcopy(&ip_hdr[IPV4_SRC_IP_OFFSET], &key[0], IPV4_ADDR_LEN * 2);
+		bcopy(&tcp_hdr[TCP_SRC_PORT_OFFSET], &key[IPV4_ADDR_LEN * 2], TCP_PORT_LEN * 2);
+	}
+}
+
+static INLINE uint
+_tcpack_flow_hash(tcpack_sup_module_t *tcpack_sup_mod, uint8 *key)
+{
+	uint32 h;
+
+	h = ntoh32_ua(&key[0]) ^ ntoh32_ua(&key[IPV4_ADDR_LEN]) ^
+		ntoh32_ua(&key[IPV4_ADDR_LEN * 2]);
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+
+	return h & (tcpack_sup_mod->flow_max - 1);
+}
+
+static tcpack_flow_t*
+_tcpack_flow_find(tcpack_sup_module_t *tcpack_sup_mod, uint8 *key)
+{
+	tcpack_flow_t *flow = tcpack_sup_mod->flow_hash[_tcpack_flow_hash(tcpack_sup_mod, key)];
+
+	while (flow && memcmp(flow->key, key, TCPACK_FLOW_KEY_LEN))
+		flow = flow->hash_next;
+
+	return flow;
+}
+
+static void
+_tcpack_flow_free(tcpack_sup_module_t *tcpack_sup_mod, tcpack_flow_t *flow)
+{
+	tcpack_flow_t **pflow;
+	tdata_psh_info_t *tdata_psh_info;
+
+	pflow = &tcpack_sup_mod->flow_hash[_tcpack_flow_hash(tcpack_sup_mod, flow->key)];
+	while (*pflow != flow)
+		pflow = &(*pflow)->hash_next;
+	*pflow = flow->hash_next;
+
+	flow->lru_prev->lru_next = flow->lru_next;
+	flow->lru_next->lru_prev = flow->lru_prev;
+
+	while ((tdata_psh_info = flow->tdata_psh_info_head)) {
+		flow->tdata_psh_info_head = tdata_psh_info->next;
+		tdata_psh_info->next = NULL;
+		_tdata_psh_info_pool_enq(tcpack_sup_mod, tdata_psh_info);
+	}
+
+	/* A TCP ACK still in txq is sent as is, it just can't be replaced anymore */
+	if (flow->pkt_in_q)
+		tcpack_sup_mod->tcpack_info_cnt--;
+
+	bzero(flow, sizeof(tcpack_flow_t));
+	flow->hash_next = tcpack_sup_mod->flow_free;
+	tcpack_sup_mod->flow_free = flow;
+	tcpack_sup_mod->flow_cnt--;
+}
+
+/* Look up the flow of key, creating it if needed, and make it the most recently used */
+static tcpack_flow_t*
+_tcpack_flow_get(tcpack_sup_module_t *tcpack_sup_mod, uint8 *key)
+{
+	tcpack_flow_t *flow;
+	uint32 now_in_ms = OSL_SYSUPTIME();
+	uint bucket;
+
+	/* Remove flows inactive for TCPDATA_INFO_TIMEOUT, oldest first */
+	while ((flow = tcpack_sup_mod->flow_lru.lru_prev) != &tcpack_sup_mod->flow_lru &&
+		now_in_ms - flow->last_used_time > TCPDATA_INFO_TIMEOUT) {
+		DHD_TRACE(("%s %d: flow %p is aged out\n", __FUNCTION__, __LINE__, flow));
+		_tcpack_flow_free(tcpack_sup_mod, flow);
+		tcpack_sup_mod->flow_aged++;
+	}
+
+	flow = _tcpack_flow_find(tcpack_sup_mod, key);
+	if (flow) {
+		flow->lru_prev->lru_next = flow->lru_next;
+		flow->lru_next->lru_prev = flow->lru_prev;
+	} else {
+		if (tcpack_sup_mod->flow_free == NULL) {
+			/* All flows are active, reuse the least recently used one */
+			ASSERT(tcpack_sup_mod->flow_cnt == tcpack_sup_mod->flow_max);
+			_tcpack_flow_free(tcpack_sup_mod, tcpack_sup_mod->flow_lru.lru_prev);
+			tcpack_sup_mod->flow_evicted++;
+		}
+		flow = tcpack_sup_mod->flow_free;
+		tcpack_sup_mod->flow_free = flow->hash_next;
+
+		bcopy(key, flow->key, TCPACK_FLOW_KEY_LEN);
+		bucket = _tcpack_flow_hash(tcpack_sup_mod, key);
+		flow->hash_next = tcpack_sup_mod->flow_hash[bucket];
+		tcpack_sup_mod->flow_hash[bucket] = flow;
+		tcpack_sup_mod->flow_cnt++;
+	}
+
+	flow->lru_prev = &tcpack_sup_mod->flow_lru;
+	flow->lru_next = tcpack_sup_mod->flow_lru.lru_next;
+	tcpack_sup_mod->flow_lru.lru_next->lru_prev = flow;
+	tcpack_sup_mod->flow_lru.lru_next = flow;
+	flow->last_used_time = now_in_ms;
+
+	return flow;
+}
+
 int dhd_tcpack_suppress_set(dhd_pub_t *dhdp, uint8 mode)
 {
 	int ret = BCME_OK;
@@ -298,11 +464,8 @@ int dhd_tcpack_suppress_set(dhd_pub_t *dhdp, uint8 mode)
 	/* Old tcpack_sup_mode is TCPACK_SUP_DELAYTX */
 	if (dhdp->tcpack_sup_mode == TCPACK_SUP_DELAYTX) {
 		tcpack_sup_module_t *tcpack_sup_mod = dhdp->tcpack_sup_module;
-		/* We won't need tdata_psh_info pool and tcpddata_info_tbl anymore */
+		/* We won't need tdata_psh_info pool anymore */
 		_tdata_psh_info_pool_deinit(dhdp, tcpack_sup_mod);
-		tcpack_sup_mod->tcpdata_info_cnt = 0;
-		bzero(tcpack_sup_mod->tcpdata_info_tbl,
-			sizeof(tcpdata_info_t) * TCPDATA_INFO_MAXNUM);
 		/* For half duplex bus interface, tx precedes rx by default */
 		if (dhdp->bus)
 			dhd_bus_set_dotxinrx(dhdp->bus, TRUE);
@@ -312,21 +475,20 @@ int dhd_tcpack_suppress_set(dhd_pub_t *dhdp, uint8 mode)
 
 	if (mode == TCPACK_SUP_OFF) {
 		ASSERT(dhdp->tcpack_sup_module != NULL);
-		MFREE(dhdp->osh, dhdp->tcpack_sup_module, sizeof(tcpack_sup_module_t));
+		MFREE(dhdp->osh, dhdp->tcpack_sup_module,
+			((tcpack_sup_module_t *)dhdp->tcpack_sup_module)->alloc_size);
 		dhdp->tcpack_sup_module = NULL;
 		goto exit;
 	}
 
 	if (dhdp->tcpack_sup_module == NULL) {
-		tcpack_sup_module_t *tcpack_sup_mod =
-			MALLOC(dhdp->osh, sizeof(tcpack_sup_module_t));
+		tcpack_sup_module_t *tcpack_sup_mod = _tcpack_sup_module_alloc(dhdp);
 		if (tcpack_sup_mod == NULL) {
 			DHD_ERROR(("%s %d: No MEM\n", __FUNCTION__, __LINE__));
 			dhdp->tcpack_sup_mode = TCPACK_SUP_OFF;
 			ret = BCME_NOMEM;
 			goto exit;
 		}
-		bzero(tcpack_sup_mod, sizeof(tcpack_sup_module_t));
 		dhdp->tcpack_sup_module = tcpack_sup_mod;
 	}
 
@@ -347,6 +509,7 @@ void
 dhd_tcpack_info_tbl_clean(dhd_pub_t *dhdp)
 {
 	tcpack_sup_module_t *tcpack_sup_mod = dhdp->tcpack_sup_module;
+	tcpack_flow_t *flow;
 
 	if (dhdp->tcpack_sup_mode == TCPACK_SUP_OFF)
 		goto exit;
@@ -360,8 +523,13 @@ dhd_tcpack_info_tbl_clean(dhd_pub_t *dhdp)
 		goto exit;
 	}
 
+	/* Keep the flows and their counters, only forget the TCP ACKs in txq */
+	for (flow = tcpack_sup_mod->flow_lru.lru_next; flow != &tcpack_sup_mod->flow_lru;
+		flow = flow->lru_next) {
+		flow->pkt_in_q = NULL;
+		flow->pkt_ether_hdr = NULL;
+	}
 	tcpack_sup_mod->tcpack_info_cnt = 0;
-	bzero(tcpack_sup_mod->tcpack_info_tbl, sizeof(tcpack_info_t) * TCPACK_INFO_MAXNUM);
 	dhd_os_tcpackunlock(dhdp);
 
 exit:
@@ -370,10 +538,10 @@ exit:
 
 inline int dhd_tcpack_check_xmit(dhd_pub_t *dhdp, void *pkt)
 {
-	uint8 i;
 	tcpack_sup_module_t *tcpack_sup_mod;
-	tcpack_info_t *tcpack_info_tbl;
-	int tbl_cnt;
+	tcpack_flow_t *flow;
+	uint8 flow_key[TCPACK_FLOW_KEY_LEN];
+	uint8 *ether_hdr, *ip_hdr, *tcp_hdr;
 	uint pushed_len;
 	int ret = BCME_OK;
 	void *pdata;
@@ -394,6 +562,15 @@ inline int dhd_tcpack_check_xmit(dhd_pub_t *dhdp, void *pkt)
 		goto exit;
 	}
 
+	ether_hdr = (uint8 *)pdata + pushed_len;
+	if ((ether_hdr[12] << 8 | ether_hdr[13]) != ETHER_TYPE_IP)
+		goto exit;
+	ip_hdr = ether_hdr + ETHER_HDR_LEN;
+	if (IP_VER(ip_hdr) != IP_VER_4 || IPV4_PROT(ip_hdr) != IP_PROT_TCP)
+		goto exit;
+	tcp_hdr = ip_hdr + IPV4_HLEN(ip_hdr);
+	_tcpack_flow_key(ip_hdr, tcp_hdr, FALSE, flow_key);
+
 	dhd_os_tcpacklock(dhdp);
 	tcpack_sup_mod = dhdp->tcpack_sup_module;
 
@@ -403,27 +580,18 @@ inline int dhd_tcpack_check_xmit(dhd_pub_t *dhdp, void *pkt)
 		dhd_os_tcpackunlock(dhdp);
 		goto exit;
 	}
-	tbl_cnt = tcpack_sup_mod->tcpack_info_cnt;
-	tcpack_info_tbl = tcpack_sup_mod->tcpack_info_tbl;
-
-	ASSERT(tbl_cnt <= TCPACK_INFO_MAXNUM);
-
-	for (i = 0; i < tbl_cnt; i++) {
-		if (tcpack_info_tbl[i].pkt_in_q == pkt) {
-			DHD_TRACE(("%s %d: pkt %p sent out. idx %d, tbl_cnt %d\n",
-				__FUNCTION__, __LINE__, pkt, i, tbl_cnt));
-			/* This pkt is being transmitted so remove the tcp_ack_info of it. */
-			if (i < tbl_cnt - 1) {
-				bcopy(&tcpack_info_tbl[tbl_cnt - 1],
-					&tcpack_info_tbl[i], sizeof(tcpack_info_t));
-			}
-			bzero(&tcpack_info_tbl[tbl_cnt - 1], sizeof(tcpack_info_t));
-			if (--tcpack_sup_mod->tcpack_info_cnt < 0) {
-				DHD_ERROR(("%s %d: ERROR!!! tcp_ack_info_cnt %d\n",
-					__FUNCTION__, __LINE__, tcpack_sup_mod->tcpack_info_cnt));
-				ret = BCME_ERROR;
-			}
-			break;
+
+	flow = _tcpack_flow_find(tcpack_sup_mod, flow_key);
+	if (flow && flow->pkt_in_q == pkt) {
+		DHD_TRACE(("%s %d: pkt %p sent out. ttl cnt %d\n",
+			__FUNCTION__, __LINE__, pkt, tcpack_sup_mod->tcpack_info_cnt));
+		/* This pkt is being transmitted so it can't be replaced anymore */
+		flow->pkt_in_q = NULL;
+		flow->pkt_ether_hdr = NULL;
+		if (--tcpack_sup_mod->tcpack_info_cnt < 0) {
+			DHD_ERROR(("%s %d: ERROR!!! tcp_ack_info_cnt %d\n",
+				__FUNCTION__, __LINE__, tcpack_sup_mod->tcpack_info_cnt));
+			ret = BCME_ERROR;
 		}
 	}
 	dhd_os_tcpackunlock(dhdp);
@@ -432,12 +600,10 @@ exit:
 	return ret;
 }
 
-static INLINE bool dhd_tcpdata_psh_acked(dhd_pub_t *dhdp, uint8 *ip_hdr,
-	uint8 *tcp_hdr, uint32 tcp_ack_num)
+static INLINE bool dhd_tcpdata_psh_acked(dhd_pub_t *dhdp, tcpack_flow_t *tcpdata_info,
+	uint32 tcp_ack_num)
 {
 	tcpack_sup_module_t *tcpack_sup_mod;
-	int i;
-	tcpdata_info_t *tcpdata_info = NULL;
 	tdata_psh_info_t *tdata_psh_info = NULL;
 	bool ret = FALSE;
 
@@ -451,41 +617,7 @@ static INLINE bool dhd_tcpdata_psh_acked(dhd_pub_t *dhdp, uint8 *ip_hdr,
 		goto exit;
 	}
 
-	DHD_TRACE(("%s %d: IP addr "IPV4_ADDR_STR" "IPV4_ADDR_STR
-		" TCP port %d %d, ack %u\n", __FUNCTION__, __LINE__,
-		IPV4_ADDR_TO_STR(ntoh32_ua(&ip_hdr[IPV4_SRC_IP_OFFSET])),
-		IPV4_ADDR_TO_STR(ntoh32_ua(&ip_hdr[IPV4_DEST_IP_OFFSET])),
-		ntoh16_ua(&tcp_hdr[TCP_SRC_PORT_OFFSET]),
-		ntoh16_ua(&tcp_hdr[TCP_DEST_PORT_OFFSET]),
-		tcp_ack_num));
-
-	for (i = 0; i < tcpack_sup_mod->tcpdata_info_cnt; i++) {
-		tcpdata_info_t *tcpdata_info_tmp = &tcpack_sup_mod->tcpdata_info_tbl[i];
-		DHD_TRACE(("%s %d: data info[%d], IP addr "IPV4_ADDR_STR" "IPV4_ADDR_STR
-			" TCP port %d %d\n", __FUNCTION__, __LINE__, i,
-			IPV4_ADDR_TO_STR(ntoh32_ua(tcpdata_info_tmp->src_ip_addr)),
-			IPV4_ADDR_TO_STR(ntoh32_ua(tcpdata_info_tmp->dst_ip_addr)),
-			ntoh16_ua(tcpdata_info_tmp->src_tcp_port),
-			ntoh16_ua(tcpdata_info_tmp->dst_tcp_port)));
-
-		/* If either IP address or TCP port number does not match, skip. */
-		if (memcmp(&ip_hdr[IPV4_SRC_IP_OFFSET],
-			tcpdata_info_tmp->dst_ip_addr, IPV4_ADDR_LEN) == 0 &&
-			memcmp(&ip_hdr[IPV4_DEST_IP_OFFSET],
-			tcpdata_info_tmp->src_ip_addr, IPV4_ADDR_LEN) == 0 &&
-			memcmp(&tcp_hdr[TCP_SRC_PORT_OFFSET],
-			tcpdata_info_tmp->dst_tcp_port, TCP_PORT_LEN) == 0 &&
-			memcmp(&tcp_hdr[TCP_DEST_PORT_OFFSET],
-			tcpdata_info_tmp->src_tcp_port, TCP_PORT_LEN) == 0) {
-			tcpdata_info = tcpdata_info_tmp;
-			break;
-		}
-	}
-
-	if (tcpdata_info == NULL) {
-		DHD_TRACE(("%s %d: no tcpdata_info!\n", __FUNCTION__, __LINE__));
-		goto exit;
-	}
+	DHD_TRACE(("%s %d: ack %u\n", __FUNCTION__, __LINE__, tcp_ack_num));
 
 	if (tcpdata_info->tdata_psh_info_head == NULL) {
 		DHD_TRACE(("%s %d: No PSH DATA to be acked!\n", __FUNCTION__, __LINE__));
@@ -527,8 +659,12 @@ dhd_tcpack_suppress(dhd_pub_t *dhdp, void *pkt)
 	uint16 new_ip_total_len;	/* Total length of IP packet for the new packet */
 	uint32 new_tcp_hdr_len;		/* TCP header length of the new packet */
 	tcpack_sup_module_t *tcpack_sup_mod;
-	tcpack_info_t *tcpack_info_tbl;
-	int i;
+	tcpack_flow_t *flow;
+	uint8 flow_key[TCPACK_FLOW_KEY_LEN];
+	void *oldpkt;	/* TCPACK packet that is already in txq or DelayQ */
+	uint8 *old_ether_hdr, *old_ip_hdr, *old_tcp_hdr;
+	uint32 old_ip_hdr_len, old_tcp_hdr_len;
+	uint32 old_tcpack_num;	/* TCP ACK number of old TCPACK packet in Q */
 	bool ret = FALSE;
 	bool set_dotxinrx = TRUE;
 
@@ -601,7 +737,8 @@ dhd_tcpack_suppress(dhd_pub_t *dhdp, void *pkt)
 		ntoh16_ua(&new_tcp_hdr[TCP_SRC_PORT_OFFSET]),
 		ntoh16_ua(&new_tcp_hdr[TCP_DEST_PORT_OFFSET])));
 
-	/* Look for tcp_ack_info that has the same ip src/dst addrs and tcp src/dst ports */
+	_tcpack_flow_key(new_ip_hdr, new_tcp_hdr, FALSE, flow_key);
+
 	dhd_os_tcpacklock(dhdp);
 #if defined(DEBUG_COUNTER) && defined(DHDTCPACK_SUP_DBG)
 	counter_printlog(&tack_tbl);
@@ -609,7 +746,6 @@ dhd_tcpack_suppress(dhd_pub_t *dhdp, void *pkt)
 #endif /* DEBUG_COUNTER && DHDTCPACK_SUP_DBG */
 
 	tcpack_sup_mod = dhdp->tcpack_sup_module;
-	tcpack_info_tbl = tcpack_sup_mod->tcpack_info_tbl;
 
 	if (!tcpack_sup_mod) {
 		DHD_ERROR(("%s %d: tcpack suppress module NULL!!\n", __FUNCTION__, __LINE__));
@@ -618,7 +754,11 @@ dhd_tcpack_suppress(dhd_pub_t *dhdp, void *pkt)
 		goto exit;
 	}
 
-	if (dhd_tcpdata_psh_acked(dhdp, new_ip_hdr, new_tcp_hdr, new_tcp_ack_num)) {
+	/* Look for the flow that has the same ip src/dst addrs and tcp src/dst ports */
+	flow = _tcpack_flow_get(tcpack_sup_mod, flow_key);
+	flow->ack_cnt++;
+
+	if (dhd_tcpdata_psh_acked(dhdp, flow, new_tcp_ack_num)) {
 		/* This TCPACK is ACK to TCPDATA PSH pkt, so keep set_dotxinrx TRUE */
 #if defined(DEBUG_COUNTER) && defined(DHDTCPACK_SUP_DBG)
 		tack_tbl.cnt[5]++;
@@ -626,96 +766,71 @@ dhd_tcpack_suppress(dhd_pub_t *dhdp, void *pkt)
 	} else
 		set_dotxinrx = FALSE;
 
-	for (i = 0; i < tcpack_sup_mod->tcpack_info_cnt; i++) {
-		void *oldpkt;	/* TCPACK packet that is already in txq or DelayQ */
-		uint8 *old_ether_hdr, *old_ip_hdr, *old_tcp_hdr;
-		uint32 old_ip_hdr_len, old_tcp_hdr_len;
-		uint32 old_tcpack_num;	/* TCP ACK number of old TCPACK packet in Q */
-
-		if ((oldpkt = tcpack_info_tbl[i].pkt_in_q) == NULL) {
-			DHD_ERROR(("%s %d: Unexpected error!! cur idx %d, ttl cnt %d\n",
-				__FUNCTION__, __LINE__, i, tcpack_sup_mod->tcpack_info_cnt));
-			break;
-		}
-
-		if (PKTDATA(dhdp->osh, oldpkt) == NULL) {
-			DHD_ERROR(("%s %d: oldpkt data NULL!! cur idx %d, ttl cnt %d\n",
-				__FUNCTION__, __LINE__, i, tcpack_sup_mod->tcpack_info_cnt));
-			break;
-		}
+	if ((oldpkt = flow->pkt_in_q) == NULL) {
+		/* No TCPACK packet of this flow is in txq, so remember this one */
+		DHD_TRACE(("%s %d: Add pkt 0x%p(ether_hdr 0x%p) to flow %p\n",
+			__FUNCTION__, __LINE__, pkt, new_ether_hdr, flow));
 
-		old_ether_hdr = tcpack_info_tbl[i].pkt_ether_hdr;
-		old_ip_hdr = old_ether_hdr + ETHER_HDR_LEN;
-		old_ip_hdr_len = IPV4_HLEN(old_ip_hdr);
-		old_tcp_hdr = old_ip_hdr + old_ip_hdr_len;
-		old_tcp_hdr_len = 4 * TCP_HDRLEN(old_tcp_hdr[TCP_HLEN_OFFSET]);
-
-		DHD_TRACE(("%s %d: oldpkt %p[%d], IP addr "IPV4_ADDR_STR" "IPV4_ADDR_STR
-			" TCP port %d %d\n", __FUNCTION__, __LINE__, oldpkt, i,
-			IPV4_ADDR_TO_STR(ntoh32_ua(&old_ip_hdr[IPV4_SRC_IP_OFFSET])),
-			IPV4_ADDR_TO_STR(ntoh32_ua(&old_ip_hdr[IPV4_DEST_IP_OFFSET])),
-			ntoh16_ua(&old_tcp_hdr[TCP_SRC_PORT_OFFSET]),
-			ntoh16_ua(&old_tcp_hdr[TCP_DEST_PORT_OFFSET])));
-
-		/* If either of IP address or TCP port number does not match, skip. */
-		if (memcmp(&new_ip_hdr[IPV4_SRC_IP_OFFSET],
-			&old_ip_hdr[IPV4_SRC_IP_OFFSET], IPV4_ADDR_LEN * 2) ||
-			memcmp(&new_tcp_hdr[TCP_SRC_PORT_OFFSET],
-			&old_tcp_hdr[TCP_SRC_PORT_OFFSET], TCP_PORT_LEN * 2))
-			continue;
-
-		old_tcpack_num = ntoh32_ua(&old_tcp_hdr[TCP_ACK_NUM_OFFSET]);
-
-		if (IS_TCPSEQ_GT(new_tcp_ack_num, old_tcpack_num)) {
-			/* New packet has higher TCP ACK number, so it replaces the old packet */
-			if (new_ip_hdr_len == old_ip_hdr_len &&
-				new_tcp_hdr_len == old_tcp_hdr_len) {
-				ASSERT(memcmp(new_ether_hdr, old_ether_hdr, ETHER_HDR_LEN) == 0);
-				bcopy(new_ip_hdr, old_ip_hdr, new_ip_total_len);
-				PKTFREE(dhdp->osh, pkt, FALSE);
-				DHD_TRACE(("%s %d: TCP ACK replace %u -> %u\n",
-					__FUNCTION__, __LINE__, old_tcpack_num, new_tcp_ack_num));
-#if defined(DEBUG_COUNTER) && defined(DHDTCPACK_SUP_DBG)
-				tack_tbl.cnt[2]++;
-#endif /* DEBUG_COUNTER && DHDTCPACK_SUP_DBG */
-				ret = TRUE;
-			} else
-				DHD_TRACE(("%s %d: lenth mismatch %d != %d || %d != %d\n",
-					__FUNCTION__, __LINE__, new_ip_hdr_len, old_ip_hdr_len,
-					new_tcp_hdr_len, old_tcp_hdr_len));
-		} else if (new_tcp_ack_num == old_tcpack_num) {
-			set_dotxinrx = TRUE;
-			/* TCPACK retransmission */
+		flow->pkt_in_q = pkt;
+		flow->pkt_ether_hdr = new_ether_hdr;
+		tcpack_sup_mod->tcpack_info_cnt++;
 #if defined(DEBUG_COUNTER) && defined(DHDTCPACK_SUP_DBG)
-			tack_tbl.cnt[3]++;
+		tack_tbl.cnt[1]++;
 #endif /* DEBUG_COUNTER && DHDTCPACK_SUP_DBG */
-		} else {
-			DHD_TRACE(("%s %d: ACK number reverse old %u(0x%p) new %u(0x%p)\n",
-				__FUNCTION__, __LINE__, old_tcpack_num, oldpkt,
-				new_tcp_ack_num, pkt));
-		}
 		dhd_os_tcpackunlock(dhdp);
 		goto exit;
 	}
 
-	if (i == tcpack_sup_mod->tcpack_info_cnt && i < TCPACK_INFO_MAXNUM) {
-		/* No TCPACK packet with the same IP addr and TCP port is found
-		 * in tcp_ack_info_tbl. So add this packet to the table.
-		 */
-		DHD_TRACE(("%s %d: Add pkt 0x%p(ether_hdr 0x%p) to tbl[%d]\n",
-			__FUNCTION__, __LINE__, pkt, new_ether_hdr,
-			tcpack_sup_mod->tcpack_info_cnt));
+	if (PKTDATA(dhdp->osh, oldpkt) == NULL) {
+		DHD_ERROR(("%s %d: oldpkt data NULL!! ttl cnt %d\n",
+			__FUNCTION__, __LINE__, tcpack_sup_mod->tcpack_info_cnt));
+		dhd_os_tcpackunlock(dhdp);
+		goto exit;
+	}
 
-		tcpack_info_tbl[tcpack_sup_mod->tcpack_info_cnt].pkt_in_q = pkt;
-		tcpack_info_tbl[tcpack_sup_mod->tcpack_info_cnt].pkt_ether_hdr = new_ether_hdr;
-		tcpack_sup_mod->tcpack_info_cnt++;
+	old_ether_hdr = flow->pkt_ether_hdr;
+	old_ip_hdr = old_ether_hdr + ETHER_HDR_LEN;
+	old_ip_hdr_len = IPV4_HLEN(old_ip_hdr);
+	old_tcp_hdr = old_ip_hdr + old_ip_hdr_len;
+	old_tcp_hdr_len = 4 * TCP_HDRLEN(old_tcp_hdr[TCP_HLEN_OFFSET]);
+
+	DHD_TRACE(("%s %d: oldpkt %p, IP addr "IPV4_ADDR_STR" "IPV4_ADDR_STR
+		" TCP port %d %d\n", __FUNCTION__, __LINE__, oldpkt,
+		IPV4_ADDR_TO_STR(ntoh32_ua(&old_ip_hdr[IPV4_SRC_IP_OFFSET])),
+		IPV4_ADDR_TO_STR(ntoh32_ua(&old_ip_hdr[IPV4_DEST_IP_OFFSET])),
+		ntoh16_ua(&old_tcp_hdr[TCP_SRC_PORT_OFFSET]),
+		ntoh16_ua(&old_tcp_hdr[TCP_DEST_PORT_OFFSET])));
+
+	old_tcpack_num = ntoh32_ua(&old_tcp_hdr[TCP_ACK_NUM_OFFSET]);
+
+	if (IS_TCPSEQ_GT(new_tcp_ack_num, old_tcpack_num)) {
+		/* New packet has higher TCP ACK number, so it replaces the old packet */
+		if (new_ip_hdr_len == old_ip_hdr_len &&
+			new_tcp_hdr_len == old_tcp_hdr_len) {
+			ASSERT(memcmp(new_ether_hdr, old_ether_hdr, ETHER_HDR_LEN) == 0);
+			bcopy(new_ip_hdr, old_ip_hdr, new_ip_total_len);
+			PKTFREE(dhdp->osh, pkt, FALSE);
+			DHD_TRACE(("%s %d: TCP ACK replace %u -> %u\n",
+				__FUNCTION__, __LINE__, old_tcpack_num, new_tcp_ack_num));
 #if defined(DEBUG_COUNTER) && defined(DHDTCPACK_SUP_DBG)
-		tack_tbl.cnt[1]++;
+			tack_tbl.cnt[2]++;
+#endif /* DEBUG_COUNTER && DHDTCPACK_SUP_DBG */
+			flow->ack_sup_cnt++;
+			ret = TRUE;
+		} else
+			DHD_TRACE(("%s %d: lenth mismatch %d != %d || %d != %d\n",
+				__FUNCTION__, __LINE__, new_ip_hdr_len, old_ip_hdr_len,
+				new_tcp_hdr_len, old_tcp_hdr_len));
+	} else if (new_tcp_ack_num == old_tcpack_num) {
+		set_dotxinrx = TRUE;
+		/* TCPACK retransmission */
+#if defined(DEBUG_COUNTER) && defined(DHDTCPACK_SUP_DBG)
+		tack_tbl.cnt[3]++;
 #endif /* DEBUG_COUNTER && DHDTCPACK_SUP_DBG */
 	} else {
-		ASSERT(i == tcpack_sup_mod->tcpack_info_cnt);
-		DHD_TRACE(("%s %d: No empty tcp ack info tbl\n",
-			__FUNCTION__, __LINE__));
+		DHD_TRACE(("%s %d: ACK number reverse old %u(0x%p) new %u(0x%p)\n",
+			__FUNCTION__, __LINE__, old_tcpack_num, oldpkt,
+			new_tcp_ack_num, pkt));
 	}
 	dhd_os_tcpackunlock(dhdp);
 
@@ -742,10 +857,10 @@ dhd_tcpdata_info_get(dhd_pub_t *dhdp, void *pkt)
 	uint16 tcp_data_len;	/* TCP DATA length that excludes IP and TCP headers */
 	uint32 end_tcp_seq_num;	/* TCP seq number of the last byte in the new packet */
 	tcpack_sup_module_t *tcpack_sup_mod;
-	tcpdata_info_t *tcpdata_info = NULL;
+	tcpack_flow_t *tcpdata_info;
+	uint8 flow_key[TCPACK_FLOW_KEY_LEN];
 	tdata_psh_info_t *tdata_psh_info;
 
-	int i;
 	bool ret = FALSE;
 
 	if (dhdp->tcpack_sup_mode != TCPACK_SUP_DELAYTX)
@@ -808,6 +923,8 @@ dhd_tcpdata_info_get(dhd_pub_t *dhdp, void *pkt)
 		ntoh16_ua(&tcp_hdr[TCP_DEST_PORT_OFFSET]),
 		tcp_hdr[TCP_FLAGS_OFFSET]));
 
+	_tcpack_flow_key(ip_hdr, tcp_hdr, TRUE, flow_key);
+
 	dhd_os_tcpacklock(dhdp);
 	tcpack_sup_mod = dhdp->tcpack_sup_module;
 
@@ -818,99 +935,13 @@ dhd_tcpdata_info_get(dhd_pub_t *dhdp, void *pkt)
 		goto exit;
 	}
 
-	/* Look for tcpdata_info that has the same ip src/dst addrs and tcp src/dst ports */
-	i = 0;
-	while (i < tcpack_sup_mod->tcpdata_info_cnt) {
-		tcpdata_info_t *tdata_info_tmp = &tcpack_sup_mod->tcpdata_info_tbl[i];
-		uint32 now_in_ms = OSL_SYSUPTIME();
-		DHD_TRACE(("%s %d: data info[%d], IP addr "IPV4_ADDR_STR" "IPV4_ADDR_STR
-			" TCP port %d %d\n", __FUNCTION__, __LINE__, i,
-			IPV4_ADDR_TO_STR(ntoh32_ua(tdata_info_tmp->src_ip_addr)),
-			IPV4_ADDR_TO_STR(ntoh32_ua(tdata_info_tmp->dst_ip_addr)),
-			ntoh16_ua(tdata_info_tmp->src_tcp_port),
-			ntoh16_ua(tdata_info_tmp->dst_tcp_port)));
-
-		/* If both IP address and TCP port number match, we found it so break. */
-		if (memcmp(&ip_hdr[IPV4_SRC_IP_OFFSET],
-			tdata_info_tmp->src_ip_addr, IPV4_ADDR_LEN * 2) == 0 &&
-			memcmp(&tcp_hdr[TCP_SRC_PORT_OFFSET],
-			tdata_info_tmp->src_tcp_port, TCP_PORT_LEN * 2) == 0) {
-			tcpdata_info = tdata_info_tmp;
-			tcpdata_info->last_used_time = now_in_ms;
-			break;
-		}
-
-		if (now_in_ms - tdata_info_tmp->last_used_time > TCPDATA_INFO_TIMEOUT) {
-			tdata_psh_info_t *tdata_psh_info_tmp;
-			tcpdata_info_t *last_tdata_info;
-
-			while ((tdata_psh_info_tmp = tdata_info_tmp->tdata_psh_info_head)) {
-				tdata_info_tmp->tdata_psh_info_head = tdata_psh_info_tmp->next;
-				tdata_psh_info_tmp->next = NULL;
-				DHD_TRACE(("%s %d: Clean tdata_psh_info(end_seq %u)!\n",
-					__FUNCTION__, __LINE__, tdata_psh_info_tmp->end_seq));
-				_tdata_psh_info_pool_enq(tcpack_sup_mod, tdata_psh_info_tmp);
-			}
-#ifdef DHDTCPACK_SUP_DBG
-			DHD_ERROR(("%s %d: PSH INFO ENQ %d\n",
-				__FUNCTION__, __LINE__, tcpack_sup_mod->psh_info_enq_num));
-#endif /* DHDTCPACK_SUP_DBG */
-			tcpack_sup_mod->tcpdata_info_cnt--;
-			ASSERT(tcpack_sup_mod->tcpdata_info_cnt >= 0);
-
-			last_tdata_info =
-				&tcpack_sup_mod->tcpdata_info_tbl[tcpack_sup_mod->tcpdata_info_cnt];
-			if (i < tcpack_sup_mod->tcpdata_info_cnt) {
-				ASSERT(last_tdata_info != tdata_info_tmp);
-				bcopy(last_tdata_info, tdata_info_tmp, sizeof(tcpdata_info_t));
-			}
-			bzero(last_tdata_info, sizeof(tcpdata_info_t));
-			DHD_ERROR(("%s %d: tcpdata_info(idx %d) is aged out. ttl cnt is now %d\n",
-				__FUNCTION__, __LINE__, i, tcpack_sup_mod->tcpdata_info_cnt));
-			/* Don't increase "i" here, so that the prev last tcpdata_info is checked */
-		} else
-			 i++;
-	}
+	/* Look for the flow that has the same ip src/dst addrs and tcp src/dst ports */
+	tcpdata_info = _tcpack_flow_get(tcpack_sup_mod, flow_key);
 
 	tcp_seq_num = ntoh32_ua(&tcp_hdr[TCP_SEQ_NUM_OFFSET]);
 	tcp_data_len = ip_total_len - ip_hdr_len - tcp_hdr_len;
 	end_tcp_seq_num = tcp_seq_num + tcp_data_len;
 
-	if (tcpdata_info == NULL) {
-		ASSERT(i == tcpack_sup_mod->tcpdata_info_cnt);
-		if (i >= TCPDATA_INFO_MAXNUM) {
-			DHD_TRACE(("%s %d: tcp_data_info_tbl FULL! %d %d"
-				" IP addr "IPV4_ADDR_STR" "IPV4_ADDR_STR" TCP port %d %d\n",
-				__FUNCTION__, __LINE__, i, tcpack_sup_mod->tcpdata_info_cnt,
-				IPV4_ADDR_TO_STR(ntoh32_ua(&ip_hdr[IPV4_SRC_IP_OFFSET])),
-				IPV4_ADDR_TO_STR(ntoh32_ua(&ip_hdr[IPV4_DEST_IP_OFFSET])),
-				ntoh16_ua(&tcp_hdr[TCP_SRC_PORT_OFFSET]),
-				ntoh16_ua(&tcp_hdr[TCP_DEST_PORT_OFFSET])));
-			dhd_os_tcpackunlock(dhdp);
-			goto exit;
-		}
-		tcpdata_info = &tcpack_sup_mod->tcpdata_info_tbl[i];
-
-		/* No TCP flow with the same IP addr and TCP port is found
-		 * in tcp_data_info_tbl. So add this flow to the table.
-		 */
-		DHD_ERROR(("%s %d: Add data info to tbl[%d]: IP addr "IPV4_ADDR_STR" "IPV4_ADDR_STR
-			" TCP port %d %d\n",
-			__FUNCTION__, __LINE__, tcpack_sup_mod->tcpdata_info_cnt,
-			IPV4_ADDR_TO_STR(ntoh32_ua(&ip_hdr[IPV4_SRC_IP_OFFSET])),
-			IPV4_ADDR_TO_STR(ntoh32_ua(&ip_hdr[IPV4_DEST_IP_OFFSET])),
-			ntoh16_ua(&tcp_hdr[TCP_SRC_PORT_OFFSET]),
-			ntoh16_ua(&tcp_hdr[TCP_DEST_PORT_OFFSET])));
-
-		bcopy(&ip_hdr[IPV4_SRC_IP_OFFSET], tcpdata_info->src_ip_addr,
-			IPV4_ADDR_LEN * 2);
-		bcopy(&tcp_hdr[TCP_SRC_PORT_OFFSET], tcpdata_info->src_tcp_port,
-			TCP_PORT_LEN * 2);
-
-		tcpdata_info->last_used_time = OSL_SYSUPTIME();
-		tcpack_sup_mod->tcpdata_info_cnt++;
-	}
-
 	ASSERT(tcpdata_info != NULL);
 
 	tdata_psh_info = _tdata_psh_info_pool_deq(tcpack_sup_mod);
@@ -926,6 +957,7 @@ dhd_tcpdata_info_get(dhd_pub_t *dhdp, void *pkt)
 		goto exit;
 	}
 	tdata_psh_info->end_seq = end_tcp_seq_num;
+	tcpdata_info->psh_cnt++;
 
 #if defined(DEBUG_COUNTER) && defined(DHDTCPACK_SUP_DBG)
 	tack_tbl.cnt[4]++;
@@ -950,4 +982,42 @@ exit:
 	return ret;
 }
 
+void
+dhd_tcpack_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
+{
+	tcpack_sup_module_t *tcpack_sup_mod;
+	tcpack_flow_t *flow;
+	uint32 now_in_ms;
+
+	dhd_os_tcpacklock(dhdp);
+	tcpack_sup_mod = dhdp->tcpack_sup_module;
+
+	bcm_bprintf(strbuf, "tcpack_suppress %d", dhdp->tcpack_sup_mode);
+	if (!tcpack_sup_mod) {
+		bcm_bprintf(strbuf, "\n");
+		dhd_os_tcpackunlock(dhdp);
+		return;
+	}
+
+	bcm_bprintf(strbuf, " flows %d/%u in_txq %d evicted %u aged %u\n",
+		tcpack_sup_mod->flow_cnt, tcpack_sup_mod->flow_max,
+		tcpack_sup_mod->tcpack_info_cnt, tcpack_sup_mod->flow_evicted,
+		tcpack_sup_mod->flow_aged);
+
+	now_in_ms = OSL_SYSUPTIME();
+	for (flow = tcpack_sup_mod->flow_lru.lru_next; flow != &tcpack_sup_mod->flow_lru;
+		flow = flow->lru_next) {
+		bcm_bprintf(strbuf, IPV4_ADDR_STR":%d -> "IPV4_ADDR_STR":%d"
+			" ack %u sup %u psh %u%s idle %ums\n",
+			IPV4_ADDR_TO_STR(ntoh32_ua(&flow->key[0])),
+			ntoh16_ua(&flow->key[IPV4_ADDR_LEN * 2]),
+			IPV4_ADDR_TO_STR(ntoh32_ua(&flow->key[IPV4_ADDR_LEN])),
+			ntoh16_ua(&flow->key[IPV4_ADDR_LEN * 2 + TCP_PORT_LEN]),
+			flow->ack_cnt, flow->ack_sup_cnt, flow->psh_cnt,
+			flow->pkt_in_q ? " in_txq" : "", now_in_ms - flow->last_used_time);
+	}
+
+	dhd_os_tcpackunlock(dhdp);
+}
+
 #endif /* DHDTCPACK_SUPPRESS */
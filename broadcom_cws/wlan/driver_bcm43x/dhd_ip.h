@@ -50,18 +50,21 @@ extern pkt_frag_t pkt_frag_info(osl_t *osh, void *p);
 /* Size of MAX possible TCP ACK packet. Extra bytes for IP/TCP option fields */
 #define	TCPACKSZMAX	(TCPACKSZMIN + 100)
 
-/* Max number of TCP streams that have own src/dst IP addrs and TCP ports */
-#define TCPACK_INFO_MAXNUM 4
-#define TCPDATA_INFO_MAXNUM 4
-#define TCPDATA_PSH_INFO_MAXNUM (8 * TCPDATA_INFO_MAXNUM)
+/* Number of TCP streams that have own src/dst IP addrs and TCP ports, see dhd_tcpack_flows */
+#define TCPACK_FLOWS_DEFAULT 32
+#define TCPACK_FLOWS_MAX 1024
+#define TCPDATA_PSH_INFO_PER_FLOW 8
 
-#define TCPDATA_INFO_TIMEOUT 5000	/* Remove tcpdata_info if inactive for this time (in ms) */
+#define TCPDATA_INFO_TIMEOUT 5000	/* Remove a TCP stream if inactive for this time (in ms) */
+
+extern uint dhd_tcpack_flows;
 
 extern int dhd_tcpack_suppress_set(dhd_pub_t *dhdp, uint8 on);
 extern void dhd_tcpack_info_tbl_clean(dhd_pub_t *dhdp);
 extern int dhd_tcpack_check_xmit(dhd_pub_t *dhdp, void *pkt);
 extern bool dhd_tcpack_suppress(dhd_pub_t *dhdp, void *pkt);
 extern bool dhd_tcpdata_info_get(dhd_pub_t *dhdp, void *pkt);
+extern void dhd_tcpack_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf);
 
 #if defined(DEBUG_COUNTER) && defined(DHDTCPACK_SUP_DBG)
 extern counter_tbl_t tack_tbl;
@@ -47,6 +47,9 @@
 #include <linux/ip.h>
 #include <net/addrconf.h>
 #include <linux/cpufreq.h>
+#ifdef DHD_TXSTAGE
+#include <linux/percpu.h>
+#endif /* DHD_TXSTAGE */
 
 #include <asm/uaccess.h>
 #include <asm/unaligned.h>
@@ -133,7 +136,8 @@ extern bool ap_fw_loaded;
 #include <bcm_rpc.h>
 #include <bcm_rpc_tp.h>
 #endif
-#ifdef PROP_TXSTATUS
+#if defined(PROP_TXSTATUS) || defined(DHD_TXSTAGE)
+/* dhd_pkttag_t also carries the tx staging order */
 #include <wlfc_proto.h>
 #include <dhd_wlfc.h>
 #endif
@@ -195,6 +199,10 @@ MODULE_LICENSE("GPL v2");
 #endif /* BCM_FD_AGGR */
 
 #ifdef PROP_TXSTATUS
+/* Longest signal header _dhd_wlfc_pushheader() puts in front of BDC */
+#define DHD_WLFC_HDRLEN_MAX	ROUNDUP(TLV_HDR_LEN + WLFC_CTL_VALUE_LEN_PKTTAG + \
+	WLFC_CTL_VALUE_LEN_SEQ + TLV_HDR_LEN + WLFC_CTL_VALUE_LEN_PENDING_TRAFFIC_BMP, 4)
+
 extern bool dhd_wlfc_skip_fc(void);
 extern void dhd_wlfc_plat_init(void *dhd);
 extern void dhd_wlfc_plat_deinit(void *dhd);
@@ -335,6 +343,14 @@ typedef struct dhd_info {
 	struct tasklet_struct tasklet;
 	spinlock_t	sdlock;
 	spinlock_t	txqlock;
+#ifdef DHD_TXQ_LOCKSTAT
+	u64		txqlock_t0;	/* sched_clock() when txqlock was taken */
+#endif /* DHD_TXQ_LOCKSTAT */
+#ifdef DHD_TXSTAGE
+	void * __percpu	*txstage;	/* Per-CPU LIFO of tx frames, linked by PKTLINK */
+	atomic_t	txstaged;	/* Frames in all txstage lists */
+	atomic_t	txstage_seq;	/* Push order across CPUs, kept in the pkttag stage_seq */
+#endif /* DHD_TXSTAGE */
 	spinlock_t	dhd_lock;
 
 	struct semaphore sdsem;
@@ -344,6 +360,11 @@ typedef struct dhd_info {
 	tsk_ctl_t	thr_rxf_ctl;
 	spinlock_t	rxf_lock;
 	bool		rxthread_enabled;
+#ifdef DHD_NAPI
+	struct napi_struct	rx_napi;
+	struct sk_buff_head	rx_napi_queue;	/* DPC fills, dhd_napi_poll drains */
+	bool		rx_napi_enabled;
+#endif /* DHD_NAPI */
 
 	/* Wakelocks */
 #if defined(CONFIG_HAS_WAKELOCK) && (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 27))
@@ -459,6 +480,14 @@ module_param_string(nvram_path, nvram_path, MOD_PARAM_PATHLEN, 0660);
 uint dhd_watchdog_ms = 50;
 module_param(dhd_watchdog_ms, uint, 0);
 
+/* Arm the watchdog only for the bus's next deadline instead of every tick */
+uint dhd_wd_tickless = TRUE;
+module_param(dhd_wd_tickless, uint, 0644);
+
+/* Data path latency tracing: one frame in dhd_lat_sample, 0 turns it off */
+uint dhd_lat_sample = 64;
+module_param(dhd_lat_sample, uint, 0644);
+
 #if defined(DHD_DEBUG)
 /* Console poll interval */
 uint dhd_console_ms = 0;
@@ -498,6 +527,41 @@ module_param(dhd_dpc_prio, int, 0);
 int dhd_rxf_prio = CUSTOM_RXF_PRIO_SETTING;
 module_param(dhd_rxf_prio, int, 0);
 
+#ifdef DHD_TXSTAGE
+/* Stage tx frames per CPU instead of taking the txq lock in dhd_bus_txdata */
+uint dhd_txstage = TRUE;
+module_param(dhd_txstage, uint, 0);
+#endif /* DHD_TXSTAGE */
+
+#ifdef DHD_TXMQ
+/* One tx queue per AC, so flows of different ACs don't share a qdisc lock */
+#define DHD_TXMQ_NUM		AC_COUNT
+#define dhd_netif_stop_queue(net)	netif_tx_stop_all_queues(net)
+#define dhd_netif_wake_queue(net)	netif_tx_wake_all_queues(net)
+#define dhd_netif_start_queue(net)	netif_tx_start_all_queues(net)
+#else
+#define dhd_netif_stop_queue(net)	netif_stop_queue(net)
+#define dhd_netif_wake_queue(net)	netif_wake_queue(net)
+#define dhd_netif_start_queue(net)	netif_start_queue(net)
+#endif /* DHD_TXMQ */
+
+#ifdef DHD_NAPI
+/* Deliver rx through NAPI/GRO; 0 falls back to the rxf thread or netif_rx_ni */
+uint dhd_rx_napi = TRUE;
+module_param(dhd_rx_napi, uint, 0);
+
+/* NAPI poll budget */
+#define DHD_NAPI_WEIGHT		64
+#endif /* DHD_NAPI */
+
+#ifdef DHDTCPACK_SUPPRESS
+/* Max number of TCP streams tracked for TCP ACK suppression */
+module_param(dhd_tcpack_flows, uint, 0);
+#endif /* DHDTCPACK_SUPPRESS */
+
+/* Pipeline the settings sent by dhd_preinit_ioctls */
+module_param(dhd_preinit_batch, uint, 0644);
+
 #if !defined(BCMDHDUSB)
 extern int dhd_dongle_ramsize;
 module_param(dhd_dongle_ramsize, int, 0);
@@ -549,10 +613,12 @@ module_param(dhd_rxbound, uint, 0);
 extern uint dhd_deferred_tx;
 module_param(dhd_deferred_tx, uint, 0);
 
-#ifdef BCMDBGFS
+/* <debugfs>/dhd holds the files of whichever of these is built in */
+#if defined(BCMDBGFS) || defined(DHD_DBG_CONSOLE) || defined(DHD_DBG_LAT)
+#define DHD_DBGFS_DIR
 extern void dhd_dbg_init(dhd_pub_t *dhdp);
 extern void dhd_dbg_remove(void);
-#endif /* BCMDBGFS */
+#endif /* BCMDBGFS || DHD_DBG_CONSOLE || DHD_DBG_LAT */
 
 
 
@@ -673,77 +739,102 @@ extern int unregister_pm_notifier(struct notifier_block *nb);
 
 /* Request scheduling of the bus rx frame */
 static void dhd_sched_rxf(dhd_pub_t *dhdp, void *skb);
+#ifdef DHD_NAPI
+static void dhd_napi_sched(dhd_info_t *dhd, void *skb);
+#define DHD_RX_NAPI(dhd)	((dhd)->rx_napi_enabled)
+#else
+#define DHD_RX_NAPI(dhd)	FALSE
+#endif /* DHD_NAPI */
 static void dhd_os_rxflock(dhd_pub_t *pub);
 static void dhd_os_rxfunlock(dhd_pub_t *pub);
 
+/* The rxf ring has a single producer (bus DPC, dhd_sched_rxf) and a single consumer
+ * (dhd_rxf_thread), so neither side takes a lock: each only writes its own index.
+ * rxf_lock only protects rxf_pend, which collects chains while the ring is full.
+ */
 static inline int dhd_rxf_enqueue(dhd_pub_t *dhdp, void* skb)
 {
 	uint32 store_idx;
-	uint32 sent_idx;
+	uint32 depth;
 
 	if (!skb) {
 		DHD_ERROR(("dhd_rxf_enqueue: NULL skb!!!\n"));
 		return BCME_ERROR;
 	}
 
-	dhd_os_rxflock(dhdp);
 	store_idx = dhdp->store_idx;
-	sent_idx = dhdp->sent_idx;
-	if (dhdp->skbbuf[store_idx] != NULL) {
-		/* Make sure the previous packets are processed */
-		dhd_os_rxfunlock(dhdp);
-#ifdef RXF_DEQUEUE_ON_BUSY
-		DHD_TRACE(("dhd_rxf_enqueue: pktbuf not consumed %p, store idx %d sent idx %d\n",
-			skb, store_idx, sent_idx));
+	depth = (store_idx - ACCESS_ONCE(dhdp->sent_idx)) & (MAXSKBPEND - 1);
+	if (depth == MAXSKBPEND - 1)
 		return BCME_BUSY;
-#else /* RXF_DEQUEUE_ON_BUSY */
-		DHD_ERROR(("dhd_rxf_enqueue: pktbuf not consumed %p, store idx %d sent idx %d\n",
-			skb, store_idx, sent_idx));
-		/* removed msleep here, should use wait_event_timeout if we
-		 * want to give rx frame thread a chance to run
-		 */
-#if defined(WAIT_DEQUEUE)
-		OSL_SLEEP(1);
-#else
-		msleep(1);
-#endif
-		return BCME_ERROR;
-#endif /* RXF_DEQUEUE_ON_BUSY */
-	}
+
 	DHD_TRACE(("dhd_rxf_enqueue: Store SKB %p. idx %d -> %d\n",
 		skb, store_idx, (store_idx + 1) & (MAXSKBPEND - 1)));
 	dhdp->skbbuf[store_idx] = skb;
+	/* slot must be visible before the index that publishes it */
+	smp_wmb();
 	dhdp->store_idx = (store_idx + 1) & (MAXSKBPEND - 1);
-	dhd_os_rxfunlock(dhdp);
+
+	if (++depth > dhdp->rxf_hiwat)
+		dhdp->rxf_hiwat = depth;
 
 	return BCME_OK;
 }
 
 static inline void* dhd_rxf_dequeue(dhd_pub_t *dhdp)
 {
-	uint32 store_idx;
 	uint32 sent_idx;
 	void *skb;
 
-	dhd_os_rxflock(dhdp);
-
-	store_idx = dhdp->store_idx;
 	sent_idx = dhdp->sent_idx;
-	skb = dhdp->skbbuf[sent_idx];
-
-	if (skb == NULL) {
-		dhd_os_rxfunlock(dhdp);
-		DHD_ERROR(("dhd_rxf_dequeue: Dequeued packet is NULL, store idx %d sent idx %d\n",
-			store_idx, sent_idx));
+	if (sent_idx == ACCESS_ONCE(dhdp->store_idx))
 		return NULL;
-	}
 
+	/* read the slot only after seeing the index */
+	smp_rmb();
+	skb = dhdp->skbbuf[sent_idx];
 	dhdp->skbbuf[sent_idx] = NULL;
+	/* slot is free for the producer once sent_idx moves; the second barrier
+	 * pairs with the one in dhd_sched_rxf so a wakeup can't be missed
+	 */
+	smp_mb();
 	dhdp->sent_idx = (sent_idx + 1) & (MAXSKBPEND - 1);
+	smp_mb();
 
 	DHD_TRACE(("dhd_rxf_dequeue: netif_rx_ni(%p), sent idx %d\n",
 		skb, sent_idx));
 
+	return skb;
+}
+
+/* Ring full: queue the chain behind the held back ones, the rxf thread takes
+ * them all in one go after it has emptied the ring
+ */
+static void dhd_rxf_backlog(dhd_pub_t *dhdp, void *skb)
+{
+	void *tail = skb;
+
+	while (PKTNEXT(dhdp->osh, tail))
+		tail = PKTNEXT(dhdp->osh, tail);
+
+	dhd_os_rxflock(dhdp);
+	if (dhdp->rxf_pend == NULL)
+		dhdp->rxf_pend = skb;
+	else
+		PKTSETNEXT(dhdp->osh, dhdp->rxf_pend_tail, skb);
+	dhdp->rxf_pend_tail = tail;
+	dhdp->rxf_pend_cnt++;
+	dhd_os_rxfunlock(dhdp);
+}
+
+static void *dhd_rxf_backlog_get(dhd_pub_t *dhdp, uint32 *cnt)
+{
+	void *skb;
+
+	dhd_os_rxflock(dhdp);
+	skb = dhdp->rxf_pend;
+	*cnt = dhdp->rxf_pend_cnt;
+	dhdp->rxf_pend = dhdp->rxf_pend_tail = NULL;
+	dhdp->rxf_pend_cnt = 0;
 	dhd_os_rxfunlock(dhdp);
 
 	return skb;
@@ -1580,6 +1671,48 @@ uint8 prio2fifo[8] = { 1, 0, 0, 1, 2, 2, 3, 3 };
 #define WME_PRIO2AC(prio)	wme_fifo2ac[prio2fifo[(prio)]]
 
 #endif /* PROP_TXSTATUS */
+
+/* Stack skbs arrive with their own cb contents, so the trace tag is written
+ * for every frame, traced or not.
+ */
+static void
+dhd_lat_start(dhd_pub_t *dhdp, void *pktbuf)
+{
+	dhd_lat_tag_t *lat = DHD_LAT_TAG(pktbuf);
+
+	STATIC_ASSERT(DHD_LAT_TAG_OFFSET + sizeof(dhd_lat_tag_t) <=
+		sizeof(((struct sk_buff *)0)->cb));
+#ifdef PROP_TXSTATUS
+	STATIC_ASSERT(sizeof(dhd_pkttag_t) <= DHD_LAT_TAG_OFFSET);
+#endif /* PROP_TXSTATUS */
+
+	lat->t0 = dhd_lat_pick(dhdp) ? (OSL_SYSUPTIME_US() | 1) : 0;
+	lat->ts = lat->t0;
+}
+
+/* PKTTONATIVE leaves the trace tag alone, but the stack expects a clean cb:
+ * move the stamps out before the frame goes up.
+ */
+static void
+dhd_lat_rx_take(dhd_pub_t *dhdp, void *skb, dhd_lat_tag_t *lat, bool queued)
+{
+	dhd_lat_tag_t *tag = DHD_LAT_TAG(skb);
+
+	*lat = *tag;
+	if (lat->t0) {
+		tag->t0 = tag->ts = 0;
+		if (queued)
+			dhd_lat_stamp(dhdp, lat, DHD_LAT_RX_QUEUE);
+	}
+}
+
+static void
+dhd_lat_rx_given(dhd_pub_t *dhdp, dhd_lat_tag_t *lat)
+{
+	if (lat->t0)
+		dhd_lat_done(dhdp, lat, DHD_LAT_RX_STACK, DHD_LAT_RX_TOTAL);
+}
+
 int BCMFASTPATH
 dhd_sendpkt(dhd_pub_t *dhdp, int ifidx, void *pktbuf)
 {
@@ -1594,6 +1727,8 @@ dhd_sendpkt(dhd_pub_t *dhdp, int ifidx, void *pktbuf)
 		return -ENODEV;
 	}
 
+	dhd_bus_clk_early(dhdp);
+
 	/* Update multicast statistic */
 	if (PKTLEN(dhdp->osh, pktbuf) >= ETHER_HDR_LEN) {
 		uint8 *pktdata = (uint8 *)PKTDATA(dhdp->osh, pktbuf);
@@ -1685,7 +1820,7 @@ dhd_start_xmit(struct sk_buff *skb, struct net_device *net)
 	if (dhd->pub.busstate == DHD_BUS_DOWN || dhd->pub.hang_was_sent) {
 		DHD_ERROR(("%s: xmit rejected pub.up=%d busstate=%d \n",
 			__FUNCTION__, dhd->pub.up, dhd->pub.busstate));
-		netif_stop_queue(net);
+		dhd_netif_stop_queue(net);
 		/* Send Event when bus down detected during data session */
 		if (dhd->pub.up) {
 			DHD_ERROR(("%s: Event HANG sent up\n", __FUNCTION__));
@@ -1702,7 +1837,7 @@ dhd_start_xmit(struct sk_buff *skb, struct net_device *net)
 	ifidx = dhd_net2idx(dhd, net);
 	if (ifidx == DHD_BAD_IF) {
 		DHD_ERROR(("%s: bad ifidx %d\n", __FUNCTION__, ifidx));
-		netif_stop_queue(net);
+		dhd_netif_stop_queue(net);
 		DHD_OS_WAKE_UNLOCK(&dhd->pub);
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 20))
 		return -ENODEV;
@@ -1751,6 +1886,7 @@ dhd_start_xmit(struct sk_buff *skb, struct net_device *net)
 		ret = -ENOMEM;
 		goto done;
 	}
+	dhd_lat_start(&dhd->pub, pktbuf);
 #ifdef WLMEDIA_HTSF
 	if (htsfdlystat_sz && PKTLEN(dhd->pub.osh, pktbuf) >= ETHER_ADDR_LEN) {
 		uint8 *pktdata = (uint8 *)PKTDATA(dhd->pub.osh, pktbuf);
@@ -1785,6 +1921,33 @@ done:
 #endif
 }
 
+#ifdef DHD_TXMQ
+/* Map the frame to its AC queue; bus flow control still stops all of them */
+static u16
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0))
+dhd_select_queue(struct net_device *net, struct sk_buff *skb, struct net_device *sb_dev)
+#elif (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0))
+dhd_select_queue(struct net_device *net, struct sk_buff *skb, struct net_device *sb_dev,
+	select_queue_fallback_t fallback)
+#elif (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 14, 0))
+dhd_select_queue(struct net_device *net, struct sk_buff *skb, void *accel_priv,
+	select_queue_fallback_t fallback)
+#elif (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 13, 0))
+dhd_select_queue(struct net_device *net, struct sk_buff *skb, void *accel_priv)
+#else
+dhd_select_queue(struct net_device *net, struct sk_buff *skb)
+#endif
+{
+	/* same priority dhd_sendpkt will settle on */
+#ifndef PKTPRIO_OVERRIDE
+	if (PKTPRIO(skb) == 0)
+#endif
+		pktsetprio(skb, FALSE);
+
+	return (u16)WME_PRIO2AC(PKTPRIO(skb) & PRIOMASK);
+}
+#endif /* DHD_TXMQ */
+
 void
 dhd_txflowcontrol(dhd_pub_t *dhdp, int ifidx, bool state)
 {
@@ -1803,9 +1966,9 @@ dhd_txflowcontrol(dhd_pub_t *dhdp, int ifidx, bool state)
 			if (dhd->iflist[i]) {
 				net = dhd->iflist[i]->net;
 				if (state == ON)
-					netif_stop_queue(net);
+					dhd_netif_stop_queue(net);
 				else
-					netif_wake_queue(net);
+					dhd_netif_wake_queue(net);
 			}
 		}
 	}
@@ -1813,9 +1976,9 @@ dhd_txflowcontrol(dhd_pub_t *dhdp, int ifidx, bool state)
 		if (dhd->iflist[ifidx]) {
 			net = dhd->iflist[ifidx]->net;
 			if (state == ON)
-				netif_stop_queue(net);
+				dhd_netif_stop_queue(net);
 			else
-				netif_wake_queue(net);
+				dhd_netif_wake_queue(net);
 		}
 	}
 }
@@ -1866,6 +2029,7 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 	int tout_ctrl = 0;
 	void *skbhead = NULL;
 	void *skbprev = NULL;
+	dhd_lat_tag_t lat;
 #if defined(DHD_RX_DUMP) || defined(DHD_8021X_DUMP)
 	char *dump_data;
 	uint16 protocol;
@@ -2037,10 +2201,13 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 		ifp->stats.rx_packets++;
 		}
 
+		DHD_LAT_STAMP(dhdp, pktbuf, DHD_LAT_RX_PROC);
+		lat.t0 = 0;
 		if (in_interrupt()) {
+			dhd_lat_rx_take(dhdp, skb, &lat, FALSE);
 			netif_rx(skb);
 		} else {
-			if (dhd->rxthread_enabled) {
+			if (dhd->rxthread_enabled || DHD_RX_NAPI(dhd)) {
 				if (!skbhead)
 					skbhead = skb;
 				else
@@ -2055,9 +2222,11 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 				 * to do it manually.
 				 */
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 0)
+				dhd_lat_rx_take(dhdp, skb, &lat, FALSE);
 				netif_rx_ni(skb);
 #else
 				ulong flags;
+				dhd_lat_rx_take(dhdp, skb, &lat, FALSE);
 				netif_rx(skb);
 				local_irq_save(flags);
 				RAISE_RX_SOFTIRQ();
@@ -2065,8 +2234,14 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 #endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 0) */
 			}
 		}
+		dhd_lat_rx_given(dhdp, &lat);
 	}
 
+#ifdef DHD_NAPI
+	if (DHD_RX_NAPI(dhd) && skbhead)
+		dhd_napi_sched(dhd, skbhead);
+	else
+#endif /* DHD_NAPI */
 	if (dhd->rxthread_enabled && skbhead)
 		dhd_sched_rxf(dhdp, skbhead);
 
@@ -2125,6 +2300,33 @@ dhd_get_stats(struct net_device *net)
 	return &ifp->stats;
 }
 
+/* Re-arm the watchdog after a run, called with the spin lock held. lapse is
+ * the time the run took. Returns TRUE if the watchdog was stopped instead,
+ * in which case the caller drops the watchdog wake lock.
+ */
+static bool
+dhd_watchdog_rearm(dhd_info_t *dhd, unsigned long lapse)
+{
+	unsigned long tmo;
+	uint ms = dhd_watchdog_ms;
+
+	if (!dhd->wd_timer_valid)
+		return FALSE;
+
+	if (dhd_wd_tickless) {
+		ms = dhd_bus_watchdog_due(&dhd->pub);
+		if (!ms) {
+			/* dhd_os_wd_timer() starts it again on bus activity */
+			dhd->wd_timer_valid = FALSE;
+			return TRUE;
+		}
+	}
+
+	tmo = msecs_to_jiffies(ms);
+	mod_timer(&dhd->timer, jiffies + tmo - min(tmo, lapse));
+	return FALSE;
+}
+
 static int
 dhd_watchdog_thread(void *data)
 {
@@ -2145,6 +2347,7 @@ dhd_watchdog_thread(void *data)
 			unsigned long flags;
 			unsigned long jiffies_at_start = jiffies;
 			unsigned long time_lapse;
+			bool stopped = FALSE;
 
 			SMP_RD_BARRIER_DEPENDS();
 			if (tsk->terminated) {
@@ -2164,12 +2367,10 @@ dhd_watchdog_thread(void *data)
 				time_lapse = jiffies - jiffies_at_start;
 
 				/* Reschedule the watchdog */
-				if (dhd->wd_timer_valid)
-					mod_timer(&dhd->timer,
-					jiffies +
-					msecs_to_jiffies(dhd_watchdog_ms) -
-					min(msecs_to_jiffies(dhd_watchdog_ms), time_lapse));
+				stopped = dhd_watchdog_rearm(dhd, time_lapse);
 				dhd_os_spin_unlock(&dhd->pub, flags);
+				if (stopped)
+					DHD_OS_WD_WAKE_UNLOCK(&dhd->pub);
 			}
 			dhd_os_sdunlock(&dhd->pub);
 		} else {
@@ -2183,6 +2384,7 @@ static void dhd_watchdog(ulong data)
 {
 	dhd_info_t *dhd = (dhd_info_t *)data;
 	unsigned long flags;
+	bool stopped;
 
 	if (dhd->pub.dongle_reset) {
 		return;
@@ -2202,9 +2404,10 @@ static void dhd_watchdog(ulong data)
 	dhd->pub.tickcnt++;
 
 	/* Reschedule the watchdog */
-	if (dhd->wd_timer_valid)
-		mod_timer(&dhd->timer, jiffies + msecs_to_jiffies(dhd_watchdog_ms));
+	stopped = dhd_watchdog_rearm(dhd, 0);
 	dhd_os_spin_unlock(&dhd->pub, flags);
+	if (stopped)
+		DHD_OS_WD_WAKE_UNLOCK(&dhd->pub);
 	dhd_os_sdunlock(&dhd->pub);
 }
 
@@ -2346,34 +2549,48 @@ dhd_rxf_thread(void *data)
 			if (tsk->terminated) {
 				break;
 			}
-			skb = dhd_rxf_dequeue(pub);
+			pub->rxf_wakeups++;
 
-			if (skb == NULL) {
-				continue;
-			}
-			while (skb) {
-				void *skbnext = PKTNEXT(pub->osh, skb);
-				PKTSETNEXT(pub->osh, skb, NULL);
+			/* Empty the ring, then whatever piled up while it was full. Each
+			 * chain holds a wake lock taken in dhd_sched_rxf.
+			 */
+			while (1) {
+				uint32 nchains = 1;
 
+				skb = dhd_rxf_dequeue(pub);
+				if (skb == NULL && ACCESS_ONCE(pub->rxf_pend) != NULL)
+					skb = dhd_rxf_backlog_get(pub, &nchains);
+				if (skb == NULL)
+					break;
+
+				while (skb) {
+					void *skbnext = PKTNEXT(pub->osh, skb);
+					dhd_lat_tag_t lat;
+
+					PKTSETNEXT(pub->osh, skb, NULL);
+					dhd_lat_rx_take(pub, skb, &lat, TRUE);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 0)
-				netif_rx_ni(skb);
+					netif_rx_ni(skb);
 #else
-				netif_rx(skb);
-				local_irq_save(flags);
-				RAISE_RX_SOFTIRQ();
-				local_irq_restore(flags);
+					netif_rx(skb);
+					local_irq_save(flags);
+					RAISE_RX_SOFTIRQ();
+					local_irq_restore(flags);
 
 #endif
-				skb = skbnext;
-			}
+					dhd_lat_rx_given(pub, &lat);
+					skb = skbnext;
+				}
 #if defined(WAIT_DEQUEUE)
-			if (OSL_SYSUPTIME() - watchdogTime > RXF_WATCHDOG_TIME) {
-				OSL_SLEEP(1);
-				watchdogTime = OSL_SYSUPTIME();
-			}
+				if (OSL_SYSUPTIME() - watchdogTime > RXF_WATCHDOG_TIME) {
+					OSL_SLEEP(1);
+					watchdogTime = OSL_SYSUPTIME();
+				}
 #endif
 
-			DHD_OS_WAKE_UNLOCK(pub);
+				while (nchains--)
+					DHD_OS_WAKE_UNLOCK(pub);
+			}
 		}
 		else
 			break;
@@ -2423,55 +2640,136 @@ dhd_sched_dpc(dhd_pub_t *dhdp)
 	}
 }
 
+/* Maximum chains held back behind a full rxf ring, later ones are dropped */
+#define RXF_PEND_MAX	MAXSKBPEND
+
 static void
 dhd_sched_rxf(dhd_pub_t *dhdp, void *skb)
 {
 	dhd_info_t *dhd = (dhd_info_t *)dhdp->info;
-#ifdef RXF_DEQUEUE_ON_BUSY
-	int ret = BCME_OK;
-	int retry = 2;
-#endif /* RXF_DEQUEUE_ON_BUSY */
+	uint32 store_idx = dhdp->store_idx;
+	bool wake = TRUE;
 
 	DHD_OS_WAKE_LOCK(dhdp);
 
 	DHD_TRACE(("dhd_sched_rxf: Enter\n"));
-#ifdef RXF_DEQUEUE_ON_BUSY
-	do {
-		ret = dhd_rxf_enqueue(dhdp, skb);
-		if (ret == BCME_OK || ret == BCME_ERROR)
-			break;
-		else
-			OSL_SLEEP(50); /* waiting for dequeueing */
-	} while (retry-- > 0);
 
-	if (retry <= 0 && ret == BCME_BUSY) {
-		void *skbp = skb;
-
-		while (skbp) {
-			void *skbnext = PKTNEXT(dhdp->osh, skbp);
-			PKTSETNEXT(dhdp->osh, skbp, NULL);
-			netif_rx_ni(skbp);
-			skbp = skbnext;
-		}
-		DHD_ERROR(("send skb to kernel backlog without rxf_thread\n"));
-	}
-	else {
-		if (dhd->thr_rxf_ctl.thr_pid >= 0) {
-			up(&dhd->thr_rxf_ctl.sema);
+	/* once chains are held back, new ones queue behind them to keep rx order */
+	if (ACCESS_ONCE(dhdp->rxf_pend) == NULL && dhd_rxf_enqueue(dhdp, skb) == BCME_OK) {
+		/* the consumer sleeps only after catching up with store_idx, so it needs
+		 * a wakeup only if it had consumed everything before this chain
+		 */
+		smp_mb();
+		wake = (ACCESS_ONCE(dhdp->sent_idx) == store_idx);
+	} else if (dhdp->rxf_pend_cnt < RXF_PEND_MAX) {
+		dhdp->rxf_stalls++;
+		dhd_rxf_backlog(dhdp, skb);
+	} else {
+		/* rxf thread is hopelessly behind. Sending the chain up from here would
+		 * pass the held back ones, so drop it like a full netif_rx backlog
+		 * would, and still kick the thread.
+		 */
+		dhdp->rxf_stalls++;
+		dhdp->rxf_drops++;
+		while (skb) {
+			void *skbnext = PKTNEXT(dhdp->osh, skb);
+
+			/* already native, see dhd_rx_frame */
+			PKTSETNEXT(dhdp->osh, skb, NULL);
+			dev_kfree_skb_any((struct sk_buff *)skb);
+			dhdp->rx_dropped++;
+			skb = skbnext;
 		}
+		DHD_OS_WAKE_UNLOCK(dhdp);
 	}
-#else /* RXF_DEQUEUE_ON_BUSY */
-	do {
-		if (dhd_rxf_enqueue(dhdp, skb) == BCME_OK)
-			break;
-	} while (1);
-	if (dhd->thr_rxf_ctl.thr_pid >= 0) {
+
+	if (wake && dhd->thr_rxf_ctl.thr_pid >= 0) {
 		up(&dhd->thr_rxf_ctl.sema);
 	}
-	return;
-#endif /* RXF_DEQUEUE_ON_BUSY */
 }
 
+#ifdef DHD_NAPI
+/* Hand a dhd_rx_frame chain to NAPI. Called from the DPC in process context. */
+static void
+dhd_napi_sched(dhd_info_t *dhd, void *skb)
+{
+	struct sk_buff_head chain;
+	uint32 qlen;
+
+	__skb_queue_head_init(&chain);
+	while (skb) {
+		void *skbnext = PKTNEXT(dhd->pub.osh, skb);
+		PKTSETNEXT(dhd->pub.osh, skb, NULL);
+		__skb_queue_tail(&chain, (struct sk_buff *)skb);
+		skb = skbnext;
+	}
+
+	spin_lock_bh(&dhd->rx_napi_queue.lock);
+	qlen = skb_queue_len(&dhd->rx_napi_queue);
+	if (qlen >= netdev_max_backlog) {
+		/* same limit netif_rx applies to its backlog */
+		spin_unlock_bh(&dhd->rx_napi_queue.lock);
+		dhd->pub.rx_dropped += skb_queue_len(&chain);
+		__skb_queue_purge(&chain);
+		return;
+	}
+	skb_queue_splice_tail_init(&chain, &dhd->rx_napi_queue);
+	qlen = skb_queue_len(&dhd->rx_napi_queue);
+	if (qlen > dhd->pub.rx_napi_hiwat)
+		dhd->pub.rx_napi_hiwat = qlen;
+	spin_unlock_bh(&dhd->rx_napi_queue.lock);
+
+	/* run the poll on bh enable, as netif_rx_ni would */
+	local_bh_disable();
+	napi_schedule(&dhd->rx_napi);
+	local_bh_enable();
+}
+
+static int
+dhd_napi_poll(struct napi_struct *napi, int budget)
+{
+	dhd_info_t *dhd = container_of(napi, dhd_info_t, rx_napi);
+	struct sk_buff_head process;
+	struct sk_buff *skb;
+	int work = 0;
+
+	__skb_queue_head_init(&process);
+
+	spin_lock(&dhd->rx_napi_queue.lock);
+	skb_queue_splice_tail_init(&dhd->rx_napi_queue, &process);
+	spin_unlock(&dhd->rx_napi_queue.lock);
+
+	while (work < budget && (skb = __skb_dequeue(&process)) != NULL) {
+		dhd_lat_tag_t lat;
+
+		dhd_lat_rx_take(&dhd->pub, skb, &lat, TRUE);
+		napi_gro_receive(napi, skb);
+		dhd_lat_rx_given(&dhd->pub, &lat);
+		work++;
+	}
+
+	dhd->pub.rx_napi_polls++;
+	dhd->pub.rx_napi_pkts += work;
+
+	if (!skb_queue_empty(&process)) {
+		/* over budget, put the rest back in front of newer frames */
+		spin_lock(&dhd->rx_napi_queue.lock);
+		skb_queue_splice_init(&process, &dhd->rx_napi_queue);
+		spin_unlock(&dhd->rx_napi_queue.lock);
+		dhd->pub.rx_napi_budget_out++;
+	}
+
+	if (work < budget) {
+		napi_complete(napi);
+		/* catch a chain queued after the splice above */
+		if (!skb_queue_empty(&dhd->rx_napi_queue))
+			napi_schedule(napi);
+	}
+
+	return work;
+}
+#endif /* DHD_NAPI */
+
 #ifdef TOE
 /* Retrieve current toe component enables, which are kept as a bitmap in toe_ol iovar */
 static int
@@ -2984,7 +3282,7 @@ dhd_stop(struct net_device *net)
 	BCM_REFERENCE(ifidx);
 
 	/* Set state and stop OS transmissions */
-	netif_stop_queue(net);
+	dhd_netif_stop_queue(net);
 	dhd->pub.up = 0;
 
 #ifdef ENABLE_CONTROL_SCHED
@@ -3241,10 +3539,10 @@ dhd_open(struct net_device *net)
 	}
 
 	/* Allow transmit calls */
-	netif_start_queue(net);
+	dhd_netif_start_queue(net);
 	dhd->pub.up = 1;
 
-#ifdef BCMDBGFS
+#ifdef DHD_DBGFS_DIR
 	dhd_dbg_init(&dhd->pub);
 #endif
 
@@ -3364,7 +3662,7 @@ dhd_allocate_if(dhd_pub_t *dhdpub, int ifidx, char *name,
 			if (ifp->net->reg_state == NETREG_UNINITIALIZED) {
 				free_netdev(ifp->net);
 			} else {
-				netif_stop_queue(ifp->net);
+				dhd_netif_stop_queue(ifp->net);
 				if (need_rtnl_lock)
 					unregister_netdev(ifp->net);
 				else
@@ -3388,7 +3686,11 @@ dhd_allocate_if(dhd_pub_t *dhdpub, int ifidx, char *name,
 		memcpy(&ifp->mac_addr, mac, ETHER_ADDR_LEN);
 
 	/* Allocate etherdev, including space for private structure */
+#ifdef DHD_TXMQ
+	ifp->net = alloc_etherdev_mq(sizeof(dhdinfo), DHD_TXMQ_NUM);
+#else
 	ifp->net = alloc_etherdev(sizeof(dhdinfo));
+#endif /* DHD_TXMQ */
 	if (ifp->net == NULL) {
 		DHD_ERROR(("%s: OOM - alloc_etherdev(%zu)\n", __FUNCTION__, sizeof(dhdinfo)));
 		goto fail;
@@ -3444,7 +3746,7 @@ dhd_remove_if(dhd_pub_t *dhdpub, int ifidx, bool need_rtnl_lock)
 			if (ifp->net->reg_state == NETREG_UNINITIALIZED) {
 				free_netdev(ifp->net);
 			} else {
-				netif_stop_queue(ifp->net);
+				dhd_netif_stop_queue(ifp->net);
 
 				if (need_rtnl_lock)
 					unregister_netdev(ifp->net);
@@ -3469,6 +3771,9 @@ static struct net_device_ops dhd_ops_pri = {
 	.ndo_get_stats = dhd_get_stats,
 	.ndo_do_ioctl = dhd_ioctl_entry,
 	.ndo_start_xmit = dhd_start_xmit,
+#ifdef DHD_TXMQ
+	.ndo_select_queue = dhd_select_queue,
+#endif /* DHD_TXMQ */
 	.ndo_set_mac_address = dhd_set_mac_address,
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 2, 0))
 	.ndo_set_rx_mode = dhd_set_multicast_list,
@@ -3481,6 +3786,9 @@ static struct net_device_ops dhd_ops_virt = {
 	.ndo_get_stats = dhd_get_stats,
 	.ndo_do_ioctl = dhd_ioctl_entry,
 	.ndo_start_xmit = dhd_start_xmit,
+#ifdef DHD_TXMQ
+	.ndo_select_queue = dhd_select_queue,
+#endif /* DHD_TXMQ */
 	.ndo_set_mac_address = dhd_set_mac_address,
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 2, 0))
 	.ndo_set_rx_mode = dhd_set_multicast_list,
@@ -3525,6 +3833,16 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 	memset(dhd, 0, sizeof(dhd_info_t));
 	dhd_state |= DHD_ATTACH_STATE_DHD_ALLOC;
 
+#ifdef DHD_TXSTAGE
+	atomic_set(&dhd->txstaged, 0);
+	atomic_set(&dhd->txstage_seq, 0);
+	if (dhd_txstage) {
+		dhd->txstage = alloc_percpu(void *);
+		if (dhd->txstage == NULL)
+			DHD_ERROR(("%s: no tx staging, alloc_percpu failed\n", __FUNCTION__));
+	}
+#endif /* DHD_TXSTAGE */
+
 	dhd->pub.osh = osh;
 	dhd->adapter = adapter;
 
@@ -3593,6 +3911,16 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 #if defined(RXFRAME_THREAD)
 	dhd->rxthread_enabled = TRUE;
 #endif /* defined(RXFRAME_THREAD) */
+#ifdef DHD_NAPI
+	skb_queue_head_init(&dhd->rx_napi_queue);
+	if (dhd_rx_napi) {
+		/* NAPI takes over from the rxf thread */
+		dhd->rxthread_enabled = FALSE;
+		netif_napi_add(net, &dhd->rx_napi, dhd_napi_poll, DHD_NAPI_WEIGHT);
+		napi_enable(&dhd->rx_napi);
+		dhd->rx_napi_enabled = TRUE;
+	}
+#endif /* DHD_NAPI */
 
 #ifdef DHDTCPACK_SUPPRESS
 	spin_lock_init(&dhd->tcpack_lock);
@@ -3678,6 +4006,9 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 		bzero(&dhd->pub.skbbuf[0], sizeof(void *) * MAXSKBPEND);
 		/* Initialize RXF thread */
 		PROC_START(dhd_rxf_thread, dhd, &dhd->thr_rxf_ctl, 0, "dhd_rxf");
+	} else {
+		/* NAPI or no rxf thread: nothing for dhd_os_shutdown/dhd_detach to stop */
+		dhd->thr_rxf_ctl.thr_pid = -1;
 	}
 
 	dhd_state |= DHD_ATTACH_STATE_THREADS_CREATED;
@@ -4106,6 +4437,7 @@ dhd_preinit_ioctls(dhd_pub_t *dhd)
 	char eventmask[WL_EVENTING_MASK_LEN];
 	char iovbuf[WL_EVENTING_MASK_LEN + 12];	/*  Room for "event_msgs" + '\0' + bitvec  */
 	uint32 buf_key_b4_m4 = 1;
+	uint32 preinit_start = OSL_SYSUPTIME();
 #if defined(CUSTOM_AMPDU_BA_WSIZE)
 	uint32 ampdu_ba_wsize = 0;
 #endif 
@@ -4342,40 +4674,42 @@ dhd_preinit_ioctls(dhd_pub_t *dhd)
 
 	DHD_ERROR(("Firmware up: op_mode=0x%04x, MAC="MACDBG"\n",
 		dhd->op_mode, MAC2STRDBG(dhd->mac.octet)));
-	/* Set Country code  */
-	if (dhd->dhd_cspec.ccode[0] != 0) {
-		bcm_mkiovar("country", (char *)&dhd->dhd_cspec,
-			sizeof(wl_country_t), iovbuf, sizeof(iovbuf));
-		if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0)) < 0)
-			DHD_ERROR(("%s: country code setting failed\n", __FUNCTION__));
-	}
 
+	/* The plain settings below do not depend on each other's result, so they
+	 * are sent without waiting for each response and collected by
+	 * dhd_iov_batch_flush() before the event mask is read back.
+	 */
+	dhd_iov_batch_begin(dhd);
+
+	/* Set Country code  */
+	if (dhd->dhd_cspec.ccode[0] != 0)
+		dhd_iov_batch_iovar(dhd, "country", &dhd->dhd_cspec, sizeof(wl_country_t));
 
 	/* Set Listen Interval */
-	bcm_mkiovar("assoc_listen", (char *)&listen_interval, 4, iovbuf, sizeof(iovbuf));
-	if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0)) < 0)
-		DHD_ERROR(("%s assoc_listen failed %d\n", __FUNCTION__, ret));
+	dhd_iov_batch_iovar(dhd, "assoc_listen", &listen_interval, 4);
 
 #if defined(ROAM_ENABLE) || defined(DISABLE_BUILTIN_ROAM)
 	/* Disable built-in roaming to allowed ext supplicant to take care of roaming */
-	bcm_mkiovar("roam_off", (char *)&roamvar, 4, iovbuf, sizeof(iovbuf));
-	dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0);
+	dhd_iov_batch_iovar(dhd, "roam_off", &roamvar, 4);
 #endif /* ROAM_ENABLE || DISABLE_BUILTIN_ROAM */
 #if defined(ROAM_ENABLE)
-	if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_ROAM_TRIGGER, roam_trigger,
-		sizeof(roam_trigger), TRUE, 0)) < 0)
-		DHD_ERROR(("%s: roam trigger set failed %d\n", __FUNCTION__, ret));
-	if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_ROAM_SCAN_PERIOD, roam_scan_period,
-		sizeof(roam_scan_period), TRUE, 0)) < 0)
-		DHD_ERROR(("%s: roam scan period set failed %d\n", __FUNCTION__, ret));
-	if ((dhd_wl_ioctl_cmd(dhd, WLC_SET_ROAM_DELTA, roam_delta,
-		sizeof(roam_delta), TRUE, 0)) < 0)
-		DHD_ERROR(("%s: roam delta set failed %d\n", __FUNCTION__, ret));
-	bcm_mkiovar("fullroamperiod", (char *)&roam_fullscan_period, 4, iovbuf, sizeof(iovbuf));
-	if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0)) < 0)
-		DHD_ERROR(("%s: roam fullscan period set failed %d\n", __FUNCTION__, ret));
+	dhd_iov_batch_add(dhd, "roam trigger", WLC_SET_ROAM_TRIGGER, roam_trigger,
+		sizeof(roam_trigger));
+	dhd_iov_batch_add(dhd, "roam scan period", WLC_SET_ROAM_SCAN_PERIOD, roam_scan_period,
+		sizeof(roam_scan_period));
+	dhd_iov_batch_add(dhd, "roam delta", WLC_SET_ROAM_DELTA, roam_delta,
+		sizeof(roam_delta));
+	dhd_iov_batch_iovar(dhd, "fullroamperiod", &roam_fullscan_period, 4);
 #endif /* ROAM_ENABLE */
 
+#if defined(WLTDLS) || defined(DHD_ENABLE_LPC)
+	/* TDLS and lpc are plain ioctls and lpc may take the dongle down, so let
+	 * the settings above land first
+	 */
+	if ((ret = dhd_iov_batch_flush(dhd)) < 0)
+		DHD_ERROR(("%s: settings failed %d\n", __FUNCTION__, ret));
+#endif /* WLTDLS || DHD_ENABLE_LPC */
+
 #ifdef WLTDLS
 	/* by default TDLS on and auto mode off */
 	_dhd_tdls_enable(dhd, true, false, NULL);
@@ -4417,43 +4751,36 @@ dhd_preinit_ioctls(dhd_pub_t *dhd)
 #endif /* DHD_ENABLE_LPC */
 
 	/* Set PowerSave mode */
-	dhd_wl_ioctl_cmd(dhd, WLC_SET_PM, (char *)&power_mode, sizeof(power_mode), TRUE, 0);
+	dhd_iov_batch_add(dhd, "PM", WLC_SET_PM, &power_mode, sizeof(power_mode));
 
 	/* Match Host and Dongle rx alignment */
-	bcm_mkiovar("bus:txglomalign", (char *)&dongle_align, 4, iovbuf, sizeof(iovbuf));
-	dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0);
+	dhd_iov_batch_iovar(dhd, "bus:txglomalign", &dongle_align, 4);
 
 #if defined(CUSTOMER_HW2) && defined(USE_WL_CREDALL)
 	/* enable credall to reduce the chance of no bus credit happened. */
-	bcm_mkiovar("bus:credall", (char *)&credall, 4, iovbuf, sizeof(iovbuf));
-	dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0);
+	dhd_iov_batch_iovar(dhd, "bus:credall", &credall, 4);
 #endif
 
 	if (glom != DEFAULT_GLOM_VALUE) {
 		DHD_INFO(("%s set glom=0x%X\n", __FUNCTION__, glom));
-		bcm_mkiovar("bus:txglom", (char *)&glom, 4, iovbuf, sizeof(iovbuf));
-		dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0);
+		dhd_iov_batch_iovar(dhd, "bus:txglom", &glom, 4);
 	}
 
 	/* Setup timeout if Beacons are lost and roam is off to report link down */
-	bcm_mkiovar("bcn_timeout", (char *)&bcn_timeout, 4, iovbuf, sizeof(iovbuf));
-	dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0);
+	dhd_iov_batch_iovar(dhd, "bcn_timeout", &bcn_timeout, 4);
 	/* Setup assoc_retry_max count to reconnect target AP in dongle */
-	bcm_mkiovar("assoc_retry_max", (char *)&retry_max, 4, iovbuf, sizeof(iovbuf));
-	dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0);
+	dhd_iov_batch_iovar(dhd, "assoc_retry_max", &retry_max, 4);
 #if defined(AP) && !defined(WLP2P)
 	/* Turn off MPC in AP mode */
-	bcm_mkiovar("mpc", (char *)&mpc, 4, iovbuf, sizeof(iovbuf));
-	dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0);
-	bcm_mkiovar("apsta", (char *)&apsta, 4, iovbuf, sizeof(iovbuf));
-	dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0);
+	dhd_iov_batch_iovar(dhd, "mpc", &mpc, 4);
+	dhd_iov_batch_iovar(dhd, "apsta", &apsta, 4);
 #endif /* defined(AP) && !defined(WLP2P) */
 
 
 
 #if defined(SOFTAP)
 	if (ap_fw_loaded == TRUE) {
-		dhd_wl_ioctl_cmd(dhd, WLC_SET_DTIMPRD, (char *)&dtim, sizeof(dtim), TRUE, 0);
+		dhd_iov_batch_add(dhd, "dtim", WLC_SET_DTIMPRD, &dtim, sizeof(dtim));
 	}
 #endif 
 
@@ -4462,6 +4789,10 @@ dhd_preinit_ioctls(dhd_pub_t *dhd)
 	/* Set Keep Alive : be sure to use FW with -keepalive */
 	int res;
 
+	/* keep alive is a plain ioctl, drain the batch for it */
+	if ((res = dhd_iov_batch_flush(dhd)) < 0)
+		DHD_ERROR(("%s: settings failed %d\n", __FUNCTION__, res));
+
 #if defined(SOFTAP)
 	if (ap_fw_loaded == FALSE)
 #endif 
@@ -4474,11 +4805,7 @@ dhd_preinit_ioctls(dhd_pub_t *dhd)
 	}
 #endif /* defined(KEEP_ALIVE) */
 #ifdef USE_WL_TXBF
-	bcm_mkiovar("txbf", (char *)&txbf, 4, iovbuf, sizeof(iovbuf));
-	if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf,
-		sizeof(iovbuf), TRUE, 0)) < 0) {
-		DHD_ERROR(("%s Set txbf failed  %d\n", __FUNCTION__, ret));
-	}
+	dhd_iov_batch_iovar(dhd, "txbf", &txbf, 4);
 #endif /* USE_WL_TXBF */
 #ifdef USE_WL_FRAMEBURST
 #ifdef DISABLE_WL_FRAMEBURST_SOFTAP
@@ -4488,53 +4815,31 @@ dhd_preinit_ioctls(dhd_pub_t *dhd)
 	}
 #endif /* DISABLE_WL_FRAMEBURST_SOFTAP */
 	/* Set frameburst to value */
-	if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_FAKEFRAG, (char *)&frameburst,
-		sizeof(frameburst), TRUE, 0)) < 0) {
-		DHD_ERROR(("%s Set frameburst failed  %d\n", __FUNCTION__, ret));
-	}
+	dhd_iov_batch_add(dhd, "frameburst", WLC_SET_FAKEFRAG, &frameburst, sizeof(frameburst));
 #endif /* USE_WL_FRAMEBURST */
 #if defined(CUSTOM_AMPDU_BA_WSIZE)
 	/* Set ampdu ba wsize to 64 or 16 */
 #ifdef CUSTOM_AMPDU_BA_WSIZE
 	ampdu_ba_wsize = CUSTOM_AMPDU_BA_WSIZE;
 #endif
-	if (ampdu_ba_wsize != 0) {
-		bcm_mkiovar("ampdu_ba_wsize", (char *)&ampdu_ba_wsize, 4, iovbuf, sizeof(iovbuf));
-		if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf,
-			sizeof(iovbuf), TRUE, 0)) < 0) {
-			DHD_ERROR(("%s Set ampdu_ba_wsize to %d failed  %d\n",
-				__FUNCTION__, ampdu_ba_wsize, ret));
-		}
-	}
+	if (ampdu_ba_wsize != 0)
+		dhd_iov_batch_iovar(dhd, "ampdu_ba_wsize", &ampdu_ba_wsize, 4);
 #endif 
 #if defined(CUSTOM_AMPDU_MPDU)
 	ampdu_mpdu = CUSTOM_AMPDU_MPDU;
-	if (ampdu_mpdu != 0 && (ampdu_mpdu <= ampdu_ba_wsize)) {
-		bcm_mkiovar("ampdu_mpdu", (char *)&ampdu_mpdu, 4, iovbuf, sizeof(iovbuf));
-		if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf,
-			sizeof(iovbuf), TRUE, 0)) < 0) {
-			DHD_ERROR(("%s Set ampdu_mpdu to %d failed  %d\n",
-				__FUNCTION__, CUSTOM_AMPDU_MPDU, ret));
-		}
-	}
+	if (ampdu_mpdu != 0 && (ampdu_mpdu <= ampdu_ba_wsize))
+		dhd_iov_batch_iovar(dhd, "ampdu_mpdu", &ampdu_mpdu, 4);
 #endif /* CUSTOM_AMPDU_MPDU */
 
 #ifdef CUSTOM_PSPRETEND_THR
 	/* Turn off MPC in AP mode */
-	bcm_mkiovar("pspretend_threshold", (char *)&pspretend_thr, 4,
-		iovbuf, sizeof(iovbuf));
-	if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf,
-		sizeof(iovbuf), TRUE, 0)) < 0) {
-		DHD_ERROR(("%s pspretend_threshold for HostAPD failed  %d\n",
-			__FUNCTION__, ret));
-	}
+	dhd_iov_batch_iovar(dhd, "pspretend_threshold", &pspretend_thr, 4);
 #endif
 
-	bcm_mkiovar("buf_key_b4_m4", (char *)&buf_key_b4_m4, 4, iovbuf, sizeof(iovbuf));
-	if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf,
-		sizeof(iovbuf), TRUE, 0)) < 0) {
-		DHD_ERROR(("%s buf_key_b4_m4 set failed %d\n", __FUNCTION__, ret));
-	}
+	dhd_iov_batch_iovar(dhd, "buf_key_b4_m4", &buf_key_b4_m4, 4);
+
+	if ((ret = dhd_iov_batch_flush(dhd)) < 0)
+		DHD_ERROR(("%s: settings failed %d\n", __FUNCTION__, ret));
 
 	/* Read event_msgs mask */
 	bcm_mkiovar("event_msgs", eventmask, WL_EVENTING_MASK_LEN, iovbuf, sizeof(iovbuf));
@@ -4601,12 +4906,18 @@ dhd_preinit_ioctls(dhd_pub_t *dhd)
 		goto done;
 	}
 
-	dhd_wl_ioctl_cmd(dhd, WLC_SET_SCAN_CHANNEL_TIME, (char *)&scan_assoc_time,
-		sizeof(scan_assoc_time), TRUE, 0);
-	dhd_wl_ioctl_cmd(dhd, WLC_SET_SCAN_UNASSOC_TIME, (char *)&scan_unassoc_time,
-		sizeof(scan_unassoc_time), TRUE, 0);
-	dhd_wl_ioctl_cmd(dhd, WLC_SET_SCAN_PASSIVE_TIME, (char *)&scan_passive_time,
-		sizeof(scan_passive_time), TRUE, 0);
+	dhd_iov_batch_add(dhd, "scan_assoc_time", WLC_SET_SCAN_CHANNEL_TIME, &scan_assoc_time,
+		sizeof(scan_assoc_time));
+	dhd_iov_batch_add(dhd, "scan_unassoc_time", WLC_SET_SCAN_UNASSOC_TIME,
+		&scan_unassoc_time, sizeof(scan_unassoc_time));
+	dhd_iov_batch_add(dhd, "scan_passive_time", WLC_SET_SCAN_PASSIVE_TIME,
+		&scan_passive_time, sizeof(scan_passive_time));
+
+#if defined(ARP_OFFLOAD_SUPPORT) || defined(PKT_FILTER_SUPPORT)
+	/* ARP offload and packet filters go out as plain ioctls */
+	if ((ret = dhd_iov_batch_flush(dhd)) < 0)
+		DHD_ERROR(("%s: settings failed %d\n", __FUNCTION__, ret));
+#endif /* ARP_OFFLOAD_SUPPORT || PKT_FILTER_SUPPORT */
 
 #ifdef ARP_OFFLOAD_SUPPORT
 	/* Set and enable ARP offload feature for STA only  */
@@ -4667,11 +4978,11 @@ dhd_preinit_ioctls(dhd_pub_t *dhd)
 	dhd_set_packet_filter(dhd);
 #endif /* PKT_FILTER_SUPPORT */
 #ifdef DISABLE_11N
-	bcm_mkiovar("nmode", (char *)&nmode, 4, iovbuf, sizeof(iovbuf));
-	if ((ret = dhd_wl_ioctl_cmd(dhd, WLC_SET_VAR, iovbuf, sizeof(iovbuf), TRUE, 0)) < 0)
-		DHD_ERROR(("%s wl nmode 0 failed %d\n", __FUNCTION__, ret));
+	dhd_iov_batch_iovar(dhd, "nmode", &nmode, 4);
 #endif /* DISABLE_11N */
 
+	if ((ret = dhd_iov_batch_flush(dhd)) < 0)
+		DHD_ERROR(("%s: settings failed %d\n", __FUNCTION__, ret));
 
 	/* query for 'ver' to get version info from firmware */
 	memset(buf, 0, sizeof(buf));
@@ -4750,6 +5061,9 @@ dhd_preinit_ioctls(dhd_pub_t *dhd)
 #endif /* WL11U */
 
 done:
+	dhd->preinit_ms = OSL_SYSUPTIME() - preinit_start;
+	DHD_ERROR(("%s: done in %u ms, %u ioctls pipelined\n", __FUNCTION__,
+		dhd->preinit_ms, dhd->iov_batch.queued));
 	return ret;
 }
 
@@ -5133,6 +5447,14 @@ dhd_register_if(dhd_pub_t *dhdp, int ifidx, bool need_rtnl_lock)
 	net->hard_header_len = ETH_HLEN + dhd->pub.hdrlen;
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 24)
 	net->ethtool_ops = &dhd_ethtool_ops;
+	/* hdrlen's DHD_SDALIGN slack is not enough once wlfc signals and glom
+	 * headers are pushed; reserve that too, plus tail room for bus padding
+	 */
+	net->needed_headroom = dhd->pub.tx_headroom;
+#ifdef PROP_TXSTATUS
+	net->needed_headroom += DHD_WLFC_HDRLEN_MAX;
+#endif /* PROP_TXSTATUS */
+	net->needed_tailroom = dhd->pub.tx_tailroom;
 #endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 24) */
 
 #if defined(WL_WIRELESS_EXT)
@@ -5238,6 +5560,9 @@ void dhd_detach(dhd_pub_t *dhdp)
 	DHD_TRACE(("%s: Enter state 0x%x\n", __FUNCTION__, dhd->dhd_state));
 
 	dhd->pub.up = 0;
+#ifdef DHD_DBGFS_DIR
+	dhd_dbg_remove();
+#endif
 	if (!(dhd->dhd_state & DHD_ATTACH_STATE_DONE)) {
 		/* Give sufficient time for threads to start running in case
 		 * dhd_attach() has failed
@@ -5252,6 +5577,21 @@ void dhd_detach(dhd_pub_t *dhdp)
 			dhd_prot_detach(dhdp);
 	}
 
+#ifdef DHD_TXSTAGE
+	if (dhd->txstage) {
+		uint cnt;
+		void *pkt, *next;
+
+		for (pkt = dhd_os_txstage_pull(dhdp, &cnt); pkt; pkt = next) {
+			next = PKTLINK(pkt);
+			PKTSETLINK(pkt, NULL);
+			PKTFREE(dhdp->osh, pkt, TRUE);
+		}
+		free_percpu(dhd->txstage);
+		dhd->txstage = NULL;
+	}
+#endif /* DHD_TXSTAGE */
+
 #ifdef ARP_OFFLOAD_SUPPORT
 	if (dhd_inetaddr_notifier_registered) {
 		dhd_inetaddr_notifier_registered = FALSE;
@@ -5290,6 +5630,15 @@ void dhd_detach(dhd_pub_t *dhdp)
 		}
 		dhd_net_if_unlock_local(dhd);
 
+#ifdef DHD_NAPI
+		if (dhd->rx_napi_enabled) {
+			napi_disable(&dhd->rx_napi);
+			netif_napi_del(&dhd->rx_napi);
+			dhd->rx_napi_enabled = FALSE;
+		}
+		skb_queue_purge(&dhd->rx_napi_queue);
+#endif /* DHD_NAPI */
+
 		/*  delete primary interface 0 */
 		ifp = dhd->iflist[0];
 		ASSERT(ifp);
@@ -5703,6 +6052,43 @@ dhd_os_close_image(void *image)
 }
 #endif /* !LINUX_FW_REQUEST_API || !ENABLE_INSMOD_NO_FW_LOAD */
 
+/* Image read-ahead so the file read overlaps the SDIO write of the previous block */
+static struct {
+	struct work_struct work;
+	struct completion done;
+	void *image;
+	char *buf;
+	int len;
+	int ret;
+} dhd_image_rd;
+
+static void
+dhd_os_image_rd_work(struct work_struct *work)
+{
+	dhd_image_rd.ret = dhd_os_get_image_block(dhd_image_rd.buf, dhd_image_rd.len,
+		dhd_image_rd.image);
+	complete(&dhd_image_rd.done);
+}
+
+void
+dhd_os_get_image_block_async(char *buf, int len, void *image)
+{
+	dhd_image_rd.image = image;
+	dhd_image_rd.buf = buf;
+	dhd_image_rd.len = len;
+	dhd_image_rd.ret = 0;
+	init_completion(&dhd_image_rd.done);
+	INIT_WORK(&dhd_image_rd.work, dhd_os_image_rd_work);
+	schedule_work(&dhd_image_rd.work);
+}
+
+int
+dhd_os_get_image_block_wait(void)
+{
+	wait_for_completion(&dhd_image_rd.done);
+	return dhd_image_rd.ret;
+}
+
 void
 dhd_os_sdlock(dhd_pub_t *pub)
 {
@@ -5735,18 +6121,153 @@ dhd_os_sdlock_txq(dhd_pub_t *pub)
 	dhd_info_t *dhd;
 
 	dhd = (dhd_info_t *)(pub->info);
+#ifdef DHD_TXQ_LOCKSTAT
+	if (!spin_trylock_bh(&dhd->txqlock)) {
+		spin_lock_bh(&dhd->txqlock);
+		pub->txq_lock_contended++;
+	}
+	pub->txq_lock_cnt++;
+	dhd->txqlock_t0 = sched_clock();
+#else
 	spin_lock_bh(&dhd->txqlock);
+#endif /* DHD_TXQ_LOCKSTAT */
 }
 
 void
 dhd_os_sdunlock_txq(dhd_pub_t *pub)
 {
 	dhd_info_t *dhd;
+#ifdef DHD_TXQ_LOCKSTAT
+	uint32 hold;
+#endif /* DHD_TXQ_LOCKSTAT */
 
 	dhd = (dhd_info_t *)(pub->info);
+#ifdef DHD_TXQ_LOCKSTAT
+	hold = (uint32)(sched_clock() - dhd->txqlock_t0);
+	pub->txq_lock_hold_ns += hold;
+	if (hold > pub->txq_lock_hold_max)
+		pub->txq_lock_hold_max = hold;
+#endif /* DHD_TXQ_LOCKSTAT */
 	spin_unlock_bh(&dhd->txqlock);
 }
 
+#ifdef DHD_TXSTAGE
+/* Push order, kept in the pkttag. 16 bits are plenty: flow control stops the
+ * producers long before 32K frames are staged at once.
+ */
+#define DHD_TXSTAGE_BEFORE(a, b) \
+	((int16)(DHD_PKTTAG_STAGESEQ(PKTTAG(a)) - DHD_PKTTAG_STAGESEQ(PKTTAG(b))) < 0)
+
+/* Push onto this CPU's staging list. Producers on other CPUs never touch it, the
+ * cmpxchg only races with the DPC taking the whole list in dhd_os_txstage_pull.
+ * Bottom halves are off so the sequence and the push are not split by another
+ * producer on this CPU, which keeps every list in sequence order.
+ */
+bool
+dhd_os_txstage_push(dhd_pub_t *pub, void *pkt)
+{
+	dhd_info_t *dhd = (dhd_info_t *)(pub->info);
+	void **head;
+	void *old;
+
+	if (dhd->txstage == NULL)
+		return FALSE;
+
+	/* count first, so the DPC never sees a frame it has not been told about */
+	atomic_inc(&dhd->txstaged);
+	local_bh_disable();
+	head = get_cpu_ptr(dhd->txstage);
+	DHD_PKTTAG_SET_STAGESEQ(PKTTAG(pkt), (uint16)atomic_inc_return(&dhd->txstage_seq));
+	do {
+		old = ACCESS_ONCE(*head);
+		PKTSETLINK(pkt, old);
+	} while (cmpxchg(head, old, pkt) != old);
+	put_cpu_ptr(dhd->txstage);
+	local_bh_enable();
+
+	return TRUE;
+}
+
+/* Merge two PKTLINK lists that are each in push order */
+static void *
+dhd_txstage_merge(void *a, void *b)
+{
+	void *head = NULL, *tail = NULL, *p;
+
+	while (a && b) {
+		if (DHD_TXSTAGE_BEFORE(b, a)) {
+			p = b;
+			b = PKTLINK(b);
+		} else {
+			p = a;
+			a = PKTLINK(a);
+		}
+		if (tail)
+			PKTSETLINK(tail, p);
+		else
+			head = p;
+		tail = p;
+	}
+	p = a ? a : b;
+	if (tail)
+		PKTSETLINK(tail, p);
+	else
+		head = p;
+
+	return head;
+}
+
+/* Take every CPU's list and return the frames in push order, linked by PKTLINK,
+ * so a flow that moved between CPUs is not reordered.
+ */
+void *
+dhd_os_txstage_pull(dhd_pub_t *pub, uint *cnt)
+{
+	dhd_info_t *dhd = (dhd_info_t *)(pub->info);
+	void *chain = NULL;
+	uint n = 0;
+	int cpu;
+
+	*cnt = 0;
+	if (dhd->txstage == NULL)
+		return NULL;
+
+	for_each_possible_cpu(cpu) {
+		void *p = xchg(per_cpu_ptr(dhd->txstage, cpu), NULL);
+		void *fifo = NULL;
+
+		while (p) {
+			void *next = PKTLINK(p);
+			PKTSETLINK(p, fifo);
+			fifo = p;
+			p = next;
+			n++;
+		}
+		if (fifo)
+			chain = chain ? dhd_txstage_merge(chain, fifo) : fifo;
+	}
+
+	if (n) {
+		atomic_sub(n, &dhd->txstaged);
+		pub->txstage_pulls++;
+		pub->txstage_pkts += n;
+		if (n > pub->txstage_hiwat)
+			pub->txstage_hiwat = n;
+	}
+	*cnt = n;
+
+	return chain;
+}
+
+uint
+dhd_os_txstage_len(dhd_pub_t *pub)
+{
+	dhd_info_t *dhd = (dhd_info_t *)(pub->info);
+
+	return (uint)atomic_read(&dhd->txstaged);
+}
+#endif /* DHD_TXSTAGE */
+
 void
 dhd_os_sdlock_rxq(dhd_pub_t *pub)
 {
@@ -5877,6 +6398,7 @@ dhd_wl_host_event(dhd_info_t *dhd, int *ifidx, void *pktdata,
 	if (dhd->iflist[*ifidx]->net)
 		wl_cfg80211_event(dhd->iflist[*ifidx]->net, event, *data);
 #endif /* defined(WL_CFG80211) */
+	dhd->pub.evt_rx_us = 0;
 
 	return (bcmerror);
 }
@@ -6944,16 +7466,19 @@ bool dhd_wlfc_skip_fc(void)
 }
 #endif /* PROP_TXSTATUS */
 
-#ifdef BCMDBGFS
+#ifdef DHD_DBGFS_DIR
 
 #include <linux/debugfs.h>
 
+#ifdef BCMDBGFS
 extern uint32 dhd_readregl(void *bp, uint32 addr);
 extern uint32 dhd_writeregl(void *bp, uint32 addr, uint32 data);
+#endif /* BCMDBGFS */
 
 typedef struct dhd_dbgfs {
 	struct dentry	*debugfs_dir;
 	struct dentry	*debugfs_mem;
+	struct dentry	*debugfs_lat;
 	dhd_pub_t 	*dhdp;
 	uint32 		size;
 } dhd_dbgfs_t;
@@ -6967,6 +7492,114 @@ dhd_dbg_state_open(struct inode *inode, struct file *file)
 	return 0;
 }
 
+#ifdef DHD_DBG_CONSOLE
+/* Dongle console lines, kept instead of printed. wr counts every byte ever
+ * written, so a reader's file position stays valid across ring wraps.
+ */
+#define DHD_CONSOLE_RING_SIZE	(16 * 1024)	/* power of 2 */
+static struct {
+	char buf[DHD_CONSOLE_RING_SIZE];
+	uint64 wr;
+	struct dentry *dentry;
+} dhd_console_ring;
+static DEFINE_SPINLOCK(dhd_console_lock);
+
+void
+dhd_dbg_console_line(char *line, int len)
+{
+	unsigned long flags;
+	uint32 off;
+	int i;
+
+	spin_lock_irqsave(&dhd_console_lock, flags);
+	for (i = 0; i <= len; i++) {
+		off = (uint32)dhd_console_ring.wr & (DHD_CONSOLE_RING_SIZE - 1);
+		dhd_console_ring.buf[off] = (i < len) ? line[i] : '\n';
+		dhd_console_ring.wr++;
+	}
+	spin_unlock_irqrestore(&dhd_console_lock, flags);
+}
+
+static ssize_t
+dhd_dbg_console_read(struct file *file, char __user *ubuf, size_t count, loff_t *ppos)
+{
+	char chunk[128];
+	unsigned long flags;
+	uint64 pos = *ppos;
+	size_t done = 0, n, i;
+
+	if (*ppos < 0)
+		return -EINVAL;
+
+	while (done < count) {
+		spin_lock_irqsave(&dhd_console_lock, flags);
+		/* Skip what the ring has already overwritten */
+		if (dhd_console_ring.wr > DHD_CONSOLE_RING_SIZE &&
+			pos < dhd_console_ring.wr - DHD_CONSOLE_RING_SIZE)
+			pos = dhd_console_ring.wr - DHD_CONSOLE_RING_SIZE;
+		n = MIN(count - done, sizeof(chunk));
+		if (pos >= dhd_console_ring.wr)
+			n = 0;
+		else if (n > dhd_console_ring.wr - pos)
+			n = (size_t)(dhd_console_ring.wr - pos);
+		for (i = 0; i < n; i++)
+			chunk[i] = dhd_console_ring.buf[(uint32)(pos + i) &
+				(DHD_CONSOLE_RING_SIZE - 1)];
+		spin_unlock_irqrestore(&dhd_console_lock, flags);
+
+		if (n == 0)
+			break;
+		if (copy_to_user(ubuf + done, chunk, n))
+			return done ? done : -EFAULT;
+		done += n;
+		pos += n;
+	}
+
+	*ppos = pos;
+	return done;
+}
+
+static const struct file_operations dhd_dbg_console_ops = {
+	.read   = dhd_dbg_console_read,
+	.open   = dhd_dbg_state_open,
+};
+#endif /* DHD_DBG_CONSOLE */
+
+#ifdef DHD_DBG_LAT
+#define DHD_DBG_LAT_BUFLEN	2048
+
+/* Per-stage latency histograms, see dhd_lat_dump(); any write clears them */
+static ssize_t
+dhd_dbg_lat_read(struct file *file, char __user *ubuf, size_t count, loff_t *ppos)
+{
+	char *buf;
+	ssize_t ret;
+
+	buf = kmalloc(DHD_DBG_LAT_BUFLEN, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	dhd_lat_dump(g_dbgfs.dhdp, buf, DHD_DBG_LAT_BUFLEN);
+	ret = simple_read_from_buffer(ubuf, count, ppos, buf, strlen(buf));
+	kfree(buf);
+	return ret;
+}
+
+static ssize_t
+dhd_dbg_lat_write(struct file *file, const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	bzero(g_dbgfs.dhdp->lat_stat, sizeof(g_dbgfs.dhdp->lat_stat));
+	return count;
+}
+
+static const struct file_operations dhd_dbg_lat_ops = {
+	.read   = dhd_dbg_lat_read,
+	.write  = dhd_dbg_lat_write,
+	.open   = dhd_dbg_state_open,
+};
+#endif /* DHD_DBG_LAT */
+
+#ifdef BCMDBGFS
+
 static ssize_t
 dhd_dbg_state_read(struct file *file, char __user *ubuf,
                        size_t count, loff_t *ppos)
@@ -7047,12 +7680,23 @@ static const struct file_operations dhd_dbg_state_ops = {
 	.open   = dhd_dbg_state_open,
 	.llseek	= dhd_debugfs_lseek
 };
+#endif /* BCMDBGFS */
 
 static void dhd_dbg_create(void)
 {
 	if (g_dbgfs.debugfs_dir) {
+#ifdef BCMDBGFS
 		g_dbgfs.debugfs_mem = debugfs_create_file("mem", 0644, g_dbgfs.debugfs_dir,
 			NULL, &dhd_dbg_state_ops);
+#endif /* BCMDBGFS */
+#ifdef DHD_DBG_LAT
+		g_dbgfs.debugfs_lat = debugfs_create_file("latency", 0644,
+			g_dbgfs.debugfs_dir, NULL, &dhd_dbg_lat_ops);
+#endif /* DHD_DBG_LAT */
+#ifdef DHD_DBG_CONSOLE
+		dhd_console_ring.dentry = debugfs_create_file("console", 0444,
+			g_dbgfs.debugfs_dir, NULL, &dhd_dbg_console_ops);
+#endif /* DHD_DBG_CONSOLE */
 	}
 }
 
@@ -7060,6 +7704,10 @@ void dhd_dbg_init(dhd_pub_t *dhdp)
 {
 	int err;
 
+	/* dhd_open runs on every ifup, the files stay until dhd_detach */
+	if (g_dbgfs.debugfs_dir)
+		return;
+
 	g_dbgfs.dhdp = dhdp;
 	g_dbgfs.size = 0x20000000; /* Allow access to various cores regs */
 
@@ -7077,13 +7725,18 @@ void dhd_dbg_init(dhd_pub_t *dhdp)
 
 void dhd_dbg_remove(void)
 {
+#ifdef DHD_DBG_CONSOLE
+	debugfs_remove(dhd_console_ring.dentry);
+	dhd_console_ring.dentry = NULL;
+#endif /* DHD_DBG_CONSOLE */
+	debugfs_remove(g_dbgfs.debugfs_lat);
 	debugfs_remove(g_dbgfs.debugfs_mem);
 	debugfs_remove(g_dbgfs.debugfs_dir);
 
 	bzero((unsigned char *) &g_dbgfs, sizeof(g_dbgfs));
 
 }
-#endif /* ifdef BCMDBGFS */
+#endif /* DHD_DBGFS_DIR */
 
 #ifdef WLMEDIA_HTSF
 
@@ -70,8 +70,25 @@ extern int dhd_prot_hdrpull(dhd_pub_t *, int *ifidx, void *rxp, uchar *buf, uint
 /* Use protocol to issue ioctl to dongle */
 extern int dhd_prot_ioctl(dhd_pub_t *dhd, int ifidx, wl_ioctl_t * ioc, void * buf, int len);
 
+/* Completion of a dhd_prot_ioctl_submit() request: ret is 0, the dongle's
+ * error status or -ETIMEDOUT, buf/len the response. Runs from the DPC or the
+ * bus watchdog with the bus lock held, or, for a timed out request, from the
+ * process context of the next caller to take a control slot. It must not
+ * sleep or issue ioctls itself.
+ */
+typedef void (*dhd_prot_ioctl_cb_t)(dhd_pub_t *dhd, void *arg, int ret, void *buf, uint len);
+
+/* Send an ioctl without waiting for the response (e.g. PNO or stats polling).
+ * Process context only; returns BCME_BUSY when all control slots are in use.
+ */
+extern int dhd_prot_ioctl_submit(dhd_pub_t *dhd, int ifidx, wl_ioctl_t *ioc, void *buf, int len,
+	dhd_prot_ioctl_cb_t cb, void *arg);
+
+/* Time out submitted requests; returns ms until the next is due, 0 if none */
+extern uint dhd_prot_ctl_expire(dhd_pub_t *dhd);
+
 /* Handles a protocol control response asynchronously */
-extern int dhd_prot_ctl_complete(dhd_pub_t *dhd);
+extern int dhd_prot_ctl_complete(dhd_pub_t *dhd, uchar *msg, uint msglen);
 
 /* Check for and handle local prot-specific iovar commands */
 extern int dhd_prot_iovar_op(dhd_pub_t *dhdp, const char *name,
@@ -130,6 +130,14 @@ extern bool  bcmsdh_fatal_error(void *sdh);
 #error MAX_HDR_READ is not a power of 2!
 #endif
 
+/* Limit on a speculative header + body read, hdrbuf is sized by it */
+#ifndef DHD_RXSPEC_MAX
+#define DHD_RXSPEC_MAX	512
+#endif
+#if DHD_RXSPEC_MAX < MAX_HDR_READ
+#error DHD_RXSPEC_MAX is smaller than MAX_HDR_READ!
+#endif
+
 #define MAX_RX_DATASZ	2048
 
 /* Maximum milliseconds to wait for F2 to come up */
@@ -177,6 +185,7 @@ typedef struct dhd_console {
 	uint		bufsize;		/* Size of log buffer */
 	uint8		*buf;			/* Log buffer (host copy) */
 	uint		last;			/* Last buffer read index */
+	uint		fetched;		/* Index up to which buf matches the dongle */
 } dhd_console_t;
 #endif /* DHD_DEBUG */
 
@@ -202,6 +211,27 @@ typedef struct dhd_console {
 #define OVERFLOW_BLKSZ512_MES		80
 
 #define CC_PMUCC3	(0x3)
+
+#ifdef BCMSDIOH_ASYNC
+/* Tx chains owned by bcmsdh: one on the bus, one queued behind it */
+#define DHD_TXASYNC_DEPTH	2
+
+/* Tx chain queued to bcmsdh, released by dhdsdio_txasync_cmplt() */
+typedef struct dhd_txchain {
+	struct dhd_bus	*bus;
+	bool		inuse;
+	uint8		tx_seq;				/* Sequence number of pkts[0] */
+	int		num_pkt;
+	void		*pkts[MAX_TX_PKTCHAIN_CNT];	/* Original packets */
+	int		new_pkt_num;
+	void		*new_pkts[MAX_TX_PKTCHAIN_CNT];	/* Realigned copies */
+	void		*head_pkt;			/* Head of the chain on the bus */
+	void		*tail_pkt;			/* pad_pkt is linked after it */
+} dhd_txchain_t;
+#endif /* BCMSDIOH_ASYNC */
+
+#define DHD_CLKWAIT_NBINS	16
+
 /* Private data for SDIO bus interaction */
 typedef struct dhd_bus {
 	dhd_pub_t	*dhd;
@@ -241,9 +271,13 @@ typedef struct dhd_bus {
 	uint8		tx_seq;			/* Transmit sequence number (next) */
 	uint8		tx_max;			/* Maximum transmit sequence allowed */
 
-	uint8		hdrbuf[MAX_HDR_READ + DHD_SDALIGN];
+	uint8		hdrbuf[DHD_RXSPEC_MAX + DHD_SDALIGN];
 	uint8		*rxhdr;			/* Header of current rx frame (in hdrbuf) */
 	uint16		nextlen;		/* Next Read Len from last header */
+	uint		rxspec_avg;		/* Rx frame length EWMA, x8 */
+	uint		rxspec_len;		/* Bytes to read with the header, 0 = firstread */
+	uint		rxspec_hits;		/* Speculative reads that got the whole frame */
+	uint		rxspec_misses;		/* Speculative reads that needed a second read */
 	uint8		rx_seq;			/* Receive sequence number (expected) */
 	bool		rxskip;			/* Skip receive (awaiting NAK ACK) */
 
@@ -264,6 +298,14 @@ typedef struct dhd_bus {
 	bool		poll;			/* Use polling */
 	bool		ipend;			/* Device interrupt is pending */
 	bool		intdis;			/* Interrupts disabled by isr */
+	bool		intr_poll;		/* Interrupts left masked, DPC polls intstatus */
+	uint		poll_light;		/* Consecutive light DPC passes while polling */
+	uint32		mode_start_us;		/* Start of the current intr/poll period */
+	uint		poll_enter;		/* Switches to polling */
+	uint		poll_exit;		/* Switches back to interrupts */
+	uint		poll_passes;		/* DPC passes while polling */
+	uint64		poll_us;		/* Time spent polling */
+	uint64		intr_us;		/* Time spent interrupt driven */
 	uint 		intrcount;		/* Count of device interrupt callbacks */
 	uint		lastintrs;		/* Count as of last watchdog timer */
 	uint		spurious;		/* Count of spurious interrupts */
@@ -282,6 +324,29 @@ typedef struct dhd_bus {
 	bool		activity;		/* Activity flag for clock down */
 	int32		idletime;		/* Control for activity timeout */
 	int32		idlecount;		/* Activity timeout counter */
+	uint32		wd_last_ms;		/* Last dhd_bus_watchdog run */
+	uint		wd_due_ms;		/* Interval dhd_bus_watchdog_due last gave */
+	uint		ctl_due_ms;		/* Time until a submitted ioctl times out */
+	/* HT clock wake prediction, see dhdsdio_clk_traffic() */
+	bool		clk_idle;		/* No traffic since the clock went off or pre-wake */
+	bool		clk_prewoke;		/* Clock is up on a prediction, no traffic yet */
+	bool		clk_waking;		/* Clock requested by us, not by traffic */
+	uint32		clk_last_ms;		/* First traffic after the last idle period */
+	uint32		clk_period_ms;		/* Learned interval between those */
+	uint32		clk_next_ms;		/* Next pre-wake time */
+	uint32		clk_hold_ms;		/* Pre-woken clock is kept up until then */
+	uint		clk_conf;		/* Intervals in a row matching clk_period_ms */
+	uint		clk_prewakes;		/* Pre-wakes issued */
+	uint		clk_hits;		/* Traffic that found a pre-woken clock */
+	uint		clk_wasted;		/* Pre-wakes that timed out without traffic */
+	uint		clk_late;		/* Traffic that found the clock off while predicting */
+	uint32		clk_req_us;		/* Start of the current HT clock request */
+	uint32		clkwait_max_us;
+	uint32		clkwait_hist[DHD_CLKWAIT_NBINS];	/* HT/KSO wake wait, log2 us */
+	/* Data path latency tracing, see dhdsdio_lat_rx() */
+	uint32		lat_isr_us;		/* First interrupt not yet seen by the DPC */
+	uint32		lat_t0_us;		/* Origin of frames read in this DPC */
+	uint32		lat_rd_us;		/* DPC start or end of the last delivery */
 	int32		idleclock;		/* How to set bus driver when idle */
 	int32		sd_divisor;		/* Speed control to bus driver */
 	int32		sd_mode;		/* Mode control to bus driver */
@@ -317,7 +382,14 @@ typedef struct dhd_bus {
 	uint		pktgen_ptick;		/* Burst counter for printing */
 	uint		pktgen_sent;		/* Number of test packets generated */
 	uint		pktgen_rcvd;		/* Number of test packets received */
-	uint		pktgen_prev_time;	/* Time at which previous stats where printed */
+	uint		pktgen_sent_bytes;	/* Test payload bytes generated */
+	uint		pktgen_rcvd_bytes;	/* Test payload bytes received */
+	uint		pktgen_prev_sent_bytes;	/* pktgen_sent_bytes at previous stats print */
+	uint		pktgen_prev_rcvd_bytes;	/* pktgen_rcvd_bytes at previous stats print */
+	uint32		rxframe_us;		/* Rx time per frame (EWMA, DHD_TXGLOM_FRAC bits) */
+	uint32		rxdeliver_us;		/* Time spent in dhd_rx_frame, left out of it */
+	uint32		pktgen_tx_us;		/* Tx CMD53 time per test frame (same format) */
+	uint64		pktgen_prev_time;	/* Time (us) at which previous stats where printed */
 	uint		pktgen_prev_sent;	/* Number of test packets generated when
 						 * previous stats were printed
 						 */
@@ -351,9 +423,12 @@ typedef struct dhd_bus {
 	uint		f2rxdata;		/* Number of frame data reads */
 	uint		f2txdata;		/* Number of f2 frame writes */
 	uint		f1regdata;		/* Number of f1 register accesses */
+	uint32		hmb_data;		/* tohostmailboxdata read with intstatus */
+	bool		hmb_valid;		/* hmb_data is for the pending I_HMB_HOST_INT */
 #ifdef DHDENABLE_TAILPAD
 	uint		tx_tailpad_chain;	/* Number of tail padding by chaining pad_pkt */
 	uint		tx_tailpad_pktget;	/* Number of tail padding by new PKTGET */
+	uint		tx_headpad_pktget;	/* Number of head alignments by new PKTGET */
 #endif
 	uint8		*ctrl_frame_buf;
 	uint32		ctrl_frame_len;
@@ -371,15 +446,42 @@ typedef struct dhd_bus {
 	bool        reqbussleep;
 	uint32		resetinstr;
 	uint32		dongle_ram_base;
+	uint32		dl_bytes;	/* Size of the last firmware image download */
+	uint32		dl_crc;		/* CRC32 of the image as sent (dhd_dl_verify) */
+	uint32		dl_read_us;	/* Time spent waiting for image blocks */
+	uint32		dl_write_us;	/* Time spent writing blocks to dongle RAM */
+	uint32		dl_verify_us;	/* Read-back and CRC32 compare */
+	uint32		dl_nvram_us;	/* NVRAM download */
+	uint32		dl_total_us;	/* Whole firmware download incl. ARM reset handling */
 
 	void		*glom_pkt_arr[SDPCM_MAXGLOM_SIZE];	/* Array of pkts for glomming */
 	uint32		txglom_cnt;	/* Number of pkts in the glom array */
 	uint32		txglom_total_len;	/* Total length of pkts in glom array */
 	bool		txglom_enable;	/* Flag to indicate whether tx glom is enabled/disabled */
 	uint32		txglomsize;	/* Glom size limitation */
+	uint32		txglom_lat;	/* Adaptive glom latency budget in us, 0 = fixed size */
+	uint32		txglom_frame_us;	/* Tx time per frame (EWMA, DHD_TXGLOM_FRAC bits) */
+	uint32		txglom_hist[SDPCM_MAXGLOM_SIZE + 1];	/* Glom size picked per pass */
 	void		*pad_pkt;
+#ifdef BCMSDIOH_ASYNC
+	bool		txasync;	/* Queue data cmd53s while the previous one is busy */
+	bool		txasync_err;	/* A queued chain failed, frame needs terminating */
+	uint8		txasync_idx;	/* Next txasync_chain[] entry */
+	dhd_txchain_t	txasync_chain[DHD_TXASYNC_DEPTH];
+	uint		txasync_queued;	/* Chains queued to bcmsdh */
+	uint		txasync_fail;	/* Queued chains that failed on the bus */
+#endif /* BCMSDIOH_ASYNC */
+#ifdef DHD_TXSTAGE
+	uint		txstage_drops;	/* Staged frames txq had no room for */
+#endif /* DHD_TXSTAGE */
 } dhd_bus_t;
 
+#ifdef DHD_TXSTAGE
+#define DHD_TXSTAGED(bus)	dhd_os_txstage_len((bus)->dhd)
+#else
+#define DHD_TXSTAGED(bus)	0
+#endif /* DHD_TXSTAGE */
+
 /* clkstate */
 #define CLK_NONE	0
 #define CLK_SDONLY	1
@@ -415,6 +517,67 @@ uint dhd_dpcpoll = FALSE;
 module_param(dhd_doflow, uint, 0644);
 module_param(dhd_dpcpoll, uint, 0644);
 
+/* Learn periodic traffic after idle and bring the clock up dhd_clk_lead_ms ahead
+ * of it; also start the DPC on the clock as soon as a frame enters the tx path.
+ */
+#define DHD_CLK_PREDICT_CONF	3	/* matching intervals before predicting */
+#define DHD_CLK_PREDICT_SLOP_MS	10	/* least interval tolerance */
+#define DHD_CLK_PREDICT_MAX_MS	(60 * 1000)
+uint dhd_clk_predict = FALSE;
+uint dhd_clk_lead_ms = 10;
+module_param(dhd_clk_predict, uint, 0644);
+module_param(dhd_clk_lead_ms, uint, 0644);
+#define DHD_CLK_PREDICTING(bus)	(dhd_clk_predict && ((bus)->clk_conf >= DHD_CLK_PREDICT_CONF))
+
+/* Adaptive interrupt mitigation, see dhdsdio_intr_adapt() */
+#define DHD_POLL_LIGHT_PASSES	2	/* light passes before interrupts come back */
+uint dhd_intr_mitigate = FALSE;
+uint dhd_intr_poll_ms = 10;		/* longest poll period, 0 for no limit */
+module_param(dhd_intr_mitigate, uint, 0644);
+module_param(dhd_intr_poll_ms, uint, 0644);
+
+/* Adaptive tx glom: unless the queue is backed up, trim gloms so one spends at
+ * most this many us on the bus, and end the sendfromq pass after a trimmed glom
+ * so the DPC gets back to rx and control frames (0 = always use txglomsize)
+ */
+#define DHD_TXGLOM_LAT_US	1000
+uint dhd_txglom_lat = DHD_TXGLOM_LAT_US;
+module_param(dhd_txglom_lat, uint, 0644);
+
+#define DHD_TXGLOM_FRAC		4	/* Fraction bits of the per-frame time averages */
+
+/* With no nextlen hint, read the header together with a frame of the usual
+ * size in one cmd53, and only read the remainder of longer frames
+ */
+uint dhd_rxspec = TRUE;
+module_param(dhd_rxspec, uint, 0644);
+
+#ifdef OSL_RXCACHE
+/* Rx skbs cached per size class and CPU for PKTGET_RX (0 = no cache) */
+#define DHD_RXCACHE_DEPTH	16
+uint dhd_rxcache_depth = DHD_RXCACHE_DEPTH;
+module_param(dhd_rxcache_depth, uint, 0644);
+#endif /* OSL_RXCACHE */
+
+#ifdef BCMSDIOH_ASYNC
+/* Pipeline tx glom cmd53s (needs host controller async support) */
+uint dhd_txasync = FALSE;
+module_param(dhd_txasync, uint, 0644);
+#endif /* BCMSDIOH_ASYNC */
+
+/* Firmware download block size, bounded by the backplane window */
+#define DHD_DL_BLKSZ		(16 * 1024)
+uint dhd_dl_blksz = DHD_DL_BLKSZ;
+module_param(dhd_dl_blksz, uint, 0644);
+
+/* Read the firmware image back after download and compare its CRC32 */
+uint dhd_dl_verify = FALSE;
+module_param(dhd_dl_verify, uint, 0644);
+
+/* Fetch the host mailbox data in the same F1 transfer as intstatus */
+uint dhd_f1_regbatch = TRUE;
+module_param(dhd_f1_regbatch, uint, 0644);
+
 static bool dhd_alignctl;
 
 static bool sd1idle;
@@ -587,6 +750,13 @@ static int dhdsdio_txpkt_preprocess(dhd_bus_t *bus, void *pkt, int chan, int txs
 	int prev_chain_total_len, bool last_chained_pkt,
 	int *pad_pkt_len, void **new_pkt);
 static int dhdsdio_txpkt_postprocess(dhd_bus_t *bus, void *pkt);
+static void dhdsdio_txpkt_cmplt(dhd_bus_t *bus, void *head_pkt, void **pkts, int num_pkt,
+	void **new_pkts, int new_pkt_num, bool free_pkt, int ret);
+#ifdef BCMSDIOH_ASYNC
+static int dhdsdio_txasync_queue(dhd_bus_t *bus, void **pkts, int num_pkt, void **new_pkts,
+	int new_pkt_num, void *head_pkt, void *tail_pkt, int total_len);
+static void dhdsdio_txasync_flush(dhd_bus_t *bus);
+#endif /* BCMSDIOH_ASYNC */
 
 static int dhdsdio_download_firmware(dhd_bus_t *bus, osl_t *osh, void *sdh);
 static int _dhdsdio_download_firmware(dhd_bus_t *bus);
@@ -1119,6 +1289,79 @@ dhdsdio_clk_devsleep_iovar(dhd_bus_t *bus, bool on)
 	return err;
 }
 
+static void
+dhdsdio_clkwait_account(dhd_bus_t *bus, uint32 us)
+{
+	if (us > bus->clkwait_max_us)
+		bus->clkwait_max_us = us;
+	bus->clkwait_hist[bcm_log2_bin(us, DHD_CLKWAIT_NBINS)]++;
+}
+
+/* The clock went off or to sleep: the next request for it is new traffic */
+static void
+dhdsdio_clk_went_idle(dhd_bus_t *bus)
+{
+	if (bus->clk_prewoke) {
+		/* Prediction missed: back off until the pattern is seen again */
+		bus->clk_wasted++;
+		if (bus->clk_conf)
+			bus->clk_conf--;
+	}
+	bus->clk_prewoke = FALSE;
+	bus->clk_idle = TRUE;
+}
+
+/* How far off clk_period_ms an interval may be and still match */
+static uint32
+dhdsdio_clk_tol(dhd_bus_t *bus)
+{
+	return MAX(bus->clk_period_ms / 8, DHD_CLK_PREDICT_SLOP_MS);
+}
+
+/* A pre-woken clock stays up for as long as its traffic would still match */
+static bool
+dhdsdio_clk_held(dhd_bus_t *bus, uint32 now)
+{
+	return bus->clk_prewoke && ((int32)(bus->clk_hold_ms - now) > 0);
+}
+
+/* First clock request after an idle period that did not come from us. The
+ * intervals between these are learned; once DHD_CLK_PREDICT_CONF of them in a
+ * row agree to within 1/8, the watchdog pre-wakes the clock ahead of the next.
+ */
+static void
+dhdsdio_clk_traffic(dhd_bus_t *bus)
+{
+	uint32 now = OSL_SYSUPTIME();
+	uint32 iv = now - bus->clk_last_ms;
+	uint32 tol;
+
+	bus->clk_idle = FALSE;
+	if (bus->clk_prewoke)
+		bus->clk_hits++;
+	else if (DHD_CLK_PREDICTING(bus))
+		bus->clk_late++;
+	bus->clk_prewoke = FALSE;
+
+	if (bus->clk_last_ms && (iv <= DHD_CLK_PREDICT_MAX_MS)) {
+		tol = dhdsdio_clk_tol(bus);
+		if (bus->clk_period_ms && (iv + tol >= bus->clk_period_ms) &&
+		    (iv <= bus->clk_period_ms + tol)) {
+			bus->clk_period_ms = (bus->clk_period_ms * 3 + iv) / 4;
+			if (bus->clk_conf < DHD_CLK_PREDICT_CONF)
+				bus->clk_conf++;
+		} else {
+			bus->clk_period_ms = iv;
+			bus->clk_conf = 0;
+		}
+	} else {
+		bus->clk_period_ms = 0;
+		bus->clk_conf = 0;
+	}
+	bus->clk_last_ms = now;
+	bus->clk_next_ms = now + bus->clk_period_ms - MIN(dhd_clk_lead_ms, bus->clk_period_ms);
+}
+
 /* Turn backplane clock on or off */
 static int
 dhdsdio_htclk(dhd_bus_t *bus, bool on, bool pendok)
@@ -1146,7 +1389,8 @@ dhdsdio_htclk(dhd_bus_t *bus, bool on, bool pendok)
 	if (on) {
 		/* Request HT Avail */
 		clkreq = bus->alp_only ? SBSDIO_ALP_AVAIL_REQ : SBSDIO_HT_AVAIL_REQ;
-
+		if (bus->clkstate != CLK_PENDING)
+			bus->clk_req_us = OSL_SYSUPTIME_US();
 
 
 		bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_CHIPCLKCSR, clkreq, &err);
@@ -1220,6 +1464,7 @@ dhdsdio_htclk(dhd_bus_t *bus, bool on, bool pendok)
 
 		/* Mark clock available */
 		bus->clkstate = CLK_AVAIL;
+		dhdsdio_clkwait_account(bus, OSL_SYSUPTIME_US() - bus->clk_req_us);
 		DHD_INFO(("CLKCTL: turned ON\n"));
 
 #if defined(DHD_DEBUG)
@@ -1361,6 +1606,9 @@ dhdsdio_clkctl(dhd_bus_t *bus, uint target, bool pendok)
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
+	if ((target == CLK_AVAIL) && bus->clk_idle && !bus->clk_waking)
+		dhdsdio_clk_traffic(bus);
+
 	/* Early exit if we're already there */
 	if (bus->clkstate == target) {
 		if (target == CLK_AVAIL) {
@@ -1409,10 +1657,11 @@ dhdsdio_clkctl(dhd_bus_t *bus, uint target, bool pendok)
 			ret = dhdsdio_htclk(bus, FALSE, FALSE);
 		/* Now remove the SD clock */
 		ret = dhdsdio_sdclk(bus, FALSE);
+		dhdsdio_clk_went_idle(bus);
 #ifdef DHD_DEBUG
 		if (dhd_console_ms == 0)
 #endif /* DHD_DEBUG */
-		if (bus->poll == 0)
+		if ((bus->poll == 0) && !DHD_CLK_PREDICTING(bus))
 			dhd_os_wd_timer(bus->dhd, 0);
 		break;
 	}
@@ -1445,7 +1694,7 @@ dhdsdio_bussleep(dhd_bus_t *bus, bool sleep)
 	/* Going to sleep: set the alarm and turn off the lights... */
 	if (sleep) {
 		/* Don't sleep if something is pending */
-		if (bus->dpc_sched || bus->rxskip || pktq_len(&bus->txq))
+		if (bus->dpc_sched || bus->rxskip || pktq_len(&bus->txq) || DHD_TXSTAGED(bus))
 			return BCME_BUSY;
 
 
@@ -1482,6 +1731,7 @@ dhdsdio_bussleep(dhd_bus_t *bus, bool sleep)
 
 		/* Change state */
 		bus->sleeping = TRUE;
+		dhdsdio_clk_went_idle(bus);
 		wake_up(&bus->bus_sleep);
 	} else {
 		/* Waking up: bus power up is ok, set local state */
@@ -1513,7 +1763,11 @@ dhdsdio_bussleep(dhd_bus_t *bus, bool sleep)
 				bcmsdh_intr_enable(bus->sdh);
 			}
 		} else {
+			uint32 start = OSL_SYSUPTIME_US();
+
 			err = dhdsdio_clk_devsleep_iovar(bus, FALSE /* wake */);
+			if (err == 0)
+				dhdsdio_clkwait_account(bus, OSL_SYSUPTIME_US() - start);
 		}
 
 		if (err == 0) {
@@ -1572,6 +1826,7 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 
 	osh = bus->dhd->osh;
 	datalen = PKTLEN(osh, pkt);
+	DHD_LAT_STAMP(bus->dhd, pkt, DHD_LAT_TX_HOST);
 
 #ifdef SDTEST
 	/* Push the test header if doing loopback */
@@ -1617,8 +1872,8 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 	prec = PRIO2PREC((PKTPRIO(pkt) & PRIOMASK));
 
 	/* Check for existing queue, current flow-control, pending event, or pending clock */
-	if (dhd_deferred_tx || bus->fcstate || pktq_len(&bus->txq) || bus->dpc_sched ||
-	    (!DATAOK(bus)) || (bus->flowcontrol & NBITVAL(prec)) ||
+	if (dhd_deferred_tx || bus->fcstate || pktq_len(&bus->txq) || DHD_TXSTAGED(bus) ||
+	    bus->dpc_sched || (!DATAOK(bus)) || (bus->flowcontrol & NBITVAL(prec)) ||
 	    (bus->clkstate != CLK_AVAIL)) {
 		bool deq_ret;
 		int pkq_len;
@@ -1626,10 +1881,29 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 		DHD_TRACE(("%s: deferring pktq len %d\n", __FUNCTION__, pktq_len(&bus->txq)));
 		bus->fcqueued++;
 
-		/* Priority based enq */
-		dhd_os_sdlock_txq(bus->dhd);
-		deq_ret = dhd_prec_enq(bus->dhd, &bus->txq, pkt, prec);
-		dhd_os_sdunlock_txq(bus->dhd);
+#ifdef DHD_TXSTAGE
+		/* wlfc needs the enqueue result now to roll back, so only stage our own */
+		if (
+#ifdef PROP_TXSTATUS
+		    DHD_PKTTAG_WLFCPKT(PKTTAG(pkt)) == 0 &&
+#endif /* PROP_TXSTATUS */
+		    dhd_os_txstage_push(bus->dhd, pkt)) {
+			/* the DPC moves it to txq; pkt is not ours anymore */
+			deq_ret = TRUE;
+			pkq_len = pktq_len(&bus->txq) + DHD_TXSTAGED(bus);
+		} else
+#endif /* DHD_TXSTAGE */
+		{
+			/* Priority based enq */
+			dhd_os_sdlock_txq(bus->dhd);
+			deq_ret = dhd_prec_enq(bus->dhd, &bus->txq, pkt, prec);
+			pkq_len = pktq_len(&bus->txq);
+#ifdef DHD_DEBUG
+			if (pktq_plen(&bus->txq, prec) > qcount[prec])
+				qcount[prec] = pktq_plen(&bus->txq, prec);
+#endif
+			dhd_os_sdunlock_txq(bus->dhd);
+		}
 
 		if (!deq_ret) {
 #ifdef PROP_TXSTATUS
@@ -1650,9 +1924,6 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 		} else
 			ret = BCME_OK;
 
-		dhd_os_sdlock_txq(bus->dhd);
-		pkq_len = pktq_len(&bus->txq);
-		dhd_os_sdunlock_txq(bus->dhd);
 		if (pkq_len >= FCHI) {
 			bool wlfc_enabled = FALSE;
 #ifdef PROP_TXSTATUS
@@ -1664,13 +1935,6 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 			}
 		}
 
-#ifdef DHD_DEBUG
-		dhd_os_sdlock_txq(bus->dhd);
-		if (pktq_plen(&bus->txq, prec) > qcount[prec])
-			qcount[prec] = pktq_plen(&bus->txq, prec);
-		dhd_os_sdunlock_txq(bus->dhd);
-#endif
-
 		/* Schedule DPC if needed to send queued packet(s) */
 		if (dhd_deferred_tx && !bus->dpc_sched) {
 			bus->dpc_sched = TRUE;
@@ -1691,6 +1955,10 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 		dhdsdio_clkctl(bus, CLK_AVAIL, TRUE);
 
 		ret = dhdsdio_txpkt(bus, chan, &pkt, 1, TRUE);
+#ifdef BCMSDIOH_ASYNC
+		if (bus->txasync)
+			dhdsdio_txasync_flush(bus);
+#endif /* BCMSDIOH_ASYNC */
 
 		if (ret != BCME_OK)
 			bus->dhd->tx_errors++;
@@ -1777,6 +2045,9 @@ static int dhdsdio_txpkt_preprocess(dhd_bus_t *bus, void *pkt, int chan, int txs
 	if (PKTHEADROOM(osh, pkt) < head_padding) {
 		head_padding = 0;
 		alloc_new_pkt = TRUE;
+#ifdef DHDENABLE_TAILPAD
+		bus->tx_headpad_pktget++;
+#endif
 	} else {
 		uint cur_chain_total_len;
 		int chain_tail_padding = 0;
@@ -1804,14 +2075,19 @@ static int dhdsdio_txpkt_preprocess(dhd_bus_t *bus, void *pkt, int chan, int txs
 
 #ifdef DHDENABLE_TAILPAD
 		if (PKTTAILROOM(osh, pkt) < tail_padding) {
-			/* We don't have tail room to align by DHD_SDALIGN */
+			/* We don't have tail room to align by DHD_SDALIGN. Every SG
+			 * segment must stay DHD_SDALIGN long for the host controller, so
+			 * pad_pkt cannot absorb this pad; copy into a new pkt instead.
+			 */
 			alloc_new_pkt = TRUE;
 			bus->tx_tailpad_pktget++;
 		} else if (PKTTAILROOM(osh, pkt) < tail_padding + chain_tail_padding) {
 			/* We have tail room for tail_padding of this pkt itself, but not for
 			 * total pkt chain alignment by block size.
 			 * Use the padding packet to avoid memory copy if applicable,
-			 * otherwise, just allocate a new pkt.
+			 * otherwise, just allocate a new pkt. This is the only pad a
+			 * frame can go without copying; the room asked of the stack
+			 * (tx_headroom, tx_tailroom) is what keeps the copies rare.
 			 */
 			if (bus->pad_pkt) {
 				*pad_pkt_len = chain_tail_padding;
@@ -1994,7 +2270,6 @@ static int dhdsdio_txpkt(dhd_bus_t *bus, uint chan, void** pkts, int num_pkt, bo
 	int pad_pkt_len = 0;
 	int new_pkt_num = 0;
 	void *new_pkts[MAX_TX_PKTCHAIN_CNT];
-	bool wlfc_enabled = FALSE;
 
 	if (bus->dhd->dongle_reset)
 		return BCME_NOTREADY;
@@ -2040,12 +2315,34 @@ static int dhdsdio_txpkt(dhd_bus_t *bus, uint chan, void** pkts, int num_pkt, bo
 
 	}
 
+	for (i = 0; i < num_pkt; i++)
+		DHD_LAT_STAMP(bus->dhd, pkts[i], DHD_LAT_TX_GLOM);
+
 	/* if a padding packet if needed, insert it to the end of the link list */
 	if (pad_pkt_len) {
 		PKTSETLEN(osh, bus->pad_pkt, pad_pkt_len);
 		PKTSETNEXT(osh, pkt, bus->pad_pkt);
 	}
 
+#ifdef BCMSDIOH_ASYNC
+	/* data chains are queued behind the one on the bus, dhdsdio_txasync_cmplt()
+	 * finishes them once bcmsdh is done; callers flush with dhdsdio_txasync_flush()
+	 */
+	if (bus->txasync && (chan == SDPCM_DATA_CHANNEL) && free_pkt) {
+		ret = dhdsdio_txasync_queue(bus, pkts, num_pkt, new_pkts, new_pkt_num,
+			head_pkt, pad_pkt_len ? pkt : NULL, total_len);
+		if (ret == BCME_PENDING) {
+			bus->tx_seq = (bus->tx_seq + num_pkt) % SDPCM_SEQUENCE_WRAP;
+			return BCME_OK;
+		}
+		if (ret == BCME_UNSUPPORTED) {
+			DHD_ERROR(("%s: async cmd53 unsupported, txasync off\n", __FUNCTION__));
+			bus->txasync = FALSE;
+		} else
+			goto unlink_pad;
+	}
+#endif /* BCMSDIOH_ASYNC */
+
 	/* dhd_bcmsdh_send_buf ignores the buffer pointer if he packet
 	 * parameter is not NULL, for non packet chian we pass NULL pkt pointer
 	 * so it will take the aligned length and buffer pointer.
@@ -2056,11 +2353,31 @@ static int dhdsdio_txpkt(dhd_bus_t *bus, uint chan, void** pkts, int num_pkt, bo
 	if (ret == BCME_OK)
 		bus->tx_seq = (bus->tx_seq + num_pkt) % SDPCM_SEQUENCE_WRAP;
 
+#ifdef BCMSDIOH_ASYNC
+unlink_pad:
+#endif /* BCMSDIOH_ASYNC */
 	/* if a padding packet was needed, remove it from the link list as it not a data pkt */
 	if (pad_pkt_len && pkt)
 		PKTSETNEXT(osh, pkt, NULL);
 
 done:
+	dhdsdio_txpkt_cmplt(bus, head_pkt, pkts, num_pkt, new_pkts, new_pkt_num, free_pkt, ret);
+
+	return ret;
+}
+
+/* Undo dhdsdio_txpkt_preprocess on the chain that went to the bus and indicate the
+ * original packets to the upper layer. Packets allocated for alignment are freed.
+ */
+static void
+dhdsdio_txpkt_cmplt(dhd_bus_t *bus, void *head_pkt, void **pkts, int num_pkt,
+	void **new_pkts, int new_pkt_num, bool free_pkt, int ret)
+{
+	int i;
+	osl_t *osh = bus->dhd->osh;
+	void *pkt;
+	bool wlfc_enabled;
+
 	pkt = head_pkt;
 	while (pkt) {
 		void *pkt_next = PKTNEXT(osh, pkt);
@@ -2075,6 +2392,10 @@ done:
 	for (i = 0; i < num_pkt; i++) {
 		pkt = pkts[i];
 		wlfc_enabled = FALSE;
+		if (ret == 0)
+			DHD_LAT_DONE(bus->dhd, pkt, DHD_LAT_TX_CMD53, DHD_LAT_TX_TOTAL);
+		else
+			DHD_LAT_TAG(pkt)->t0 = 0;
 #ifdef PROP_TXSTATUS
 		if (DHD_PKTTAG_WLFCPKT(PKTTAG(pkt))) {
 			wlfc_enabled = (dhd_wlfc_txcomplete(bus->dhd, pkt, ret == 0) !=
@@ -2091,10 +2412,208 @@ done:
 
 	for (i = 0; i < new_pkt_num; i++)
 		PKTFREE(osh, new_pkts[i], TRUE);
+}
+
+#ifdef BCMSDIOH_ASYNC
+static void
+dhdsdio_txasync_cmplt(void *handle, int status, bool sync_waiting)
+{
+	dhd_txchain_t *txc = (dhd_txchain_t *)handle;
+	dhd_bus_t *bus = txc->bus;
+
+	ASSERT(txc->inuse);
+	if (status != BCME_OK) {
+		/* can't touch the bus from here, dhdsdio_txasync_flush() terminates the frame.
+		 * Nothing queued after this chain got on the bus, so its sequence numbers
+		 * are free again.
+		 */
+		if (!bus->txasync_err)
+			bus->tx_seq = txc->tx_seq;
+		bus->txasync_fail++;
+		bus->txasync_err = TRUE;
+		bus->dhd->tx_errors++;
+	}
+
+	if (txc->tail_pkt)
+		PKTSETNEXT(bus->dhd->osh, txc->tail_pkt, NULL);
+
+	dhdsdio_txpkt_cmplt(bus, txc->head_pkt, txc->pkts, txc->num_pkt,
+		txc->new_pkts, txc->new_pkt_num, TRUE, status);
+	txc->inuse = FALSE;
+}
+
+/* Returns BCME_PENDING once the chain is owned by bcmsdh */
+static int
+dhdsdio_txasync_queue(dhd_bus_t *bus, void **pkts, int num_pkt, void **new_pkts,
+	int new_pkt_num, void *head_pkt, void *tail_pkt, int total_len)
+{
+	dhd_txchain_t *txc = &bus->txasync_chain[bus->txasync_idx];
+	uint8 tx_seq = bus->tx_seq;	/* pkts were stamped from here */
+	int ret;
+
+	/* bcmsdh completes the older chain before it queues a new one, so the
+	 * entry is normally free by now
+	 */
+	if (txc->inuse)
+		bcmsdh_async_flush(bus->sdh);
+	ASSERT(!txc->inuse);
+
+	/* terminate a failed frame before sending more behind it */
+	if (bus->txasync_err)
+		dhdsdio_txasync_flush(bus);
+	/* an earlier chain failed and took the sequence numbers back */
+	if (bus->tx_seq != tx_seq)
+		return BCME_SDIO_ERROR;
+
+	txc->bus = bus;
+	txc->tx_seq = tx_seq;
+	txc->num_pkt = num_pkt;
+	bcopy(pkts, txc->pkts, num_pkt * sizeof(void *));
+	txc->new_pkt_num = new_pkt_num;
+	bcopy(new_pkts, txc->new_pkts, new_pkt_num * sizeof(void *));
+	txc->head_pkt = head_pkt;
+	txc->tail_pkt = tail_pkt;
+	txc->inuse = TRUE;
+
+	ret = dhd_bcmsdh_send_buf(bus, bcmsdh_cur_sbwad(bus->sdh), SDIO_FUNC_2,
+		F2SYNC | SDIO_REQ_ASYNC, PKTDATA(bus->dhd->osh, head_pkt), total_len,
+		head_pkt, dhdsdio_txasync_cmplt, txc, 1);
+	if (ret == BCME_PENDING) {
+		bus->txasync_idx = (bus->txasync_idx + 1) % DHD_TXASYNC_DEPTH;
+		bus->txasync_queued++;
+	} else
+		txc->inuse = FALSE;
 
 	return ret;
 }
 
+/* Wait for the queued chains, then terminate the frame if one of them failed */
+static void
+dhdsdio_txasync_flush(dhd_bus_t *bus)
+{
+	bcmsdh_info_t *sdh = bus->sdh;
+	int i;
+
+	bcmsdh_async_flush(sdh);
+
+	if (!bus->txasync_err)
+		return;
+
+	bus->txasync_err = FALSE;
+	bus->tx_sderrs++;
+	bus->f1regdata++;
+	bcmsdh_abort(sdh, SDIO_FUNC_2);
+	bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_FRAMECTRL, SFC_WF_TERM, NULL);
+	for (i = 0; i < READ_FRM_CNT_RETRIES; i++) {
+		uint8 hi, lo;
+		hi = bcmsdh_cfg_read(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_WFRAMEBCHI, NULL);
+		lo = bcmsdh_cfg_read(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_WFRAMEBCLO, NULL);
+		bus->f1regdata += 2;
+		if ((hi == 0) && (lo == 0))
+			break;
+	}
+}
+#endif /* BCMSDIOH_ASYNC */
+
+#ifdef DHD_TXSTAGE
+/* Move frames staged by dhd_bus_txdata onto txq, one txq lock for all of them */
+static void
+dhdsdio_txstage_splice(dhd_bus_t *bus)
+{
+	osl_t *osh = bus->dhd->osh;
+	void *pkt, *next, *drop = NULL;
+	uint cnt;
+
+	if (!DHD_TXSTAGED(bus))
+		return;
+
+	pkt = dhd_os_txstage_pull(bus->dhd, &cnt);
+	if (pkt == NULL)
+		return;
+
+	dhd_os_sdlock_txq(bus->dhd);
+	for (; pkt; pkt = next) {
+		next = PKTLINK(pkt);
+		PKTSETLINK(pkt, NULL);
+		if (!dhd_prec_enq(bus->dhd, &bus->txq, pkt, PRIO2PREC((PKTPRIO(pkt) & PRIOMASK)))) {
+			PKTSETLINK(pkt, drop);
+			drop = pkt;
+		}
+	}
+#ifdef DHD_DEBUG
+	{
+		int prec;
+		for (prec = 0; prec < NUMPRIO; prec++) {
+			if (pktq_plen(&bus->txq, prec) > qcount[prec])
+				qcount[prec] = pktq_plen(&bus->txq, prec);
+		}
+	}
+#endif /* DHD_DEBUG */
+	dhd_os_sdunlock_txq(bus->dhd);
+
+	/* same as a failed enqueue in dhd_bus_txdata, outside the lock */
+	for (; drop; drop = next) {
+		next = PKTLINK(drop);
+		PKTSETLINK(drop, NULL);
+		bus->txstage_drops++;
+#ifdef DHDTCPACK_SUPPRESS
+		if (dhd_tcpack_check_xmit(bus->dhd, drop) == BCME_ERROR) {
+			DHD_ERROR(("%s %d: tcpack_suppress ERROR!!! Stop using\n",
+				__FUNCTION__, __LINE__));
+			dhd_tcpack_suppress_set(bus->dhd, TCPACK_SUP_OFF);
+		}
+#endif /* DHDTCPACK_SUPPRESS */
+		dhd_txcomplete(bus->dhd, drop, FALSE);
+		PKTFREE(osh, drop, TRUE);
+	}
+}
+#endif /* DHD_TXSTAGE */
+
+/* Pick the glom size for one sendfromq pass. With a deep queue and credit to
+ * match, use the full txglomsize for throughput. Otherwise bigger gloms buy
+ * little, so cap them at what the measured per-frame time fits in txglom_lat.
+ * *capped, set only when the cap made the glom smaller, tells the caller to
+ * send only that one glom in this pass.
+ */
+static uint
+dhdsdio_txglom_pick(dhd_bus_t *bus, uint8 prec_map, bool *capped)
+{
+	uint glomsize = bus->txglomsize;
+	uint qlen, cap;
+
+	*capped = FALSE;
+	if (bus->txglom_lat && bus->txglom_frame_us) {
+		/* only a hint, no need for the txq lock */
+		qlen = pktq_mlen(&bus->txq, prec_map);
+		if ((qlen < 2 * glomsize) || (DATABUFCNT(bus) < glomsize)) {
+			cap = (bus->txglom_lat << DHD_TXGLOM_FRAC) / bus->txglom_frame_us;
+			if (cap < glomsize) {
+				glomsize = MAX(1, cap);
+				*capped = TRUE;
+			}
+		}
+	}
+
+	bus->txglom_hist[MIN(glomsize, SDPCM_MAXGLOM_SIZE)]++;
+	return glomsize;
+}
+
+/* Fold one pass's time into a per-frame average (1/8 weight, DHD_TXGLOM_FRAC bits) */
+static void
+dhdsdio_frame_us_update(uint32 *avg, uint32 elapsed_us, uint frames)
+{
+	uint32 sample = (elapsed_us << DHD_TXGLOM_FRAC) / frames;
+
+	if (*avg == 0)
+		*avg = sample;
+	else
+		*avg += (sample >> 3) - (*avg >> 3);
+
+	/* 0 means not measured yet */
+	if (*avg == 0)
+		*avg = 1;
+}
+
 static uint
 dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 {
@@ -2107,6 +2626,9 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 	uint datalen = 0;
 	dhd_pub_t *dhd = bus->dhd;
 	sdpcmd_regs_t *regs = bus->regs;
+	uint glomsize = 1;
+	uint64 tx_start = 0;
+	bool capped;
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
@@ -2117,6 +2639,13 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 
 	osh = dhd->osh;
 	tx_prec_map = ~bus->flowcontrol;
+	if (bus->txglom_enable) {
+		glomsize = dhdsdio_txglom_pick(bus, tx_prec_map, &capped);
+		tx_start = OSL_SYSUPTIME_US();
+		/* the rest waits for the next DPC pass, which resched guarantees */
+		if (capped)
+			maxframes = MIN(maxframes, glomsize);
+	}
 	for (cnt = 0; (cnt < maxframes) && DATAOK(bus);) {
 		int i;
 		int num_pkt = 1;
@@ -2125,13 +2654,14 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 
 		dhd_os_sdlock_txq(bus->dhd);
 		if (bus->txglom_enable) {
-			num_pkt = MIN((uint32)DATABUFCNT(bus), (uint32)bus->txglomsize);
+			num_pkt = MIN((uint32)DATABUFCNT(bus), (uint32)glomsize);
 			num_pkt = MIN(num_pkt, ARRAYSIZE(pkts));
 		}
 		num_pkt = MIN(num_pkt, pktq_mlen(&bus->txq, tx_prec_map));
 		for (i = 0; i < num_pkt; i++) {
 			pkts[i] = pktq_mdeq(&bus->txq, ~bus->flowcontrol, &prec_out);
 			datalen += PKTLEN(osh, pkts[i]);
+			DHD_LAT_STAMP(dhd, pkts[i], DHD_LAT_TX_QUEUE);
 		}
 		dhd_os_sdunlock_txq(bus->dhd);
 
@@ -2143,8 +2673,8 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 			dhd->dstats.tx_bytes += datalen;
 		cnt += i;
 
-		/* In poll mode, need to check for other events */
-		if (!bus->intr && cnt)
+		/* In poll mode, need to check for other events (once is enough) */
+		if (!bus->intr && cnt && !bus->ipend)
 		{
 			/* Check device status, signal pending interrupt */
 			R_SDREG(intstatus, &regs->intstatus, retries);
@@ -2157,9 +2687,19 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 
 	}
 
+#ifdef BCMSDIOH_ASYNC
+	if (bus->txasync)
+		dhdsdio_txasync_flush(bus);
+#endif /* BCMSDIOH_ASYNC */
+
+	if (bus->txglom_enable && cnt)
+		dhdsdio_frame_us_update(&bus->txglom_frame_us,
+			(uint32)(OSL_SYSUPTIME_US() - tx_start), cnt);
+
 	dhd_os_sdlock_txq(bus->dhd);
 	txpktqlen = pktq_len(&bus->txq);
 	dhd_os_sdunlock_txq(bus->dhd);
+	txpktqlen += DHD_TXSTAGED(bus);
 
 	/* Do flow-control if needed */
 	if (dhd->up && (dhd->busstate == DHD_BUS_DATA) && (txpktqlen < FCLOW)) {
@@ -2361,7 +2901,7 @@ done:
 }
 
 int
-dhd_bus_rxctl(struct dhd_bus *bus, uchar *msg, uint msglen)
+dhd_bus_rxctl(struct dhd_bus *bus, uint *rxlenp)
 {
 	int timeleft;
 	uint rxlen = 0;
@@ -2373,17 +2913,14 @@ dhd_bus_rxctl(struct dhd_bus *bus, uchar *msg, uint msglen)
 		return -EIO;
 
 	/* Wait until control frame is available */
-	timeleft = dhd_os_ioctl_resp_wait(bus->dhd, &bus->rxlen, &pending);
+	timeleft = dhd_os_ioctl_resp_wait(bus->dhd, rxlenp, &pending);
 
 	dhd_os_sdlock(bus->dhd);
-	rxlen = bus->rxlen;
-	bcopy(bus->rxctl, msg, MIN(msglen, rxlen));
-	bus->rxlen = 0;
+	rxlen = *rxlenp;
 	dhd_os_sdunlock(bus->dhd);
 
 	if (rxlen) {
-		DHD_CTL(("%s: resumed on rxctl frame, got %d expected %d\n",
-			__FUNCTION__, rxlen, msglen));
+		DHD_CTL(("%s: resumed on rxctl frame, got %d\n", __FUNCTION__, rxlen));
 	} else if (timeleft == 0) {
 #ifdef DHD_DEBUG
 		uint32 status, retry = 0;
@@ -2483,9 +3020,14 @@ enum {
 	IOV_FWPATH,
 #endif
 	IOV_TXGLOMSIZE,
+	IOV_TXGLOMLAT,
+	IOV_RXSPEC,
 	IOV_TXGLOMMODE,
 	IOV_HANGREPORT,
-	IOV_TXINRX_THRES
+	IOV_TXINRX_THRES,
+#ifdef BCMSDIOH_ASYNC
+	IOV_TXASYNC,
+#endif /* BCMSDIOH_ASYNC */
 };
 
 const bcm_iovar_t dhdsdio_iovars[] = {
@@ -2537,8 +3079,13 @@ const bcm_iovar_t dhdsdio_iovars[] = {
 	{"fwpath", IOV_FWPATH, 0, IOVT_BUFFER, 0 },
 #endif
 	{"txglomsize", IOV_TXGLOMSIZE, 0, IOVT_UINT32, 0 },
+	{"txglomlat", IOV_TXGLOMLAT, 0, IOVT_UINT32, 0 },
+	{"rxspec", IOV_RXSPEC, 0, IOVT_BOOL, 0 },
 	{"fw_hang_report", IOV_HANGREPORT, 0, IOVT_BOOL, 0 },
 	{"txinrx_thres", IOV_TXINRX_THRES, 0, IOVT_INT32, 0 },
+#ifdef BCMSDIOH_ASYNC
+	{"txasync", IOV_TXASYNC, 0, IOVT_BOOL, 0 },
+#endif /* BCMSDIOH_ASYNC */
 	{NULL, 0, 0, 0, 0 }
 };
 
@@ -2571,11 +3118,17 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 	            bus->intr, bus->intrcount, bus->lastintrs, bus->spurious);
 	bcm_bprintf(strbuf, "pollrate %u pollcnt %u regfails %u\n",
 	            bus->pollrate, bus->pollcnt, bus->regfails);
+	bcm_bprintf(strbuf, "fwdl %u bytes total %u us: read wait %u write %u verify %u "
+	            "nvram %u\n", bus->dl_bytes, bus->dl_total_us, bus->dl_read_us,
+	            bus->dl_write_us, bus->dl_verify_us, bus->dl_nvram_us);
 
 	bcm_bprintf(strbuf, "\nAdditional counters:\n");
 #ifdef DHDENABLE_TAILPAD
-	bcm_bprintf(strbuf, "tx_tailpad_chain %u tx_tailpad_pktget %u\n",
-	            bus->tx_tailpad_chain, bus->tx_tailpad_pktget);
+	bcm_bprintf(strbuf, "tx_tailpad_chain %u tx_tailpad_pktget %u tx_headpad_pktget %u\n",
+	            bus->tx_tailpad_chain, bus->tx_tailpad_pktget, bus->tx_headpad_pktget);
+#endif
+#ifdef OSL_RXCACHE
+	osl_rxcache_stats(bus->dhd->osh, strbuf);
 #endif
 	bcm_bprintf(strbuf, "tx_sderrs %u fcqueued %u rxrtx %u rx_toolong %u rxc_errors %u\n",
 	            bus->tx_sderrs, bus->fcqueued, bus->rxrtx, bus->rx_toolong,
@@ -2589,6 +3142,45 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 	bcm_bprintf(strbuf, "f2rx (hdrs/data) %u (%u/%u), f2tx %u f1regs %u\n",
 	            (bus->f2rxhdrs + bus->f2rxdata), bus->f2rxhdrs, bus->f2rxdata,
 	            bus->f2txdata, bus->f1regdata);
+	if (dhd_intr_mitigate || bus->poll_enter) {
+		uint32 cur = bus->mode_start_us ? (OSL_SYSUPTIME_US() - bus->mode_start_us) : 0;
+
+		bcm_bprintf(strbuf, "intr mitigation %d polling %d enter %u exit %u passes %u "
+		            "intr_ms %u poll_ms %u\n", dhd_intr_mitigate, bus->intr_poll,
+		            bus->poll_enter, bus->poll_exit, bus->poll_passes,
+		            (uint32)((bus->intr_us + (bus->intr_poll ? 0 : cur)) / 1000),
+		            (uint32)((bus->poll_us + (bus->intr_poll ? cur : 0)) / 1000));
+	}
+	bcm_bprintf(strbuf, "rxspec %u len %u hits %u misses %u (%u%%)\n", dhd_rxspec,
+	            bus->rxspec_len, bus->rxspec_hits, bus->rxspec_misses,
+	            (bus->rxspec_hits + bus->rxspec_misses) ? (bus->rxspec_hits * 100 /
+	            (bus->rxspec_hits + bus->rxspec_misses)) : 0);
+#ifdef BCMSDIOH_ASYNC
+	bcm_bprintf(strbuf, "txasync %d queued %u fail %u\n",
+	            bus->txasync, bus->txasync_queued, bus->txasync_fail);
+	bcmsdh_async_dump(bus->sdh, strbuf);
+#endif /* BCMSDIOH_ASYNC */
+	if (bus->txglom_enable) {
+		int i;
+
+		bcm_bprintf(strbuf, "txglom lat %u us, %u us/frame, size picked:",
+		            bus->txglom_lat, bus->txglom_frame_us >> DHD_TXGLOM_FRAC);
+		for (i = 0; i <= SDPCM_MAXGLOM_SIZE; i++) {
+			if (bus->txglom_hist[i])
+				bcm_bprintf(strbuf, " %d:%u", i, bus->txglom_hist[i]);
+		}
+		bcm_bprintf(strbuf, "\n");
+	}
+#ifdef DHD_TXQ_LOCKSTAT
+	bcm_bprintf(strbuf, "txq lock: taken %u contended %u hold_ns total %llu max %u\n",
+	            dhdp->txq_lock_cnt, dhdp->txq_lock_contended,
+	            (unsigned long long)dhdp->txq_lock_hold_ns, dhdp->txq_lock_hold_max);
+#endif /* DHD_TXQ_LOCKSTAT */
+#ifdef DHD_TXSTAGE
+	bcm_bprintf(strbuf, "txstage: staged %u pulls %u pkts %u hiwat %u drops %u\n",
+	            DHD_TXSTAGED(bus), dhdp->txstage_pulls, dhdp->txstage_pkts,
+	            dhdp->txstage_hiwat, bus->txstage_drops);
+#endif /* DHD_TXSTAGE */
 	{
 		dhd_dump_pct(strbuf, "\nRx: pkts/f2rd", bus->dhd->rx_packets,
 		             (bus->f2rxhdrs + bus->f2rxdata));
@@ -2631,6 +3223,10 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 		            bus->pktgen_total, bus->pktgen_minlen, bus->pktgen_maxlen);
 		bcm_bprintf(strbuf, "send attempts %u rcvd %u fail %u\n",
 		            bus->pktgen_sent, bus->pktgen_rcvd, bus->pktgen_fail);
+		bcm_bprintf(strbuf, "bytes sent %u rcvd %u, us/frame tx %u rx %u\n",
+		            bus->pktgen_sent_bytes, bus->pktgen_rcvd_bytes,
+		            bus->pktgen_tx_us >> DHD_TXGLOM_FRAC,
+		            bus->rxframe_us >> DHD_TXGLOM_FRAC);
 	}
 #endif /* SDTEST */
 #ifdef DHD_DEBUG
@@ -2640,6 +3236,13 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 #endif /* DHD_DEBUG */
 	bcm_bprintf(strbuf, "clkstate %d activity %d idletime %d idlecount %d sleeping %d\n",
 	            bus->clkstate, bus->activity, bus->idletime, bus->idlecount, bus->sleeping);
+	bcm_bprintf(strbuf, "clkwait max %u us, log2 us bins:", bus->clkwait_max_us);
+	bcm_bprhist(strbuf, bus->clkwait_hist, DHD_CLKWAIT_NBINS);
+	bcm_bprintf(strbuf, "\n");
+	if (dhd_clk_predict)
+		bcm_bprintf(strbuf, "clk predict period %u ms conf %u prewakes %u hits %u "
+		            "wasted %u late %u\n", bus->clk_period_ms, bus->clk_conf,
+		            bus->clk_prewakes, bus->clk_hits, bus->clk_wasted, bus->clk_late);
 }
 
 void
@@ -2652,10 +3255,33 @@ dhd_bus_clearcounts(dhd_pub_t *dhdp)
 	bus->rx_hdrfail = bus->rx_badhdr = bus->rx_badseq = 0;
 #ifdef DHDENABLE_TAILPAD
 	bus->tx_tailpad_chain = bus->tx_tailpad_pktget = 0;
+	bus->tx_headpad_pktget = 0;
+#endif
+#ifdef OSL_RXCACHE
+	osl_rxcache_clearcounts(dhdp->osh);
 #endif
 	bus->tx_sderrs = bus->fc_rcvd = bus->fc_xoff = bus->fc_xon = 0;
 	bus->rxglomfail = bus->rxglomframes = bus->rxglompkts = 0;
 	bus->f2rxhdrs = bus->f2rxdata = bus->f2txdata = bus->f1regdata = 0;
+	bus->rxspec_hits = bus->rxspec_misses = 0;
+	bus->poll_enter = bus->poll_exit = bus->poll_passes = 0;
+	bus->poll_us = bus->intr_us = 0;
+	bus->mode_start_us = 0;
+	bus->clk_prewakes = bus->clk_hits = bus->clk_wasted = bus->clk_late = 0;
+	bus->clkwait_max_us = 0;
+	bzero(bus->clkwait_hist, sizeof(bus->clkwait_hist));
+#ifdef BCMSDIOH_ASYNC
+	bus->txasync_queued = bus->txasync_fail = 0;
+#endif /* BCMSDIOH_ASYNC */
+	bzero(bus->txglom_hist, sizeof(bus->txglom_hist));
+#ifdef DHD_TXQ_LOCKSTAT
+	dhdp->txq_lock_cnt = dhdp->txq_lock_contended = dhdp->txq_lock_hold_max = 0;
+	dhdp->txq_lock_hold_ns = 0;
+#endif /* DHD_TXQ_LOCKSTAT */
+#ifdef DHD_TXSTAGE
+	dhdp->txstage_pulls = dhdp->txstage_pkts = dhdp->txstage_hiwat = 0;
+	bus->txstage_drops = 0;
+#endif /* DHD_TXSTAGE */
 }
 
 #ifdef SDTEST
@@ -2705,7 +3331,7 @@ dhdsdio_pktgen_set(dhd_bus_t *bus, uint8 *arg)
 	bus->pktgen_stop = pktgen.stop;
 
 	bus->pktgen_tick = bus->pktgen_ptick = 0;
-	bus->pktgen_prev_time = jiffies;
+	bus->pktgen_prev_time = OSL_SYSUPTIME_US();
 	bus->pktgen_len = MAX(bus->pktgen_len, bus->pktgen_minlen);
 	bus->pktgen_len = MIN(bus->pktgen_len, bus->pktgen_maxlen);
 
@@ -2713,6 +3339,9 @@ dhdsdio_pktgen_set(dhd_bus_t *bus, uint8 *arg)
 	if (bus->pktgen_count && (!oldcnt || oldmode != bus->pktgen_mode)) {
 		bus->pktgen_sent = bus->pktgen_prev_sent = bus->pktgen_rcvd = 0;
 		bus->pktgen_prev_rcvd = bus->pktgen_fail = 0;
+		bus->pktgen_sent_bytes = bus->pktgen_prev_sent_bytes = 0;
+		bus->pktgen_rcvd_bytes = bus->pktgen_prev_rcvd_bytes = 0;
+		bus->rxframe_us = bus->pktgen_tx_us = 0;
 	}
 
 	return 0;
@@ -2856,6 +3485,20 @@ dhdsdio_readshared(dhd_bus_t *bus, sdpcm_shared_t *sh)
 
 #define CONSOLE_LINE_MAX	192
 
+/* Refresh buf[start..end) from the dongle log buffer, widened to 4-byte units */
+static int
+dhdsdio_readconsole_range(dhd_bus_t *bus, uint32 addr, uint start, uint end)
+{
+	dhd_console_t *c = &bus->console;
+
+	start = ROUNDDN(start, 4);
+	end = MIN(ROUNDUP(end, 4), c->bufsize);
+	if (start >= end)
+		return BCME_OK;
+
+	return dhdsdio_membytes(bus, FALSE, addr + start, c->buf + start, end - start);
+}
+
 static int
 dhdsdio_readconsole(dhd_bus_t *bus)
 {
@@ -2893,10 +3536,16 @@ dhdsdio_readconsole(dhd_bus_t *bus)
 	if (idx == c->last)
 		return BCME_OK;
 
-	/* Read the console buffer */
+	/* Read only what was written since the last poll, in two pieces if it wrapped */
 	addr = ltoh32(c->log.buf);
-	if ((rv = dhdsdio_membytes(bus, FALSE, addr, c->buf, c->bufsize)) < 0)
+	if (idx < c->fetched) {
+		if ((rv = dhdsdio_readconsole_range(bus, addr, c->fetched, c->bufsize)) < 0)
+			return rv;
+		c->fetched = 0;
+	}
+	if ((rv = dhdsdio_readconsole_range(bus, addr, c->fetched, idx)) < 0)
 		return rv;
+	c->fetched = idx;
 
 	while (c->last != idx) {
 		for (n = 0; n < CONSOLE_LINE_MAX - 2; n++) {
@@ -2921,7 +3570,11 @@ dhdsdio_readconsole(dhd_bus_t *bus)
 			if (line[n - 1] == '\r')
 				n--;
 			line[n] = 0;
+#ifdef DHD_DBG_CONSOLE
+			dhd_dbg_console_line((char *)line, n);
+#else
 			printf("CONSOLE: %s\n", line);
+#endif /* DHD_DBG_CONSOLE */
 #ifdef LOG_INTO_TCPDUMP
 			dhd_sendup_log(bus->dhd, line, n);
 #endif /* LOG_INTO_TCPDUMP */
@@ -3421,6 +4074,7 @@ dhdsdio_doiovar(dhd_bus_t *bus, const bcm_iovar_t *vi, uint32 actionid, const ch
 	case IOV_SVAL(IOV_INTR):
 		bus->intr = bool_val;
 		bus->intdis = FALSE;
+		bus->intr_poll = FALSE;
 		if (bus->dhd->up) {
 			if (bus->intr) {
 				DHD_INTR(("%s: enable SDIO device interrupts\n", __FUNCTION__));
@@ -3875,6 +4529,24 @@ dhdsdio_doiovar(dhd_bus_t *bus, const bcm_iovar_t *vi, uint32 actionid, const ch
 			bus->txglomsize = (uint)int_val;
 		}
 		break;
+
+	case IOV_GVAL(IOV_TXGLOMLAT):
+		int_val = (int32)bus->txglom_lat;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_TXGLOMLAT):
+		bus->txglom_lat = (uint32)int_val;
+		break;
+
+	case IOV_GVAL(IOV_RXSPEC):
+		int_val = (int32)dhd_rxspec;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_RXSPEC):
+		dhd_rxspec = bool_val;
+		break;
 	case IOV_SVAL(IOV_HANGREPORT):
 		bus->dhd->hang_report = bool_val;
 		DHD_ERROR(("%s: Set hang_report as %d\n", __FUNCTION__, bus->dhd->hang_report));
@@ -3897,6 +4569,17 @@ dhdsdio_doiovar(dhd_bus_t *bus, const bcm_iovar_t *vi, uint32 actionid, const ch
 		}
 		break;
 
+#ifdef BCMSDIOH_ASYNC
+	case IOV_GVAL(IOV_TXASYNC):
+		int_val = (int32)bus->txasync;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_TXASYNC):
+		bus->txasync = bool_val;
+		break;
+#endif /* BCMSDIOH_ASYNC */
+
 	default:
 		bcmerror = BCME_UNSUPPORTED;
 		break;
@@ -4348,6 +5031,10 @@ dhd_bus_stop(struct dhd_bus *bus, bool enforce_mutex)
 		dhdsdio_clkctl(bus, CLK_SDONLY, FALSE);
 	}
 
+#ifdef DHD_TXSTAGE
+	/* staged frames are flushed along with txq */
+	dhdsdio_txstage_splice(bus);
+#endif /* DHD_TXSTAGE */
 #ifdef PROP_TXSTATUS
 	wlfc_enabled = (dhd_wlfc_cleanup_txq(bus->dhd, NULL, 0) != WLFC_UNSUPPORTED);
 #endif
@@ -4512,6 +5199,7 @@ dhd_bus_init(dhd_pub_t *dhdp, bool enforce_mutex)
 		/* bcmsdh_intr_unmask(bus->sdh); */
 
 		bus->intdis = FALSE;
+		bus->intr_poll = FALSE;
 		if (bus->intr) {
 			DHD_INTR(("%s: enable SDIO device interrupts\n", __FUNCTION__));
 			bcmsdh_intr_enable(bus->sdh);
@@ -4626,8 +5314,31 @@ fail:
 		bus->dhd->busstate = DHD_BUS_DOWN;
 }
 
+/* Size the speculative header read to the usual rx frame (plus a quarter),
+ * or turn it off while frames are usually too long for one
+ */
+static void
+dhdsdio_rxspec_update(dhd_bus_t *bus, uint len)
+{
+	uint avg;
+
+	if (bus->rxspec_avg == 0)
+		bus->rxspec_avg = len << 3;
+	else
+		bus->rxspec_avg += len - (bus->rxspec_avg >> 3);
+
+	avg = bus->rxspec_avg >> 3;
+	avg += avg >> 2;
+	if (bus->blocksize && (avg > bus->blocksize))
+		avg = ROUNDUP(avg, bus->blocksize);
+	else
+		avg = ROUNDUP(avg, DHD_SDALIGN);
+
+	bus->rxspec_len = (avg <= DHD_RXSPEC_MAX) ? avg : 0;
+}
+
 static void
-dhdsdio_read_control(dhd_bus_t *bus, uint8 *hdr, uint len, uint doff)
+dhdsdio_read_control(dhd_bus_t *bus, uint8 *hdr, uint len, uint doff, uint hdrread)
 {
 	bcmsdh_info_t *sdh = bus->sdh;
 	uint rdlen, pad;
@@ -4644,16 +5355,16 @@ dhdsdio_read_control(dhd_bus_t *bus, uint8 *hdr, uint len, uint doff)
 	/* Set rxctl for frame (w/optional alignment) */
 	bus->rxctl = bus->rxbuf;
 	if (dhd_alignctl) {
-		bus->rxctl += firstread;
+		bus->rxctl += hdrread;
 		if ((pad = ((uintptr)bus->rxctl % DHD_SDALIGN)))
 			bus->rxctl += (DHD_SDALIGN - pad);
-		bus->rxctl -= firstread;
+		bus->rxctl -= hdrread;
 	}
 	ASSERT(bus->rxctl >= bus->rxbuf);
 
 	/* Copy the already-read portion over */
-	bcopy(hdr, bus->rxctl, firstread);
-	if (len <= firstread)
+	bcopy(hdr, bus->rxctl, MIN(hdrread, len));
+	if (len <= hdrread)
 		goto gotpkt;
 
 	/* Copy the full data pkt in gSPI case and process ioctl. */
@@ -4663,7 +5374,7 @@ dhdsdio_read_control(dhd_bus_t *bus, uint8 *hdr, uint len, uint doff)
 	}
 
 	/* Raise rdlen to next SDIO block to avoid tail command */
-	rdlen = len - firstread;
+	rdlen = len - hdrread;
 	if (bus->roundup && bus->blocksize && (rdlen > bus->blocksize)) {
 		pad = bus->blocksize - (rdlen % bus->blocksize);
 		if ((pad <= bus->roundup) && (pad < bus->blocksize) &&
@@ -4678,7 +5389,7 @@ dhdsdio_read_control(dhd_bus_t *bus, uint8 *hdr, uint len, uint doff)
 		rdlen = ROUNDUP(rdlen, ALIGNMENT);
 
 	/* Drop if the read is too big or it exceeds our maximum */
-	if ((rdlen + firstread) > bus->dhd->maxctl) {
+	if ((rdlen + hdrread) > bus->dhd->maxctl) {
 		DHD_ERROR(("%s: %d-byte control read exceeds %d-byte buffer\n",
 		           __FUNCTION__, rdlen, bus->dhd->maxctl));
 		bus->dhd->rx_errors++;
@@ -4697,7 +5408,7 @@ dhdsdio_read_control(dhd_bus_t *bus, uint8 *hdr, uint len, uint doff)
 
 	/* Read remainder of frame body into the rxctl buffer */
 	sdret = dhd_bcmsdh_recv_buf(bus, bcmsdh_cur_sbwad(sdh), SDIO_FUNC_2, F2SYNC,
-	                            (bus->rxctl + firstread), rdlen, NULL, NULL, NULL);
+	                            (bus->rxctl + hdrread), rdlen, NULL, NULL, NULL);
 	bus->f2rxdata++;
 	ASSERT(sdret != BCME_PENDING);
 
@@ -4721,6 +5432,9 @@ gotpkt:
 	bus->rxctl += doff;
 	bus->rxlen = len - doff;
 
+	/* Hand the response to the request waiting on its id */
+	dhd_prot_ctl_complete(bus->dhd, bus->rxctl, bus->rxlen);
+
 done:
 	/* Awake any waiters */
 	dhd_os_ioctl_resp_wake(bus->dhd);
@@ -4729,6 +5443,49 @@ int
 dhd_process_pkt_reorder_info(dhd_pub_t *dhd, uchar *reorder_info_buf, uint reorder_info_len,
 	void **pkt, uint32 *pkt_count);
 
+/* A chain is about to go to dhd_rx_frame. If it is picked for tracing, close
+ * its read stage and tag every frame in it with the interrupt time. Frames of
+ * other chains get a zero tag: OSL_PKTTAG_CLEAR stops short of it, so a reused
+ * buffer could otherwise carry stamps from an earlier frame.
+ */
+static void
+dhdsdio_lat_rx(dhd_bus_t *bus, void *pkt)
+{
+	dhd_lat_tag_t *lat;
+	uint32 t0 = 0, now = 0;
+
+	if (dhd_lat_pick(bus->dhd)) {
+		now = OSL_SYSUPTIME_US();
+		dhd_lat_account(bus->dhd, DHD_LAT_RX_READ, now - bus->lat_rd_us);
+		t0 = bus->lat_t0_us;
+	}
+
+	for (; pkt; pkt = PKTNEXT(bus->dhd->osh, pkt)) {
+		lat = DHD_LAT_TAG(pkt);
+		lat->t0 = t0;
+		lat->ts = now;
+	}
+}
+
+/* Hand a chain to dhd_rx_frame with the bus unlocked */
+static void
+dhdsdio_rx_deliver(dhd_bus_t *bus, int ifidx, void *pkt, int cnt, uint8 chan)
+{
+#ifdef SDTEST
+	uint64 start = OSL_SYSUPTIME_US();
+#endif
+
+	dhdsdio_lat_rx(bus, pkt);
+	dhd_os_sdunlock(bus->dhd);
+	dhd_rx_frame(bus->dhd, ifidx, pkt, cnt, chan);
+	dhd_os_sdlock(bus->dhd);
+	if (dhd_lat_sample)
+		bus->lat_rd_us = OSL_SYSUPTIME_US();
+#ifdef SDTEST
+	bus->rxdeliver_us += (uint32)(OSL_SYSUPTIME_US() - start);
+#endif
+}
+
 static uint8
 dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 {
@@ -4795,7 +5552,7 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 			}
 
 			/* Allocate/chain packet for next subframe */
-			if ((pnext = PKTGET(osh, sublen + DHD_SDALIGN, FALSE)) == NULL) {
+			if ((pnext = PKTGET_RX(osh, sublen + DHD_SDALIGN, FALSE)) == NULL) {
 				DHD_ERROR(("%s: PKTGET failed, num %d len %d\n",
 				           __FUNCTION__, num, sublen));
 				break;
@@ -5141,11 +5898,8 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 					temp = PKTNEXT(osh, temp);
 					cnt++;
 				} while (temp);
-				if (cnt) {
-					dhd_os_sdunlock(bus->dhd);
-					dhd_rx_frame(bus->dhd, idx, list_head[idx], cnt, 0);
-					dhd_os_sdlock(bus->dhd);
-				}
+				if (cnt)
+					dhdsdio_rx_deliver(bus, idx, list_head[idx], cnt, 0);
 			}
 		}
 		bus->rxglomframes++;
@@ -5208,10 +5962,16 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 	uchar reorder_info_buf[WLHOST_REORDERDATA_TOTLEN];
 	uint reorder_info_len;
 	uint pkt_count;
+	uint hdrread;	/* Bytes read with the frame header */
+	bool rxspec = dhd_rxspec;	/* Frame known pending, may read ahead */
 
 #if defined(DHD_DEBUG) || defined(SDTEST)
 	bool sdtest = FALSE;	/* To limit message spew from test mode */
 #endif
+#ifdef SDTEST
+	uint64 rx_start = OSL_SYSUPTIME_US();
+	uint32 rx_deliver = bus->rxdeliver_us;
+#endif
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
@@ -5254,6 +6014,9 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 #endif /* DEBUG_COUNTER */
 #endif /* DHDTCPACK_SUP_DBG */
 		/* tx more to improve rx performance */
+#ifdef DHD_TXSTAGE
+		dhdsdio_txstage_splice(bus);
+#endif /* DHD_TXSTAGE */
 		if (TXCTLOK(bus) && bus->ctrl_frame_stat && (bus->clkstate == CLK_AVAIL)) {
 			dhdsdio_sendpendctl(bus);
 		} else if (bus->dotxinrx && (bus->clkstate == CLK_AVAIL) &&
@@ -5313,7 +6076,7 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 			 */
 			/* Allocate a packet buffer */
 			dhd_os_sdlock_rxq(bus->dhd);
-			if (!(pkt = PKTGET(osh, rdlen + DHD_SDALIGN, FALSE))) {
+			if (!(pkt = PKTGET_RX(osh, rdlen + DHD_SDALIGN, FALSE))) {
 				if (bus->bus == SPI_BUS) {
 					bus->usebufpool = FALSE;
 					bus->rxctl = bus->rxbuf;
@@ -5505,7 +6268,7 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 
 			if (chan == SDPCM_CONTROL_CHANNEL) {
 				if (bus->bus == SPI_BUS) {
-					dhdsdio_read_control(bus, rxbuf, len, doff);
+					dhdsdio_read_control(bus, rxbuf, len, doff, firstread);
 					if (bus->usebufpool) {
 						dhd_os_sdlock_rxq(bus->dhd);
 						PKTFREE(bus->dhd->osh, pkt, FALSE);
@@ -5562,9 +6325,16 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 		}
 #endif /* SDHOST3 */
 
-		/* Read frame header (hardware and software) */
+		/* Read frame header (hardware and software). For the first frame of
+		 * the pass one is known to be pending, so also read the body of a
+		 * usual-size frame; later header reads most often find none.
+		 */
+		hdrread = firstread;
+		if (rxspec && (bus->rxspec_len > firstread))
+			hdrread = bus->rxspec_len;
+		rxspec = FALSE;
 		sdret = dhd_bcmsdh_recv_buf(bus, bcmsdh_cur_sbwad(sdh), SDIO_FUNC_2, F2SYNC,
-		                            bus->rxhdr, firstread, NULL, NULL, NULL);
+		                            bus->rxhdr, hdrread, NULL, NULL, NULL);
 		bus->f2rxhdrs++;
 		ASSERT(sdret != BCME_PENDING);
 
@@ -5606,6 +6376,15 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 			continue;
 		}
 
+		/* Track the usual frame size for the next speculative read */
+		if (hdrread > firstread) {
+			if (len <= hdrread)
+				bus->rxspec_hits++;
+			else
+				bus->rxspec_misses++;
+		}
+		dhdsdio_rxspec_update(bus, len);
+
 		/* Extract software header fields */
 		chan = SDPCM_PACKET_CHANNEL(&bus->rxhdr[SDPCM_FRAMETAG_LEN]);
 		seq = SDPCM_PACKET_SEQUENCE(&bus->rxhdr[SDPCM_FRAMETAG_LEN]);
@@ -5665,7 +6444,7 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 
 		/* Call a separate function for control frames */
 		if (chan == SDPCM_CONTROL_CHANNEL) {
-			dhdsdio_read_control(bus, bus->rxhdr, len, doff);
+			dhdsdio_read_control(bus, bus->rxhdr, len, doff, hdrread);
 			continue;
 		}
 
@@ -5673,13 +6452,13 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 		       (chan == SDPCM_TEST_CHANNEL) || (chan == SDPCM_GLOM_CHANNEL));
 
 		/* Length to read */
-		rdlen = (len > firstread) ? (len - firstread) : 0;
+		rdlen = (len > hdrread) ? (len - hdrread) : 0;
 
 		/* May pad read to blocksize for efficiency */
 		if (bus->roundup && bus->blocksize && (rdlen > bus->blocksize)) {
 			pad = bus->blocksize - (rdlen % bus->blocksize);
 			if ((pad <= bus->roundup) && (pad < bus->blocksize) &&
-			    ((rdlen + pad + firstread) < MAX_RX_DATASZ))
+			    ((rdlen + pad + hdrread) < MAX_RX_DATASZ))
 				rdlen += pad;
 		} else if (rdlen % DHD_SDALIGN) {
 			rdlen += DHD_SDALIGN - (rdlen % DHD_SDALIGN);
@@ -5689,7 +6468,11 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 		if (forcealign && (rdlen & (ALIGNMENT - 1)))
 			rdlen = ROUNDUP(rdlen, ALIGNMENT);
 
-		if ((rdlen + firstread) > MAX_RX_DATASZ) {
+		/* Whole frame already read, only keep what it needs */
+		if (rdlen == 0)
+			hdrread = MIN(hdrread, ROUNDUP(len, DHD_SDALIGN));
+
+		if ((rdlen + hdrread) > MAX_RX_DATASZ) {
 			/* Too long -- skip this frame */
 			DHD_ERROR(("%s: too long: len %d rdlen %d\n", __FUNCTION__, len, rdlen));
 			bus->dhd->rx_errors++; bus->rx_toolong++;
@@ -5698,7 +6481,7 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 		}
 
 		dhd_os_sdlock_rxq(bus->dhd);
-		if (!(pkt = PKTGET(osh, (rdlen + firstread + DHD_SDALIGN), FALSE))) {
+		if (!(pkt = PKTGET_RX(osh, (rdlen + hdrread + DHD_SDALIGN), FALSE))) {
 			/* Give up on data, request rtx of events */
 			DHD_ERROR(("%s: PKTGET failed: rdlen %d chan %d\n",
 			           __FUNCTION__, rdlen, chan));
@@ -5712,15 +6495,19 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 		ASSERT(!PKTLINK(pkt));
 
 		/* Leave room for what we already read, and align remainder */
-		ASSERT(firstread < (PKTLEN(osh, pkt)));
-		PKTPULL(osh, pkt, firstread);
+		ASSERT(hdrread < (PKTLEN(osh, pkt)));
+		PKTPULL(osh, pkt, hdrread);
 		PKTALIGN(osh, pkt, rdlen, DHD_SDALIGN);
 
 		/* Read the remaining frame data */
-		sdret = dhd_bcmsdh_recv_buf(bus, bcmsdh_cur_sbwad(sdh), SDIO_FUNC_2, F2SYNC,
-		                            ((uint8 *)PKTDATA(osh, pkt)), rdlen, pkt, NULL, NULL);
-		bus->f2rxdata++;
-		ASSERT(sdret != BCME_PENDING);
+		sdret = 0;
+		if (rdlen) {
+			sdret = dhd_bcmsdh_recv_buf(bus, bcmsdh_cur_sbwad(sdh), SDIO_FUNC_2,
+			                            F2SYNC, ((uint8 *)PKTDATA(osh, pkt)), rdlen,
+			                            pkt, NULL, NULL);
+			bus->f2rxdata++;
+			ASSERT(sdret != BCME_PENDING);
+		}
 
 		if (sdret < 0) {
 			DHD_ERROR(("%s: read %d %s bytes failed: %d\n", __FUNCTION__, rdlen,
@@ -5735,8 +6522,8 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 		}
 
 		/* Copy the already-read portion */
-		PKTPUSH(osh, pkt, firstread);
-		bcopy(bus->rxhdr, PKTDATA(osh, pkt), firstread);
+		PKTPUSH(osh, pkt, hdrread);
+		bcopy(bus->rxhdr, PKTDATA(osh, pkt), hdrread);
 
 #ifdef DHD_DEBUG
 		if (DHD_BYTES_ON() && DHD_DATA_ON()) {
@@ -5803,11 +6590,16 @@ deliver:
 			pkt_count = 1;
 
 		/* Unlock during rx call */
-		dhd_os_sdunlock(bus->dhd);
-		dhd_rx_frame(bus->dhd, ifidx, pkt, pkt_count, chan);
-		dhd_os_sdlock(bus->dhd);
+		dhdsdio_rx_deliver(bus, ifidx, pkt, pkt_count, chan);
 	}
 	rxcount = maxframes - rxleft;
+#ifdef SDTEST
+	/* Per-frame rx time for the pktgen report, bus side only */
+	if (rxcount) {
+		dhdsdio_frame_us_update(&bus->rxframe_us, (uint32)(OSL_SYSUPTIME_US() - rx_start) -
+			(bus->rxdeliver_us - rx_deliver), rxcount);
+	}
+#endif /* SDTEST */
 #ifdef DHD_DEBUG
 	/* Message if we hit the limit */
 	if (!rxleft && !sdtest)
@@ -5830,6 +6622,46 @@ deliver:
 	return rxcount;
 }
 
+/* Read intstatus for the DPC. When it shows I_HMB_HOST_INT, the mailbox data
+ * read in the same transfer is kept for dhdsdio_hostmail. The firmware writes
+ * the data before raising the interrupt and intstatus is read first, so the
+ * copy is never older than the interrupt it goes with.
+ */
+static uint32
+dhdsdio_intstatus_read(dhd_bus_t *bus)
+{
+	static const uint16 offs[] = {
+		OFFSETOF(sdpcmd_regs_t, intstatus),
+		OFFSETOF(sdpcmd_regs_t, tohostmailboxdata)
+	};
+	uint32 vals[ARRAYSIZE(offs)];
+	uint retries = 0;
+
+	bus->hmb_valid = FALSE;
+	bus->f1regdata++;
+
+	if (!dhd_f1_regbatch) {
+		R_SDREG(vals[0], &bus->regs->intstatus, retries);
+		return vals[0];
+	}
+
+	while (bcmsdh_reg_read_batch(bus->sdh, (uint32)(uintptr)bus->regs, offs, vals,
+		ARRAYSIZE(offs))) {
+		if (++retries > retry_limit) {
+			DHD_ERROR(("%s: FAILED intstatus READ\n", __FUNCTION__));
+			return 0;
+		}
+	}
+	if (retries)
+		bus->regfails += retries;
+
+	if (vals[0] & I_HMB_HOST_INT) {
+		bus->hmb_data = vals[1];
+		bus->hmb_valid = TRUE;
+	}
+	return vals[0];
+}
+
 static uint32
 dhdsdio_hostmail(dhd_bus_t *bus)
 {
@@ -5841,11 +6673,17 @@ dhdsdio_hostmail(dhd_bus_t *bus)
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
-	/* Read mailbox data and ack that we did so */
-	R_SDREG(hmb_data, &regs->tohostmailboxdata, retries);
+	/* Read mailbox data, unless it came with intstatus, and ack that we did so */
+	if (bus->hmb_valid) {
+		hmb_data = bus->hmb_data;
+		bus->hmb_valid = FALSE;
+	} else {
+		R_SDREG(hmb_data, &regs->tohostmailboxdata, retries);
+		bus->f1regdata++;
+	}
 	if (retries <= retry_limit)
 		W_SDREG(SMB_INT_ACK, &regs->tosbmailbox, retries);
-	bus->f1regdata += 2;
+	bus->f1regdata++;
 
 	/* Dongle recomposed rx frames, accept them again */
 	if (hmb_data & HMB_DATA_NAKHANDLED) {
@@ -5886,6 +6724,12 @@ dhdsdio_hostmail(dhd_bus_t *bus)
 			sdpcm_shared_t shared;
 			if (dhdsdio_readshared(bus, &shared) == 0)
 				bus->console_addr = shared.console_addr;
+			/* A new image starts its log over, maybe with another size */
+			bus->console.last = bus->console.fetched = 0;
+			if (bus->console.buf != NULL) {
+				MFREE(bus->dhd->osh, bus->console.buf, bus->console.bufsize);
+				bus->console.buf = NULL;
+			}
 		}
 #endif /* DHD_DEBUG */
 	}
@@ -5930,6 +6774,63 @@ dhdsdio_hostmail(dhd_bus_t *bus)
 	return intstatus;
 }
 
+/* Leave polling mode, charging the time since mode_start_us to poll_us */
+static void
+dhdsdio_intr_poll_exit(dhd_bus_t *bus, uint32 now)
+{
+	bus->poll_us += now - bus->mode_start_us;
+	bus->mode_start_us = now;
+	bus->intr_poll = FALSE;
+	bus->poll_exit++;
+}
+
+/* Adaptive interrupt mitigation (dhd_intr_mitigate), in the spirit of NAPI.
+ * A DPC pass that uses up its dhd_rxbound or dhd_txbound switches to polling:
+ * device interrupts stay masked and the DPC reschedules itself to re-read
+ * intstatus. Polling ends after DHD_POLL_LIGHT_PASSES passes in a row that move
+ * less than a quarter of the bounds, or after dhd_intr_poll_ms; the pass after
+ * that re-enables interrupts at clkwait. Returns TRUE if the DPC should run again.
+ */
+static bool
+dhdsdio_intr_adapt(dhd_bus_t *bus, uint work, bool exhausted)
+{
+	uint32 now = OSL_SYSUPTIME_US();
+
+	if (!bus->mode_start_us)
+		bus->mode_start_us = now;
+
+	if (!bus->intr_poll) {
+		if (!exhausted)
+			return FALSE;
+		bus->intr_us += now - bus->mode_start_us;
+		bus->mode_start_us = now;
+		bus->intr_poll = TRUE;
+		bus->poll_light = 0;
+		bus->poll_enter++;
+		if (!bus->intdis) {
+			DHD_INTR(("%s: disable SDIO interrupts, polling\n", __FUNCTION__));
+			bcmsdh_intr_disable(bus->sdh);
+			bus->intdis = TRUE;
+		}
+	} else {
+		bus->poll_passes++;
+		if (work < (dhd_rxbound + dhd_txbound) / 4)
+			bus->poll_light++;
+		else
+			bus->poll_light = 0;
+
+		if (!dhd_intr_mitigate || (bus->poll_light >= DHD_POLL_LIGHT_PASSES) ||
+		    (dhd_intr_poll_ms && (now - bus->mode_start_us >= dhd_intr_poll_ms * 1000))) {
+			dhdsdio_intr_poll_exit(bus, now);
+			return TRUE;
+		}
+	}
+
+	/* Look at the device again on the next pass */
+	bus->ipend = TRUE;
+	return TRUE;
+}
+
 static bool
 dhdsdio_dpc(dhd_bus_t *bus)
 {
@@ -5957,6 +6858,17 @@ dhdsdio_dpc(dhd_bus_t *bus)
 	/* Start with leftover status bits */
 	intstatus = bus->intstatus;
 
+	if (dhd_lat_sample) {
+		bus->lat_rd_us = OSL_SYSUPTIME_US();
+		bus->lat_t0_us = bus->lat_rd_us | 1;
+		if (bus->lat_isr_us) {
+			dhd_lat_account(bus->dhd, DHD_LAT_RX_DPC,
+				bus->lat_rd_us - bus->lat_isr_us);
+			bus->lat_t0_us = bus->lat_isr_us;
+			bus->lat_isr_us = 0;
+		}
+	}
+
 	if (!SLPAUTO_ENAB(bus) && !KSO_ENAB(bus)) {
 		DHD_ERROR(("%s: Device asleep\n", __FUNCTION__));
 		goto exit;
@@ -6002,6 +6914,7 @@ dhdsdio_dpc(dhd_bus_t *bus)
 				bus->dhd->busstate = DHD_BUS_DOWN;
 			}
 			bus->clkstate = CLK_AVAIL;
+			dhdsdio_clkwait_account(bus, OSL_SYSUPTIME_US() - bus->clk_req_us);
 		} else {
 			goto clkwait;
 		}
@@ -6017,8 +6930,7 @@ dhdsdio_dpc(dhd_bus_t *bus)
 	/* Pending interrupt indicates new device status */
 	if (bus->ipend) {
 		bus->ipend = FALSE;
-		R_SDREG(newstatus, &regs->intstatus, retries);
-		bus->f1regdata++;
+		newstatus = dhdsdio_intstatus_read(bus);
 		if (bcmsdh_regfail(bus->sdh))
 			newstatus = 0;
 		newstatus &= bus->hostintmask;
@@ -6044,8 +6956,8 @@ dhdsdio_dpc(dhd_bus_t *bus)
 	if (intstatus & I_HMB_FC_CHANGE) {
 		intstatus &= ~I_HMB_FC_CHANGE;
 		W_SDREG(I_HMB_FC_CHANGE, &regs->intstatus, retries);
-		R_SDREG(newstatus, &regs->intstatus, retries);
-		bus->f1regdata += 2;
+		newstatus = dhdsdio_intstatus_read(bus);
+		bus->f1regdata++;
 		bus->fcstate = !!(newstatus & (I_HMB_FC_STATE | I_HMB_FC_CHANGE));
 		intstatus |= (newstatus & bus->hostintmask);
 	}
@@ -6106,11 +7018,18 @@ dhdsdio_dpc(dhd_bus_t *bus)
 	bus->intstatus = intstatus;
 
 clkwait:
+	/* Polling needs the clock and a DPC that comes back. A pass that ends
+	 * without the clock (e.g. CLK_PENDING) does neither, so fall back to the
+	 * interrupt, which also signals the clock coming up.
+	 */
+	if (bus->intr_poll && (bus->clkstate != CLK_AVAIL))
+		dhdsdio_intr_poll_exit(bus, OSL_SYSUPTIME_US());
+
 	/* Re-enable interrupts to detect new device events (mailbox, rx frame)
 	 * or clock availability.  (Allows tx loop to check ipend if desired.)
 	 * (Unless register access seems hosed, as we may not be able to ACK...)
 	 */
-	if (bus->intr && bus->intdis && !bcmsdh_regfail(sdh)) {
+	if (bus->intr && bus->intdis && !bus->intr_poll && !bcmsdh_regfail(sdh)) {
 		DHD_INTR(("%s: enable SDIO interrupts, rxdone %d framecnt %d\n",
 		          __FUNCTION__, rxdone, framecnt));
 		bus->intdis = FALSE;
@@ -6139,6 +7058,9 @@ clkwait:
 #ifdef PROP_TXSTATUS
 	dhd_wlfc_commit_packets(bus->dhd, (f_commitpkt_t)dhd_bus_txdata, (void *)bus, NULL, FALSE);
 #endif
+#ifdef DHD_TXSTAGE
+	dhdsdio_txstage_splice(bus);
+#endif /* DHD_TXSTAGE */
 
 	if (TXCTLOK(bus) && bus->ctrl_frame_stat && (bus->clkstate == CLK_AVAIL))
 		dhdsdio_sendpendctl(bus);
@@ -6172,10 +7094,19 @@ clkwait:
 		/* Awaiting I_CHIPACTIVE; don't resched */
 	} else if (bus->intstatus || bus->ipend ||
 	           (!bus->fcstate && pktq_mlen(&bus->txq, ~bus->flowcontrol) && DATAOK(bus)) ||
+	           (!bus->fcstate && DHD_TXSTAGED(bus)) ||
 			PKT_AVAILABLE(bus, bus->intstatus)) {  /* Read multiple frames */
 		resched = TRUE;
 	}
 
+	if ((dhd_intr_mitigate || bus->intr_poll) && bus->intr &&
+	    (bus->dhd->busstate != DHD_BUS_DOWN) && !bcmsdh_regfail(sdh) &&
+	    (bus->clkstate == CLK_AVAIL)) {
+		if (dhdsdio_intr_adapt(bus, (dhd_rxbound - rxlimit) + (dhd_txbound - txlimit),
+		                       (rxlimit == 0) || (txlimit == 0)))
+			resched = TRUE;
+	}
+
 	bus->dpc_sched = resched;
 
 	/* If we're done for now, turn off clock request. */
@@ -6192,6 +7123,11 @@ exit:
 	}
 
 	dhd_os_sdunlock(bus->dhd);
+#ifdef OSL_RXCACHE
+	/* Top up rx buffers once the DPC is done, rather than per frame */
+	if (!resched)
+		osl_rxcache_refill(bus->dhd->osh);
+#endif /* OSL_RXCACHE */
 	return resched;
 }
 
@@ -6231,6 +7167,8 @@ dhdsdio_isr(void *arg)
 	/* Count the interrupt call */
 	bus->intrcount++;
 	bus->ipend = TRUE;
+	if (dhd_lat_sample && !bus->lat_isr_us)
+		bus->lat_isr_us = OSL_SYSUPTIME_US() | 1;
 
 	/* Shouldn't get this interrupt if we're sleeping? */
 	if (!SLPAUTO_ENAB(bus)) {
@@ -6288,6 +7226,7 @@ dhdsdio_pktgen_init(dhd_bus_t *bus)
 	/* Default to echo mode */
 	bus->pktgen_mode = DHD_PKTGEN_ECHO;
 	bus->pktgen_stop = 1;
+	bus->pktgen_prev_time = OSL_SYSUPTIME_US();
 }
 
 static void
@@ -6299,9 +7238,11 @@ dhdsdio_pktgen(dhd_bus_t *bus)
 	uint fillbyte;
 	osl_t *osh = bus->dhd->osh;
 	uint16 len;
-	ulong time_lapse;
-	uint sent_pkts;
-	uint rcvd_pkts;
+	uint64 now;
+	uint time_lapse;
+	uint sent_pkts, sent_bytes;
+	uint rcvd_pkts, rcvd_bytes;
+	uint64 tx_start;
 
 	/* Display current count if appropriate */
 	if (bus->pktgen_print && (++bus->pktgen_ptick >= bus->pktgen_print)) {
@@ -6309,19 +7250,28 @@ dhdsdio_pktgen(dhd_bus_t *bus)
 		printf("%s: send attempts %d, rcvd %d, errors %d\n",
 		       __FUNCTION__, bus->pktgen_sent, bus->pktgen_rcvd, bus->pktgen_fail);
 
-		/* Print throughput stats only for constant length packet runs */
-		if (bus->pktgen_minlen == bus->pktgen_maxlen) {
-			time_lapse = jiffies - bus->pktgen_prev_time;
-			bus->pktgen_prev_time = jiffies;
-			sent_pkts = bus->pktgen_sent - bus->pktgen_prev_sent;
-			bus->pktgen_prev_sent = bus->pktgen_sent;
-			rcvd_pkts = bus->pktgen_rcvd - bus->pktgen_prev_rcvd;
-			bus->pktgen_prev_rcvd = bus->pktgen_rcvd;
-
-			printf("%s: Tx Throughput %d kbps, Rx Throughput %d kbps\n",
-			  __FUNCTION__,
-			  (sent_pkts * bus->pktgen_len / jiffies_to_msecs(time_lapse)) * 8,
-			  (rcvd_pkts * bus->pktgen_len  / jiffies_to_msecs(time_lapse)) * 8);
+		/* Rates since the last print, counted per packet so any length mix works */
+		now = OSL_SYSUPTIME_US();
+		time_lapse = (uint)(now - bus->pktgen_prev_time) / 1000;
+		bus->pktgen_prev_time = now;
+		sent_pkts = bus->pktgen_sent - bus->pktgen_prev_sent;
+		bus->pktgen_prev_sent = bus->pktgen_sent;
+		rcvd_pkts = bus->pktgen_rcvd - bus->pktgen_prev_rcvd;
+		bus->pktgen_prev_rcvd = bus->pktgen_rcvd;
+		sent_bytes = bus->pktgen_sent_bytes - bus->pktgen_prev_sent_bytes;
+		bus->pktgen_prev_sent_bytes = bus->pktgen_sent_bytes;
+		rcvd_bytes = bus->pktgen_rcvd_bytes - bus->pktgen_prev_rcvd_bytes;
+		bus->pktgen_prev_rcvd_bytes = bus->pktgen_rcvd_bytes;
+
+		if (time_lapse) {
+			printf("%s: Tx %u pkts/s %u kbps, Rx %u pkts/s %u kbps\n",
+			       __FUNCTION__,
+			       sent_pkts * 1000 / time_lapse, sent_bytes * 8 / time_lapse,
+			       rcvd_pkts * 1000 / time_lapse, rcvd_bytes * 8 / time_lapse);
+			printf("%s: bus us/frame tx %u rx %u, txglomsize %u\n", __FUNCTION__,
+			       bus->pktgen_tx_us >> DHD_TXGLOM_FRAC,
+			       bus->rxframe_us >> DHD_TXGLOM_FRAC,
+			       bus->txglom_enable ? bus->txglomsize : 1);
 		}
 	}
 
@@ -6406,11 +7356,18 @@ dhdsdio_pktgen(dhd_bus_t *bus)
 		}
 #endif
 
-		/* Send it */
+		/* Send it, timing the CMD53 itself: test frames bypass sendfromq,
+		 * so txglom_frame_us never sees them
+		 */
+		tx_start = OSL_SYSUPTIME_US();
 		if (dhdsdio_txpkt(bus, SDPCM_TEST_CHANNEL, &pkt, 1, TRUE) != BCME_OK) {
 			bus->pktgen_fail++;
 			if (bus->pktgen_stop && bus->pktgen_stop == bus->pktgen_fail)
 				bus->pktgen_count = 0;
+		} else {
+			dhdsdio_frame_us_update(&bus->pktgen_tx_us,
+				(uint32)(OSL_SYSUPTIME_US() - tx_start), 1);
+			bus->pktgen_sent_bytes += len;
 		}
 		bus->pktgen_sent++;
 
@@ -6490,6 +7447,7 @@ dhdsdio_testrcv(dhd_bus_t *bus, void *pkt, uint seq)
 			PKTFREE(osh, pkt, FALSE);
 			return;
 		}
+		bus->pktgen_rcvd_bytes += len;
 	}
 
 	/* Process as per command */
@@ -6499,6 +7457,7 @@ dhdsdio_testrcv(dhd_bus_t *bus, void *pkt, uint seq)
 		*(uint8 *)(PKTDATA(osh, pkt)) = SDPCM_TEST_ECHORSP;
 		if (dhdsdio_txpkt(bus, SDPCM_TEST_CHANNEL, &pkt, 1, TRUE) == BCME_OK) {
 			bus->pktgen_sent++;
+			bus->pktgen_sent_bytes += len;
 		} else {
 			bus->pktgen_fail++;
 			PKTFREE(osh, pkt, FALSE);
@@ -6615,6 +7574,8 @@ extern bool
 dhd_bus_watchdog(dhd_pub_t *dhdp)
 {
 	dhd_bus_t *bus;
+	uint32 now;
+	uint ticks = 1;
 
 	DHD_TIMER(("%s: Enter\n", __FUNCTION__));
 
@@ -6635,8 +7596,22 @@ dhd_bus_watchdog(dhd_pub_t *dhdp)
 	if (dhdp->busstate == DHD_BUS_DOWN)
 		return FALSE;
 
+	/* A tickless wait stands for several ticks, but never for more than were due */
+	now = OSL_SYSUPTIME();
+	if (bus->wd_last_ms && dhd_watchdog_ms) {
+		ticks = (now - bus->wd_last_ms) / dhd_watchdog_ms;
+		ticks = MIN(ticks, MAX(bus->wd_due_ms / dhd_watchdog_ms, 1));
+		ticks = MAX(ticks, 1);
+	}
+	bus->wd_last_ms = now;
+	bus->wd_due_ms = 0;
+
+	/* Submitted ioctls have nobody waiting on them to notice a timeout */
+	bus->ctl_due_ms = dhd_prot_ctl_expire(dhdp);
+
 	/* Poll period: check device if appropriate. */
-	if (!SLPAUTO_ENAB(bus) && (bus->poll && (++bus->polltick >= bus->pollrate))) {
+	if (!SLPAUTO_ENAB(bus) && bus->poll &&
+	    ((bus->polltick += ticks) >= bus->pollrate)) {
 		uint32 intstatus = 0;
 
 		/* Reset poll tick */
@@ -6671,14 +7646,16 @@ dhd_bus_watchdog(dhd_pub_t *dhdp)
 #ifdef DHD_DEBUG
 	/* Poll for console output periodically */
 	if (dhdp->busstate == DHD_BUS_DATA && dhd_console_ms != 0) {
-		bus->console.count += dhd_watchdog_ms;
+		bus->console.count += ticks * dhd_watchdog_ms;
 		if (bus->console.count >= dhd_console_ms) {
 			bus->console.count -= dhd_console_ms;
 			/* Make sure backplane clock is on */
+			bus->clk_waking = TRUE;
 			if (SLPAUTO_ENAB(bus))
 				dhdsdio_bussleep(bus, FALSE);
 			else
 			dhdsdio_clkctl(bus, CLK_AVAIL, FALSE);
+			bus->clk_waking = FALSE;
 			if (dhdsdio_readconsole(bus) < 0)
 				dhd_console_ms = 0;	/* On error, stop trying */
 		}
@@ -6698,17 +7675,37 @@ dhd_bus_watchdog(dhd_pub_t *dhdp)
 	}
 #endif
 
+	/* Bring the clock up just ahead of predicted traffic */
+	if (DHD_CLK_PREDICTING(bus) && bus->clk_idle && !bus->clk_prewoke &&
+	    ((int32)(now - bus->clk_next_ms) >= 0)) {
+		bus->clk_prewakes++;
+		bus->clk_waking = TRUE;
+		if (SLPAUTO_ENAB(bus))
+			dhdsdio_bussleep(bus, FALSE);
+		else
+			dhdsdio_clkctl(bus, CLK_AVAIL, FALSE);
+		bus->clk_waking = FALSE;
+		bus->clk_prewoke = TRUE;
+		/* Don't let the idle timeout take it before the traffic is overdue */
+		bus->clk_hold_ms = bus->clk_next_ms + MIN(dhd_clk_lead_ms, bus->clk_period_ms) +
+			dhdsdio_clk_tol(bus);
+		/* If nothing comes, try again a period later */
+		bus->clk_next_ms += bus->clk_period_ms;
+	}
+
 	/* On idle timeout clear activity flag and/or turn off clock */
 #ifdef DHD_USE_IDLECOUNT
 	if (bus->activity)
 		bus->activity = FALSE;
 	else {
-		bus->idlecount++;
+		bus->idlecount += ticks;
 
-		if ((bus->idletime > 0) && (bus->idlecount >= bus->idletime)) {
+		if ((bus->idletime > 0) && (bus->idlecount >= bus->idletime) &&
+		    !dhdsdio_clk_held(bus, now)) {
 			DHD_TIMER(("%s: DHD Idle state!!\n", __FUNCTION__));
 			if (SLPAUTO_ENAB(bus)) {
-				if (dhdsdio_bussleep(bus, TRUE) != BCME_BUSY)
+				if ((dhdsdio_bussleep(bus, TRUE) != BCME_BUSY) &&
+				    !DHD_CLK_PREDICTING(bus))
 					dhd_os_wd_timer(bus->dhd, 0);
 			} else
 				dhdsdio_clkctl(bus, CLK_NONE, FALSE);
@@ -6718,7 +7715,8 @@ dhd_bus_watchdog(dhd_pub_t *dhdp)
 	}
 #else
 	if ((bus->idletime > 0) && (bus->clkstate == CLK_AVAIL)) {
-		if (++bus->idlecount >= bus->idletime) {
+		if (((bus->idlecount += ticks) >= bus->idletime) &&
+		    !dhdsdio_clk_held(bus, now)) {
 			bus->idlecount = 0;
 			if (bus->activity) {
 				bus->activity = FALSE;
@@ -6738,6 +7736,77 @@ dhd_bus_watchdog(dhd_pub_t *dhdp)
 	return bus->ipend;
 }
 
+/* For a tickless watchdog: the time until the next poll, console read, ioctl
+ * or idle timeout is due. With the clock already off and nothing periodic configured
+ * there is nothing to wait for; bus activity restarts the timer through
+ * dhd_os_wd_timer().
+ */
+uint
+dhd_bus_watchdog_due(dhd_pub_t *dhdp)
+{
+	dhd_bus_t *bus = dhdp->bus;
+	uint due = 0;
+
+	if (!bus || (dhdp->busstate == DHD_BUS_DOWN) || dhdp->dongle_reset || !dhd_watchdog_ms)
+		return 0;
+
+#ifdef SDTEST
+	if (bus->pktgen_count)
+		return dhd_watchdog_ms;
+#endif /* SDTEST */
+
+	if (!SLPAUTO_ENAB(bus) && bus->poll)
+		due = (bus->polltick < bus->pollrate) ?
+			(bus->pollrate - bus->polltick) * dhd_watchdog_ms : dhd_watchdog_ms;
+
+#ifdef DHD_DEBUG
+	if ((dhdp->busstate == DHD_BUS_DATA) && dhd_console_ms) {
+		uint con = (bus->console.count < dhd_console_ms) ?
+			(dhd_console_ms - bus->console.count) : dhd_watchdog_ms;
+
+		due = due ? MIN(due, con) : con;
+	}
+#endif /* DHD_DEBUG */
+
+	if (DHD_CLK_PREDICTING(bus) && bus->clk_idle && !bus->clk_prewoke) {
+		int32 left = (int32)(bus->clk_next_ms - OSL_SYSUPTIME());
+		uint pw = (left > 0) ? (uint)left : 1;
+
+		due = due ? MIN(due, pw) : pw;
+	}
+
+	if (bus->ctl_due_ms)
+		due = due ? MIN(due, bus->ctl_due_ms) : bus->ctl_due_ms;
+
+	/* Idle timeout, while the clock is still up */
+	if ((bus->idletime > 0) &&
+	    (SLPAUTO_ENAB(bus) ? !bus->sleeping : (bus->clkstate != CLK_NONE))) {
+		uint idle = (bus->idlecount < bus->idletime) ?
+			(bus->idletime - bus->idlecount) * dhd_watchdog_ms : dhd_watchdog_ms;
+
+		due = due ? MIN(due, idle) : idle;
+	}
+
+	bus->wd_due_ms = due;
+	return due;
+}
+
+/* Start of the tx path: with dhd_clk_predict, get the DPC working on the clock
+ * while the frame is still being built, rather than after it is queued.
+ */
+void
+dhd_bus_clk_early(dhd_pub_t *dhdp)
+{
+	dhd_bus_t *bus = dhdp->bus;
+
+	if (!dhd_clk_predict || !bus || bus->dpc_sched || (dhdp->busstate != DHD_BUS_DATA))
+		return;
+	if (bus->sleeping || ((bus->clkstate != CLK_AVAIL) && (bus->clkstate != CLK_PENDING))) {
+		bus->dpc_sched = TRUE;
+		dhd_sched_dpc(bus->dhd);
+	}
+}
+
 #ifdef DHD_DEBUG
 extern int
 dhd_bus_console_in(dhd_pub_t *dhdp, uchar *msg, uint msglen)
@@ -6997,6 +8066,12 @@ dhdsdio_probe(uint16 venid, uint16 devid, uint16 bus_no, uint16 slot,
 		goto fail;
 	}
 
+	/* Ask the stack for room to glom-extend the header and to DHD_SDALIGN the
+	 * tail in place, so dhdsdio_txpkt_preprocess() need not copy the frame
+	 */
+	bus->dhd->tx_headroom = SDPCM_HWEXT_LEN;
+	bus->dhd->tx_tailroom = DHD_SDALIGN;
+
 	/* Allocate buffers */
 	if (!(dhdsdio_probe_malloc(bus, osh, sdh))) {
 		DHD_ERROR(("%s: dhdsdio_probe_malloc failed\n", __FUNCTION__));
@@ -7263,6 +8338,11 @@ dhdsdio_probe_attach(struct dhd_bus *bus, osl_t *osh, void *sdh, void *regsva,
 
 	/* Setting default Glom size */
 	bus->txglomsize = SDPCM_DEFGLOM_SIZE;
+	bus->txglom_lat = dhd_txglom_lat;
+
+#ifdef BCMSDIOH_ASYNC
+	bus->txasync = (bool)dhd_txasync;
+#endif /* BCMSDIOH_ASYNC */
 
 	return TRUE;
 
@@ -7378,13 +8458,22 @@ dhdsdio_probe_init(dhd_bus_t *bus, osl_t *osh, void *sdh)
 	if (bus->pad_pkt == NULL)
 		DHD_ERROR(("failed to allocate padding packet\n"));
 	else {
-		int alignment_offset = 0;
-		uintptr pktprt = (uintptr)PKTDATA(osh, bus->pad_pkt);
-		if (!(pktprt&1) && (pktprt = (pktprt % DHD_SDALIGN)))
-			PKTPUSH(osh, bus->pad_pkt, alignment_offset);
+		uint alignment_offset = (uint)((uintptr)PKTDATA(osh, bus->pad_pkt) % DHD_SDALIGN);
+
+		/* pad_pkt is a chain element like any other, start it on DHD_SDALIGN */
+		if (alignment_offset)
+			PKTPULL(osh, bus->pad_pkt, DHD_SDALIGN - alignment_offset);
 		PKTSETNEXT(osh, bus->pad_pkt, NULL);
 	}
 
+#ifdef OSL_RXCACHE
+	/* Rx reads never exceed MAX_RX_DATASZ, the largest class covers that in blocks */
+	if (dhd_rxcache_depth &&
+	    osl_rxcache_init(osh, dhd_rxcache_depth, (bus->blocksize ?
+	    ROUNDUP(MAX_RX_DATASZ, bus->blocksize) : MAX_RX_DATASZ) + DHD_SDALIGN))
+		DHD_ERROR(("%s: failed to allocate rx cache\n", __FUNCTION__));
+#endif /* OSL_RXCACHE */
+
 	/* Query if bus module supports packet chaining, default to use if supported */
 	if (bcmsdh_iovar_op(sdh, "sd_rxchain", NULL, 0,
 	                    &bus->sd_rxchain, sizeof(int32), FALSE) != BCME_OK) {
@@ -7469,6 +8558,9 @@ dhdsdio_release(dhd_bus_t *bus, osl_t *osh)
 
 		if (bus->pad_pkt)
 			PKTFREE(osh, bus->pad_pkt, FALSE);
+#ifdef OSL_RXCACHE
+		osl_rxcache_cleanup(osh);
+#endif /* OSL_RXCACHE */
 
 		MFREE(osh, bus, sizeof(dhd_bus_t));
 	}
@@ -7723,62 +8815,140 @@ err:
 }
 #endif /* BCMEMBEDIMAGE */
 
+/* Read the downloaded image back in dhd_dl_blksz chunks and check its CRC32 */
+static int
+dhdsdio_download_verify(struct dhd_bus *bus, uint32 start, uint32 size, uint8 *buf, uint blksz)
+{
+	uint32 crc = CRC32_INIT_VALUE;
+	uint32 offset;
+	uint len;
+	int bcmerror;
+
+	for (offset = 0; offset < size; offset += len) {
+		len = MIN(blksz, size - offset);
+		if ((bcmerror = dhdsdio_membytes(bus, FALSE, start + offset, buf, len))) {
+			DHD_ERROR(("%s: error %d on reading %d membytes at 0x%08x\n",
+			        __FUNCTION__, bcmerror, len, start + offset));
+			return bcmerror;
+		}
+		crc = hndcrc32(buf, len, crc);
+	}
+
+	if (crc != bus->dl_crc) {
+		DHD_ERROR(("%s: image crc 0x%08x, dongle ram crc 0x%08x\n",
+		           __FUNCTION__, bus->dl_crc, crc));
+		return BCME_ERROR;
+	}
+
+	return BCME_OK;
+}
+
 static int
 dhdsdio_download_code_file(struct dhd_bus *bus, char *pfw_path)
 {
 	int bcmerror = -1;
 	int offset = 0;
-	int len;
+	int len, next;
 	void *image = NULL;
-	uint8 *memblock = NULL, *memptr;
+	uint8 *memblock = NULL, *memptr[2];
+	uint blksz, i = 0;
+	bool cr4, rd_pending = FALSE;
+	uint32 start, t;
 
 	DHD_INFO(("%s: download firmware %s\n", __FUNCTION__, pfw_path));
 
+	bus->dl_bytes = 0;
+	bus->dl_crc = CRC32_INIT_VALUE;
+	bus->dl_read_us = bus->dl_write_us = bus->dl_verify_us = 0;
+
 	image = dhd_os_open_image(pfw_path);
 	if (image == NULL) {
 		DHD_ERROR(("%s: Failed to open firmware file %s \n", __FUNCTION__, pfw_path));
 		goto err;
 	}
 
-	memptr = memblock = MALLOC(bus->dhd->osh, MEMBLOCK + DHD_SDALIGN);
+	/* Blocks are written through one backplane window at most */
+	blksz = MIN(MAX(dhd_dl_blksz, MEMBLOCK), SBSDIO_SB_OFT_ADDR_LIMIT);
+	blksz = ROUNDDN(blksz, MEMBLOCK);
+	if ((memblock = MALLOC(bus->dhd->osh, 2 * blksz + DHD_SDALIGN)) == NULL) {
+		blksz = MEMBLOCK;
+		memblock = MALLOC(bus->dhd->osh, 2 * blksz + DHD_SDALIGN);
+	}
 	if (memblock == NULL) {
-		DHD_ERROR(("%s: Failed to allocate memory %d bytes\n", __FUNCTION__, MEMBLOCK));
+		DHD_ERROR(("%s: Failed to allocate memory %d bytes\n", __FUNCTION__,
+		           2 * blksz + DHD_SDALIGN));
 		goto err;
 	}
+	memptr[0] = memblock;
 	if ((uint32)(uintptr)memblock % DHD_SDALIGN)
-		memptr += (DHD_SDALIGN - ((uint32)(uintptr)memblock % DHD_SDALIGN));
+		memptr[0] += (DHD_SDALIGN - ((uint32)(uintptr)memblock % DHD_SDALIGN));
+	memptr[1] = memptr[0] + blksz;
 
-	/* Download image */
-	while ((len = dhd_os_get_image_block((char*)memptr, MEMBLOCK, image))) {
+	/* check if CR4 */
+	if ((cr4 = (si_setcore(bus->sih, ARMCR4_CORE_ID, 0) != NULL))) {
+		/* Add start of RAM address to the address given by user */
+		offset += bus->dongle_ram_base;
+	}
+	start = offset;
+
+	/* Download image, reading the next block while the current one is written */
+	t = OSL_SYSUPTIME_US();
+	len = dhd_os_get_image_block((char*)memptr[0], blksz, image);
+	bus->dl_read_us += OSL_SYSUPTIME_US() - t;
+	while (len) {
 		if (len < 0) {
 			DHD_ERROR(("%s: dhd_os_get_image_block failed (%d)\n", __FUNCTION__, len));
 			bcmerror = BCME_ERROR;
 			goto err;
 		}
-		/* check if CR4 */
-		if (si_setcore(bus->sih, ARMCR4_CORE_ID, 0)) {
-			/* if address is 0, store the reset instruction to be written in 0 */
 
-			if (offset == 0) {
-				bus->resetinstr = *(((uint32*)memptr));
-				/* Add start of RAM address to the address given by user */
-				offset += bus->dongle_ram_base;
-			}
-		}
+		/* if address is 0, store the reset instruction to be written in 0 */
+		if (cr4 && (bus->dl_bytes == 0))
+			bus->resetinstr = *(((uint32*)memptr[i]));
+
+		dhd_os_get_image_block_async((char*)memptr[i ^ 1], blksz, image);
+		rd_pending = TRUE;
 
-		bcmerror = dhdsdio_membytes(bus, TRUE, offset, memptr, len);
+		t = OSL_SYSUPTIME_US();
+		bcmerror = dhdsdio_membytes(bus, TRUE, offset, memptr[i], len);
+		bus->dl_write_us += OSL_SYSUPTIME_US() - t;
 		if (bcmerror) {
 			DHD_ERROR(("%s: error %d on writing %d membytes at 0x%08x\n",
-			        __FUNCTION__, bcmerror, MEMBLOCK, offset));
+			        __FUNCTION__, bcmerror, len, offset));
 			goto err;
 		}
+		if (dhd_dl_verify)
+			bus->dl_crc = hndcrc32(memptr[i], len, bus->dl_crc);
 
-		offset += MEMBLOCK;
+		offset += len;
+		bus->dl_bytes += len;
+
+		t = OSL_SYSUPTIME_US();
+		next = dhd_os_get_image_block_wait();
+		bus->dl_read_us += OSL_SYSUPTIME_US() - t;
+		rd_pending = FALSE;
+
+		len = next;
+		i ^= 1;
 	}
 
+	if (dhd_dl_verify) {
+		t = OSL_SYSUPTIME_US();
+		bcmerror = dhdsdio_download_verify(bus, start, bus->dl_bytes, memptr[0], blksz);
+		bus->dl_verify_us = OSL_SYSUPTIME_US() - t;
+	}
+
+	DHD_ERROR(("%s: %u bytes in %u byte blocks, read wait %u us, write %u us, "
+	           "verify %u us\n", __FUNCTION__, bus->dl_bytes, blksz, bus->dl_read_us,
+	           bus->dl_write_us, bus->dl_verify_us));
+
 err:
+	/* The read-ahead must finish before its buffer goes away */
+	if (rd_pending)
+		dhd_os_get_image_block_wait();
+
 	if (memblock)
-		MFREE(bus->dhd->osh, memblock, MEMBLOCK + DHD_SDALIGN);
+		MFREE(bus->dhd->osh, memblock, 2 * blksz + DHD_SDALIGN);
 
 	if (image)
 		dhd_os_close_image(image);
@@ -7881,6 +9051,7 @@ static int
 _dhdsdio_download_firmware(struct dhd_bus *bus)
 {
 	int bcmerror = -1;
+	uint32 start = OSL_SYSUPTIME_US(), t;
 
 	bool embed = FALSE;	/* download embedded firmware */
 	bool dlok = FALSE;	/* download firmware succeeded */
@@ -7939,8 +9110,12 @@ _dhdsdio_download_firmware(struct dhd_bus *bus)
 	/* dhd_bus_set_nvram_params(bus, (char *)&nvram_array); */
 
 	/* External nvram takes precedence if specified */
-	if (dhdsdio_download_nvram(bus)) {
+	t = OSL_SYSUPTIME_US();
+	bcmerror = dhdsdio_download_nvram(bus);
+	bus->dl_nvram_us = OSL_SYSUPTIME_US() - t;
+	if (bcmerror) {
 		DHD_ERROR(("%s: dongle nvram file download failed\n", __FUNCTION__));
+		bcmerror = -1;
 		goto err;
 	}
 
@@ -7952,6 +9127,10 @@ _dhdsdio_download_firmware(struct dhd_bus *bus)
 
 	bcmerror = 0;
 
+	bus->dl_total_us = OSL_SYSUPTIME_US() - start;
+	DHD_ERROR(("%s: firmware download took %u us (nvram %u us)\n", __FUNCTION__,
+	           bus->dl_total_us, bus->dl_nvram_us));
+
 err:
 	return bcmerror;
 }
@@ -7991,8 +9170,12 @@ dhd_bcmsdh_send_buf(dhd_bus_t *bus, uint32 addr, uint fn, uint flags, uint8 *buf
 		ret = bcmsdh_send_buf(bus->sdh, addr, fn, flags, buf, nbytes,
 			pkt, complete, handle);
 
+		/* Nothing reached the bus, the caller falls back to a sync request */
+		if (ret == BCME_UNSUPPORTED)
+			break;
+
 		bus->f2txdata++;
-		ASSERT(ret != BCME_PENDING);
+		ASSERT((ret != BCME_PENDING) || (flags & SDIO_REQ_ASYNC));
 
 		if (ret == BCME_NODEVICE) {
 			DHD_ERROR(("%s: Device asleep already\n", __FUNCTION__));
@@ -8724,6 +9907,9 @@ dhd_bus_pktq_flush(dhd_pub_t *dhdp)
 		dhd_tcpack_info_tbl_clean(bus->dhd);
 #endif /* DHDTCPACK_SUPPRESS */
 		/* Clear the data packet queues */
+#ifdef DHD_TXSTAGE
+		dhdsdio_txstage_splice(bus);
+#endif /* DHD_TXSTAGE */
 		pktq_flush(dhdp->osh, &bus->txq, TRUE, NULL, 0);
 	}
 }
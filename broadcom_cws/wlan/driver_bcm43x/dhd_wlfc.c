@@ -162,6 +162,25 @@ exit:
 		pq->hi_prec = (uint8)prec;
 }
 
+/* return a slot to the tail of the hanger free list */
+static void
+_dhd_wlfc_hanger_put_free_slot(wlfc_hanger_t* h, uint32 slot_id)
+{
+	wlfc_hanger_item_t *item = &h->items[slot_id];
+
+	item->state = WLFC_HANGER_ITEM_STATE_FREE;
+	item->pkt = NULL;
+	item->gen = 0xff;
+	item->identifier = 0;
+	item->next = NULL;
+
+	if (h->free_tail)
+		h->free_tail->next = item;
+	else
+		h->free_head = item;
+	h->free_tail = item;
+}
+
 /* Create a place to store all packet pointers submitted to the firmware until
 	a status comes back, suppress or otherwise.
 
@@ -183,7 +202,7 @@ _dhd_wlfc_hanger_create(osl_t *osh, int max_items)
 	hanger->max_items = max_items;
 
 	for (i = 0; i < hanger->max_items; i++) {
-		hanger->items[i].state = WLFC_HANGER_ITEM_STATE_FREE;
+		_dhd_wlfc_hanger_put_free_slot(hanger, i);
 	}
 	return hanger;
 }
@@ -200,25 +219,16 @@ _dhd_wlfc_hanger_delete(osl_t *osh, void* hanger)
 	return BCME_BADARG;
 }
 
+/* peek at the oldest free slot; it is only taken off the list by pushpkt */
 static uint16
 _dhd_wlfc_hanger_get_free_slot(void* hanger)
 {
-	uint32 i;
 	wlfc_hanger_t* h = (wlfc_hanger_t*)hanger;
 
 	if (h) {
-		i = h->slot_pos + 1;
-		if (i == h->max_items) {
-			i = 0;
-		}
-		while (i != h->slot_pos) {
-			if (h->items[i].state == WLFC_HANGER_ITEM_STATE_FREE) {
-				h->slot_pos = i;
-				return (uint16)i;
-			}
-			i++;
-			if (i == h->max_items)
-				i = 0;
+		if (h->free_head) {
+			ASSERT(h->free_head->state == WLFC_HANGER_ITEM_STATE_FREE);
+			return (uint16)(h->free_head - &h->items[0]);
 		}
 		h->failed_slotfind++;
 	}
@@ -258,7 +268,25 @@ _dhd_wlfc_hanger_pushpkt(void* hanger, void* pkt, uint32 slot_id)
 	wlfc_hanger_t* h = (wlfc_hanger_t*)hanger;
 
 	if (h && (slot_id < WLFC_HANGER_MAXITEMS)) {
-		if (h->items[slot_id].state == WLFC_HANGER_ITEM_STATE_FREE) {
+		wlfc_hanger_item_t *item = &h->items[slot_id];
+
+		if (item->state == WLFC_HANGER_ITEM_STATE_FREE) {
+			if (item == h->free_head) {
+				h->free_head = item->next;
+			} else {
+				/* not from get_free_slot, unlink the slot the slow way */
+				wlfc_hanger_item_t *prev = h->free_head;
+
+				while (prev->next != item)
+					prev = prev->next;
+				prev->next = item->next;
+				if (h->free_tail == item)
+					h->free_tail = prev;
+			}
+			if (h->free_head == NULL)
+				h->free_tail = NULL;
+			item->next = NULL;
+
 			h->items[slot_id].state = WLFC_HANGER_ITEM_STATE_INUSE;
 			h->items[slot_id].pkt = pkt;
 			h->pushed++;
@@ -287,11 +315,7 @@ _dhd_wlfc_hanger_poppkt(void* hanger, uint32 slot_id, void** pktout, int remove_
 		if (h->items[slot_id].state != WLFC_HANGER_ITEM_STATE_FREE) {
 			*pktout = h->items[slot_id].pkt;
 			if (remove_from_hanger) {
-				h->items[slot_id].state =
-					WLFC_HANGER_ITEM_STATE_FREE;
-				h->items[slot_id].pkt = NULL;
-				h->items[slot_id].gen = 0xff;
-				h->items[slot_id].identifier = 0;
+				_dhd_wlfc_hanger_put_free_slot(h, slot_id);
 				h->popped++;
 			}
 		}
@@ -356,10 +380,7 @@ _dhd_wlfc_hanger_wait_clean(void* hanger, uint32 hslot)
 	if ((hslot < (uint32) h->max_items) &&
 		(h->items[hslot].state == WLFC_HANGER_ITEM_STATE_WAIT_CLEAN)) {
 		/* the packet should be already freed by _dhd_wlfc_cleanup */
-		h->items[hslot].state = WLFC_HANGER_ITEM_STATE_FREE;
-		h->items[hslot].pkt = NULL;
-		h->items[hslot].gen = 0xff;
-		h->items[hslot].identifier = 0;
+		_dhd_wlfc_hanger_put_free_slot(h, hslot);
 		return TRUE;
 	}
 
@@ -380,10 +401,7 @@ _dhd_wlfc_hanger_remove_reference(wlfc_hanger_t* h, void* pkt)
 		if (pkt == h->items[i].pkt) {
 			if ((h->items[i].state == WLFC_HANGER_ITEM_STATE_INUSE) ||
 				(h->items[i].state == WLFC_HANGER_ITEM_STATE_INUSE_SUPPRESSED)) {
-				h->items[i].state = WLFC_HANGER_ITEM_STATE_FREE;
-				h->items[i].pkt = NULL;
-				h->items[i].gen = 0xff;
-				h->items[i].identifier = 0;
+				_dhd_wlfc_hanger_put_free_slot(h, i);
 			}
 			return TRUE;
 		}
@@ -591,10 +609,60 @@ _dhd_wlfc_pullheader(athost_wl_status_info_t* ctx, void* pktbuf)
 	return BCME_OK;
 }
 
+static void
+_dhd_wlfc_mac_hash_insert(athost_wl_status_info_t* ctx, uint8 table_index)
+{
+	uint8* ea = ctx->destination_entries.nodes[table_index].ea;
+	uint i, h = WLFC_MAC_HASH(ea);
+
+	for (i = 0; i < WLFC_MAC_HASH_SIZE; i++) {
+		if (ctx->mac_hash[h] == 0) {
+			ctx->mac_hash[h] = table_index + 1;
+			return;
+		}
+		h = (h + 1) & (WLFC_MAC_HASH_SIZE - 1);
+	}
+	ASSERT(0);
+}
+
+/* deletes are rare (MACDESC_DEL), so just re-hash the occupied nodes */
+static void
+_dhd_wlfc_mac_hash_rebuild(athost_wl_status_info_t* ctx)
+{
+	uint8 i;
+
+	memset(ctx->mac_hash, 0, sizeof(ctx->mac_hash));
+	for (i = 0; i < WLFC_MAC_DESC_TABLE_SIZE; i++) {
+		if (ctx->destination_entries.nodes[i].occupied)
+			_dhd_wlfc_mac_hash_insert(ctx, i);
+	}
+}
+
+/* find the occupied node for ea on interface ifid, any interface if ifid < 0 */
+static uint8
+_dhd_wlfc_mac_hash_lookup(athost_wl_status_info_t* ctx, uint8* ea, int ifid)
+{
+	wlfc_mac_descriptor_t* table = ctx->destination_entries.nodes;
+	uint i, h = WLFC_MAC_HASH(ea);
+	uint8 table_index;
+
+	for (i = 0; i < WLFC_MAC_HASH_SIZE; i++) {
+		if (ctx->mac_hash[h] == 0)
+			break;
+		table_index = ctx->mac_hash[h] - 1;
+		if (table[table_index].occupied &&
+			((ifid < 0) || (table[table_index].interface_id == ifid)) &&
+			!memcmp(table[table_index].ea, ea, ETHER_ADDR_LEN))
+			return table_index;
+		h = (h + 1) & (WLFC_MAC_HASH_SIZE - 1);
+	}
+	return WLFC_MAC_DESC_ID_INVALID;
+}
+
 static wlfc_mac_descriptor_t*
 _dhd_wlfc_find_table_entry(athost_wl_status_info_t* ctx, void* p)
 {
-	int i;
+	uint8 table_index;
 	wlfc_mac_descriptor_t* table = ctx->destination_entries.nodes;
 	uint8 ifid = DHD_PKTTAG_IF(PKTTAG(p));
 	uint8* dstn = DHD_PKTTAG_DSTN(PKTTAG(p));
@@ -620,16 +688,9 @@ _dhd_wlfc_find_table_entry(athost_wl_status_info_t* ctx, void* p)
 		return entry;
 	}
 
-	for (i = 0; i < WLFC_MAC_DESC_TABLE_SIZE; i++) {
-		if (table[i].occupied) {
-			if (table[i].interface_id == ifid) {
-				if (!memcmp(table[i].ea, dstn, ETHER_ADDR_LEN)) {
-					entry = &table[i];
-					break;
-				}
-			}
-		}
-	}
+	table_index = _dhd_wlfc_mac_hash_lookup(ctx, dstn, ifid);
+	if (table_index != WLFC_MAC_DESC_ID_INVALID)
+		entry = &table[table_index];
 
 	if (entry == NULL)
 		entry = &ctx->destination_entries.other;
@@ -1569,6 +1630,10 @@ _dhd_wlfc_cleanup(dhd_pub_t *dhd, f_processpkt_t fn, void *arg)
 		}
 	}
 
+	/* nodes were freed above, drop them from the lookup hash too */
+	if (fn == NULL)
+		_dhd_wlfc_mac_hash_rebuild(wlfc);
+
 	/*
 		. flush remained pkt in hanger queue, not in bus->txq nor psq.
 		. the remained pkt was successfully downloaded to dongle already.
@@ -1605,7 +1670,9 @@ _dhd_wlfc_mac_entry_update(athost_wl_status_info_t* ctx, wlfc_mac_descriptor_t*
 	f_processpkt_t fn, void *arg)
 {
 	int rc = BCME_OK;
-
+	bool is_node = (entry >= &ctx->destination_entries.nodes[0]) &&
+		(entry < &ctx->destination_entries.nodes[WLFC_MAC_DESC_TABLE_SIZE]);
+	uint8 was_occupied = entry->occupied;
 
 	if ((action == eWLFC_MAC_ENTRY_ACTION_ADD) || (action == eWLFC_MAC_ENTRY_ACTION_UPDATE)) {
 		entry->occupied = 1;
@@ -1618,6 +1685,14 @@ _dhd_wlfc_mac_entry_update(athost_wl_status_info_t* ctx, wlfc_mac_descriptor_t*
 		if (ea != NULL)
 			memcpy(&entry->ea[0], ea, ETHER_ADDR_LEN);
 
+		if (is_node) {
+			if (was_occupied)
+				_dhd_wlfc_mac_hash_rebuild(ctx);
+			else
+				_dhd_wlfc_mac_hash_insert(ctx,
+					(uint8)(entry - &ctx->destination_entries.nodes[0]));
+		}
+
 		if (action == eWLFC_MAC_ENTRY_ACTION_ADD) {
 			dhd_pub_t *dhdp = (dhd_pub_t *)(ctx->dhdp);
 			pktq_init(&entry->psq, WLFC_PSQ_PREC_COUNT, WLFC_PSQ_LEN);
@@ -1659,6 +1734,9 @@ _dhd_wlfc_mac_entry_update(athost_wl_status_info_t* ctx, wlfc_mac_descriptor_t*
 		entry->suppr_transit_count = 0;
 		memset(&entry->ea[0], 0, ETHER_ADDR_LEN);
 
+		if (is_node)
+			_dhd_wlfc_mac_hash_rebuild(ctx);
+
 		if (entry->next) {
 			/* not floating, remove from Q */
 			if (ctx->active_entry_count <= 1) {
@@ -1859,17 +1937,9 @@ _dhd_wlfc_handle_packet_commit(athost_wl_status_info_t* ctx, int ac,
 static uint8
 _dhd_wlfc_find_mac_desc_id_from_mac(dhd_pub_t *dhdp, uint8* ea)
 {
-	wlfc_mac_descriptor_t* table =
-		((athost_wl_status_info_t*)dhdp->wlfc_state)->destination_entries.nodes;
-	uint8 table_index;
-
-	if (ea != NULL) {
-		for (table_index = 0; table_index < WLFC_MAC_DESC_TABLE_SIZE; table_index++) {
-			if ((memcmp(ea, &table[table_index].ea[0], ETHER_ADDR_LEN) == 0) &&
-				table[table_index].occupied)
-				return table_index;
-		}
-	}
+	if (ea != NULL)
+		return _dhd_wlfc_mac_hash_lookup((athost_wl_status_info_t*)dhdp->wlfc_state,
+			ea, -1);
 	return WLFC_MAC_DESC_ID_INVALID;
 }
 
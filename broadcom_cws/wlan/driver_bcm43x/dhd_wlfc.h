@@ -74,7 +74,7 @@ typedef struct wlfc_hanger_item {
 #ifdef PROP_TXSTATUS_DEBUG
 	uint32	push_time;
 #endif
-	struct wlfc_hanger_item *next;
+	struct wlfc_hanger_item *next;	/* free list link, valid only while FREE */
 } wlfc_hanger_item_t;
 
 typedef struct wlfc_hanger {
@@ -84,7 +84,9 @@ typedef struct wlfc_hanger {
 	uint32 failed_to_push;
 	uint32 failed_to_pop;
 	uint32 failed_slotfind;
-	uint32 slot_pos;
+	/* FIFO of FREE slots, so a slot is reused as late as possible */
+	wlfc_hanger_item_t *free_head;
+	wlfc_hanger_item_t *free_tail;
 	wlfc_hanger_item_t items[1];
 } wlfc_hanger_t;
 
@@ -241,6 +243,10 @@ typedef struct athost_wl_stat_counters {
 /* Mask to represent available ACs (note: BC/MC is ignored */
 #define WLFC_AC_MASK 0xF
 
+/* MAC -> destination_entries.nodes[] lookup, kept at most half full */
+#define WLFC_MAC_HASH_SIZE	(WLFC_MAC_DESC_TABLE_SIZE * 2)
+#define WLFC_MAC_HASH(ea)	(((ea)[3] ^ (ea)[4] ^ (ea)[5]) & (WLFC_MAC_HASH_SIZE - 1))
+
 typedef struct athost_wl_status_info {
 	uint8	last_seqid_to_wlc;
 
@@ -271,6 +277,8 @@ typedef struct athost_wl_status_info {
 		/* A place holder for bc/mc and packets to unknown destinations */
 		wlfc_mac_descriptor_t	other;
 	} destination_entries;
+	/* open addressed, holds node index + 1 so that 0 marks an empty bucket */
+	uint8	mac_hash[WLFC_MAC_HASH_SIZE];
 
 	wlfc_mac_descriptor_t *active_entry_head;
 	int active_entry_count;
@@ -335,6 +343,12 @@ typedef struct dhd_pkttag {
 	*/
 	uint16	htod_seq;
 
+	/*
+	Push order of a frame staged by dhd_bus_txdata (DHD_TXSTAGE); fills the
+	hole before entry, so the tag does not grow.
+	*/
+	uint16	stage_seq;
+
 	/*
 	This address is mac entry for every packet.
 	*/
@@ -451,6 +465,9 @@ typedef struct dhd_pkttag {
 #define DHD_PKTTAG_SET_H2DSEQ(tag, seq)		((dhd_pkttag_t*)(tag))->htod_seq = (seq)
 #define DHD_PKTTAG_H2DSEQ(tag)			(((dhd_pkttag_t*)(tag))->htod_seq)
 
+#define DHD_PKTTAG_SET_STAGESEQ(tag, seq)	((dhd_pkttag_t*)(tag))->stage_seq = (seq)
+#define DHD_PKTTAG_STAGESEQ(tag)		(((dhd_pkttag_t*)(tag))->stage_seq)
+
 #define DHD_PKTTAG_SET_ENTRY(tag, entry)	((dhd_pkttag_t*)(tag))->entry = (entry)
 #define DHD_PKTTAG_ENTRY(tag)			(((dhd_pkttag_t*)(tag))->entry)
 
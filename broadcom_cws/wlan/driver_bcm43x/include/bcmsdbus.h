@@ -31,6 +31,7 @@
 
 #define SDIOH_API_RC_SUCCESS                          (0x00)
 #define SDIOH_API_RC_FAIL	                      (0x01)
+#define SDIOH_API_RC_UNSUPPORTED                      (0x02)
 #define SDIOH_API_SUCCESS(status) (status == 0)
 
 #define SDIOH_READ              0	/* Read request */
@@ -101,6 +102,24 @@ extern SDIOH_API_RC sdioh_request_buffer(sdioh_info_t *si, uint pio_dma, uint fi
 	uint rw, uint fnc_num, uint32 addr, uint regwidth, uint32 buflen, uint8 *buffer,
 	void *pkt);
 
+#ifdef BCMSDIOH_ASYNC
+/* completion of a queued cmd53 request, same layout as bcmsdh_cmplt_fn_t */
+typedef void (*sdioh_async_cmplt_fn_t)(void *handle, int status, bool sync_waiting);
+
+/* queue a packet (chain) cmd53 and return without waiting for it to finish. The
+ * previously queued request is completed (cmplt_fn called) before this one is
+ * started. On failure cmplt_fn is never called for this packet.
+ */
+extern SDIOH_API_RC sdioh_request_packet_async(sdioh_info_t *si, uint fix_inc, uint rw,
+	uint fnc_num, uint32 addr, void *pkt, sdioh_async_cmplt_fn_t cmplt_fn, void *handle);
+
+/* wait for all queued cmd53 requests to complete */
+extern SDIOH_API_RC sdioh_request_async_flush(sdioh_info_t *si);
+
+struct bcmstrbuf;
+extern void sdioh_async_dump(sdioh_info_t *si, struct bcmstrbuf *strbuf);
+#endif /* BCMSDIOH_ASYNC */
+
 /* get cis data */
 extern SDIOH_API_RC sdioh_cis_read(sdioh_info_t *si, uint fuc, uint8 *cis, uint32 length);
 
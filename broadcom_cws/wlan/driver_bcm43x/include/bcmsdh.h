@@ -64,6 +64,7 @@ struct bcmsdh_info
 	bool	regfail;	/* Save status of last reg_read/reg_write call */
 	uint32	sbwad;		/* Save backplane window address */
 	void	*os_cxt;        /* Pointer to per-OS private data */
+	uint32	*regbuf;	/* DMA-able buffer for bcmsdh_reg_read_batch */
 };
 
 /* Detach - freeup resources allocated in attach */
@@ -122,6 +123,17 @@ extern int bcmsdh_cis_read(void *sdh, uint func, uint8 *cis, uint length);
 extern uint32 bcmsdh_reg_read(void *sdh, uint32 addr, uint size);
 extern uint32 bcmsdh_reg_write(void *sdh, uint32 addr, uint size, uint32 data);
 
+/* Read several 32-bit core registers with a single CMD53 to F1.
+ *   base: backplane address the offsets are relative to
+ *   offs: register offsets, all within BCMSDH_REGBATCH_MAX bytes and one sb window
+ *   vals: register values, in the order of offs
+ * Every register between the lowest and highest offset is read, so the span
+ * must not cover registers with read side effects. Sets regfail like reg_read.
+ */
+#define BCMSDH_REGBATCH_MAX	128
+extern int bcmsdh_reg_read_batch(void *sdh, uint32 base, const uint16 *offs, uint32 *vals,
+	uint n);
+
 /* set sb address window */
 extern int bcmsdhsdio_set_sbaddr_window(void *sdh, uint32 address, bool force_set);
 
@@ -137,8 +149,9 @@ extern bool bcmsdh_regfail(void *sdh);
  *   pkt:      pointer to packet associated with buf (if any)
  *   complete: callback function for command completion (async only)
  *   handle:   handle for completion callback (first arg in callback)
- * Returns 0 or error code.
- * NOTE: Async operation is not currently supported.
+ * Returns 0 or error code, BCME_PENDING if an async request was queued.
+ * NOTE: Async operation needs BCMSDIOH_ASYNC and a pkt; the request is started
+ * once the previously queued one completes, see bcmsdh_async_flush().
  */
 typedef void (*bcmsdh_cmplt_fn_t)(void *handle, int status, bool sync_waiting);
 extern int bcmsdh_send_buf(void *sdh, uint32 addr, uint fn, uint flags,
@@ -148,6 +161,13 @@ extern int bcmsdh_recv_buf(void *sdh, uint32 addr, uint fn, uint flags,
                            uint8 *buf, uint nbytes, void *pkt,
                            bcmsdh_cmplt_fn_t complete_fn, void *handle);
 
+#ifdef BCMSDIOH_ASYNC
+/* Wait until all queued async requests have completed (callbacks called) */
+extern int bcmsdh_async_flush(void *sdh);
+struct bcmstrbuf;
+extern void bcmsdh_async_dump(void *sdh, struct bcmstrbuf *strbuf);
+#endif /* BCMSDIOH_ASYNC */
+
 extern void bcmsdh_glom_post(void *sdh, uint8 *frame, void *pkt, uint len);
 extern void bcmsdh_glom_clear(void *sdh);
 extern uint bcmsdh_set_mode(void *sdh, uint mode);
@@ -73,6 +73,25 @@
 #define CLIENT_INTR			0x100	/* Get rid of this! */
 #define SDIOH_SDMMC_MAX_SG_ENTRIES	(SDPCM_MAXGLOM_SIZE+2)
 
+/* Pipelined cmd53 relies on mmc_start_req() and the host context_info (3.7+) */
+#if defined(BCMSDIOH_ASYNC) && (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 7, 0))
+#define SDIOH_SDMMC_ASYNC
+
+/* One request on the bus while the next one is being built */
+#define SDIOH_ASYNC_DEPTH		2
+
+typedef struct sdioh_async_req {
+	struct mmc_async_req	areq;
+	struct mmc_request	mrq;
+	struct mmc_command	cmd;
+	struct mmc_data		dat;
+	struct scatterlist	sg_list[SDIOH_SDMMC_MAX_SG_ENTRIES];
+	uint			rw;		/* SDIOH_READ/SDIOH_WRITE */
+	sdioh_async_cmplt_fn_t	cmplt_fn;	/* Set on the last cmd53 of a packet chain only */
+	void			*cmplt_arg;
+} sdioh_async_req_t;
+#endif /* BCMSDIOH_ASYNC && LINUX_VERSION_CODE >= KERNEL_VERSION(3, 7, 0) */
+
 struct sdioh_info {
 	osl_t		*osh;			/* osh handler */
 	void		*bcmsdh;		/* upper layer handle */
@@ -96,6 +115,17 @@ struct sdioh_info {
 	struct scatterlist	sg_list[SDIOH_SDMMC_MAX_SG_ENTRIES];
 	struct sdio_func	fake_func0;
 	struct sdio_func	*func[SDIOD_MAX_IOFUNCS];
+#ifdef SDIOH_SDMMC_ASYNC
+	sdioh_async_req_t	async_req[SDIOH_ASYNC_DEPTH];
+	uint8		async_slot;		/* Next free async_req[] entry */
+	bool		async_ok;		/* sd_async: host set up the mmc context */
+	bool		async_claimed;		/* Host held for in-flight requests */
+	uint		async_inflight[2];	/* Queued cmd53s per direction */
+	uint		async_depth[2][SDIOH_ASYNC_DEPTH];	/* In-flight depth at submit */
+	uint		async_cmplt[2];		/* Completed cmd53s per direction */
+	uint		async_errs[2];		/* Failed cmd53s per direction */
+	int		async_chain_err;	/* First error in the chain being completed */
+#endif /* SDIOH_SDMMC_ASYNC */
 
 };
 
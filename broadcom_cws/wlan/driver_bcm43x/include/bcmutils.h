@@ -993,6 +993,7 @@ struct fielddesc {
 
 extern void bcm_binit(struct bcmstrbuf *b, char *buf, uint size);
 extern void bcm_bprhex(struct bcmstrbuf *b, const char *msg, bool newline, uint8 *buf, int len);
+extern void bcm_bprhist(struct bcmstrbuf *b, const uint32 *bins, uint nbins);
 
 extern void bcm_inc_bytes(uchar *num, int num_bytes, uint8 amount);
 extern int bcm_cmp_bytes(const uchar *arg1, const uchar *arg2, uint8 nbytes);
@@ -1002,6 +1003,7 @@ typedef  uint32 (*bcmutl_rdreg_rtn)(void *arg0, uint arg1, uint32 offset);
 extern uint bcmdumpfields(bcmutl_rdreg_rtn func_ptr, void *arg0, uint arg1, struct fielddesc *str,
                           char *buf, uint32 bufsize);
 extern uint bcm_bitcount(uint8 *bitmap, uint bytelength);
+extern uint bcm_log2_bin(uint32 val, uint nbins);
 
 extern int bcm_bprintf(struct bcmstrbuf *b, const char *fmt, ...);
 
@@ -79,6 +79,10 @@ extern void osl_delay(uint usec);
 #define OSL_SLEEP(ms)			osl_sleep(ms)
 extern void osl_sleep(uint ms);
 
+/* monotonic microsecond timestamp, for measuring intervals */
+#define OSL_SYSUPTIME_US()		osl_sysuptime_us()
+extern uint64 osl_sysuptime_us(void);
+
 #define	OSL_PCMCIA_READ_ATTR(osh, offset, buf, size) \
 	osl_pcmcia_read_attr((osh), (offset), (buf), (size))
 #define	OSL_PCMCIA_WRITE_ATTR(osh, offset, buf, size) \
@@ -301,6 +305,15 @@ extern int osl_error(int bcmerror);
 #define PKTLIST_DUMP(osh, buf)		BCM_REFERENCE(osh)
 #define PKTDBG_TRACE(osh, pkt, bit)	BCM_REFERENCE(osh)
 #define	PKTFREE(osh, skb, send)		osl_pktfree((osh), (skb), (send))
+#ifdef OSL_RXCACHE
+#ifdef BCMDBG_CTRACE
+#define	PKTGET_RX(osh, len, send)	osl_pktget_rx((osh), (len), __LINE__, __FILE__)
+#else
+#define	PKTGET_RX(osh, len, send)	osl_pktget_rx((osh), (len))
+#endif /* BCMDBG_CTRACE */
+#else
+#define	PKTGET_RX	PKTGET
+#endif /* OSL_RXCACHE */
 #ifdef CONFIG_DHD_USE_STATIC_BUF
 #define	PKTGET_STATIC(osh, len, send)		osl_pktget_static((osh), (len))
 #define	PKTFREE_STATIC(osh, skb, send)		osl_pktfree_static((osh), (skb), (send))
@@ -485,6 +498,20 @@ extern void osl_ctfpool_stats(osl_t *osh, void *b);
 #define	PKTISFAST(osh, skb)	({BCM_REFERENCE(osh); BCM_REFERENCE(skb); FALSE;})
 #endif /* CTFPOOL */
 
+#ifdef OSL_RXCACHE
+/* Per-CPU prefill cache of rx skbs in doubling size classes, PKTGET_RX takes
+ * from the smallest class that fits. Freed skbs are not taken back.
+ */
+#define	OSL_RXCACHE_DEPTH	64	/* Max skbs cached per class and CPU */
+#define	OSL_RXCACHE_NCLASS	4	/* Max size classes */
+#define	OSL_RXCACHE_MIN		256	/* Data size of the smallest class */
+extern int32 osl_rxcache_init(osl_t *osh, uint depth, uint max_size);
+extern void osl_rxcache_refill(osl_t *osh);
+extern void osl_rxcache_cleanup(osl_t *osh);
+extern void osl_rxcache_stats(osl_t *osh, void *b);
+extern void osl_rxcache_clearcounts(osl_t *osh);
+#endif /* OSL_RXCACHE */
+
 #define	PKTSETCTF(osh, skb)	({BCM_REFERENCE(osh); BCM_REFERENCE(skb);})
 #define	PKTCLRCTF(osh, skb)	({BCM_REFERENCE(osh); BCM_REFERENCE(skb);})
 #define	PKTISCTF(osh, skb)	({BCM_REFERENCE(osh); BCM_REFERENCE(skb); FALSE;})
@@ -626,6 +653,9 @@ extern void osl_pktfree_static(osl_t *osh, void *skb, bool send);
 #ifdef BCMDBG_CTRACE
 #define PKT_CTRACE_DUMP(osh, b)	osl_ctrace_dump((osh), (b))
 extern void *osl_pktget(osl_t *osh, uint len, int line, char *file);
+#ifdef OSL_RXCACHE
+extern void *osl_pktget_rx(osl_t *osh, uint len, int line, char *file);
+#endif /* OSL_RXCACHE */
 extern void *osl_pkt_frmnative(osl_t *osh, void *skb, int line, char *file);
 extern int osl_pkt_is_frmnative(osl_t *osh, struct sk_buff *pkt);
 extern void *osl_pktdup(osl_t *osh, void *skb, int line, char *file);
@@ -634,6 +664,9 @@ extern void osl_ctrace_dump(osl_t *osh, struct bcmstrbuf *b);
 #else
 extern void *osl_pkt_frmnative(osl_t *osh, void *skb);
 extern void *osl_pktget(osl_t *osh, uint len);
+#ifdef OSL_RXCACHE
+extern void *osl_pktget_rx(osl_t *osh, uint len);
+#endif /* OSL_RXCACHE */
 extern void *osl_pktdup(osl_t *osh, void *skb);
 #endif /* BCMDBG_CTRACE */
 extern struct sk_buff *osl_pkt_tonative(osl_t *osh, void *pkt);
@@ -38,6 +38,7 @@
 #include <osl.h>
 #include <bcmutils.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
 #include <pcicfg.h>
 
 
@@ -111,11 +112,18 @@ struct osl_cmn_info {
 };
 typedef struct osl_cmn_info osl_cmn_t;
 
+#ifdef OSL_RXCACHE
+typedef struct osl_rxcache osl_rxcache_t;
+#endif /* OSL_RXCACHE */
+
 struct osl_info {
 	osl_pubinfo_t pub;
 #ifdef CTFPOOL
 	ctfpool_t *ctfpool;
 #endif /* CTFPOOL */
+#ifdef OSL_RXCACHE
+	osl_rxcache_t *rxcache;
+#endif /* OSL_RXCACHE */
 	uint magic;
 	void *pdev;
 	uint failed;
@@ -621,6 +629,220 @@ osl_pktfastget(osl_t *osh, uint len)
 	return skb;
 }
 #endif /* CTFPOOL */
+
+#ifdef OSL_RXCACHE
+/* Per-CPU caches of preallocated rx skbs, one per size class. The classes
+ * double from OSL_RXCACHE_MIN up to the largest rx read, so a frame never
+ * gets a buffer more than twice its size. Nothing comes back to the cache:
+ * once handed out a cached skb is an ordinary skb, and the DPC tops the
+ * caches up between passes. Each CPU only touches its own cache, with
+ * local irqs off, so get and refill never take a lock.
+ */
+typedef struct osl_rxcache_class {
+	uint	cnt;		/* skbs currently cached */
+	uint	hits;		/* PKTGET_RXs served from the cache */
+	uint	misses;		/* PKTGET_RXs that fell back to the allocator */
+	uint	refills;	/* skbs allocated by osl_rxcache_refill() */
+	struct sk_buff *skb[OSL_RXCACHE_DEPTH];
+} osl_rxcache_class_t;
+
+typedef struct osl_rxcache_cpu {
+	osl_rxcache_class_t cls[OSL_RXCACHE_NCLASS];
+} osl_rxcache_cpu_t;
+
+struct osl_rxcache {
+	uint	depth;				/* skbs to keep per class and CPU */
+	uint	nclass;				/* Classes in use */
+	uint	size[OSL_RXCACHE_NCLASS];	/* Data size of each class */
+	osl_rxcache_cpu_t *cache;		/* per cpu */
+};
+
+/* Smallest class that holds len bytes, nclass if none does */
+static inline uint
+osl_rxcache_class(osl_rxcache_t *rxcache, uint len)
+{
+	uint i;
+
+	for (i = 0; (i < rxcache->nclass) && (rxcache->size[i] < len); i++)
+		;
+	return i;
+}
+
+static inline struct sk_buff *
+osl_rxcache_get(osl_rxcache_t *rxcache, uint i)
+{
+	osl_rxcache_class_t *c;
+	struct sk_buff *skb = NULL;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	c = &per_cpu_ptr(rxcache->cache, smp_processor_id())->cls[i];
+	if (c->cnt > 0) {
+		skb = c->skb[--c->cnt];
+		c->hits++;
+	} else
+		c->misses++;
+	local_irq_restore(flags);
+
+	return skb;
+}
+
+/*
+ * Top up the calling CPU's caches. Meant for the bus DPC/watchdog, outside the
+ * per-frame path, so that rx PKTGET_RXs find a buffer ready. Allocation runs
+ * preemptible; each skb goes to whichever CPU we are on when it is inserted.
+ */
+void
+osl_rxcache_refill(osl_t *osh)
+{
+	osl_rxcache_t *rxcache;
+	osl_rxcache_class_t *c;
+	struct sk_buff *skb;
+	unsigned long flags;
+	uint i, need;
+
+	if ((osh == NULL) || ((rxcache = osh->rxcache) == NULL))
+		return;
+
+	for (i = 0; i < rxcache->nclass; i++) {
+		need = rxcache->depth -
+			per_cpu_ptr(rxcache->cache, raw_smp_processor_id())->cls[i].cnt;
+		while (need--) {
+			if ((skb = osl_alloc_skb(osh, rxcache->size[i])) == NULL)
+				return;
+			local_irq_save(flags);
+			c = &per_cpu_ptr(rxcache->cache, smp_processor_id())->cls[i];
+			if (c->cnt < rxcache->depth) {
+				c->skb[c->cnt++] = skb;
+				c->refills++;
+				skb = NULL;
+			}
+			local_irq_restore(flags);
+			if (skb) {
+				dev_kfree_skb(skb);
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * Set up per-CPU caches of depth skbs per size class, for reads of up to
+ * max_size bytes, and prefill them.
+ */
+int32
+osl_rxcache_init(osl_t *osh, uint depth, uint max_size)
+{
+	osl_rxcache_t *rxcache;
+	osl_rxcache_class_t *c;
+	struct sk_buff *skb;
+	gfp_t flags;
+	uint i, size;
+	int cpu;
+
+	if (osh->rxcache != NULL)
+		return 0;
+
+	flags = CAN_SLEEP() ? GFP_KERNEL: GFP_ATOMIC;
+	if ((rxcache = kzalloc(sizeof(osl_rxcache_t), flags)) == NULL)
+		return -1;
+	if ((rxcache->cache = alloc_percpu(osl_rxcache_cpu_t)) == NULL) {
+		kfree(rxcache);
+		return -1;
+	}
+
+	rxcache->depth = MIN(depth, OSL_RXCACHE_DEPTH);
+	for (size = OSL_RXCACHE_MIN; rxcache->nclass < OSL_RXCACHE_NCLASS - 1; size <<= 1) {
+		if (size >= max_size)
+			break;
+		rxcache->size[rxcache->nclass++] = size;
+	}
+	rxcache->size[rxcache->nclass++] = max_size;
+
+	/* Nobody else can see the cache yet, fill every CPU directly */
+	for_each_possible_cpu(cpu) {
+		for (i = 0; i < rxcache->nclass; i++) {
+			c = &per_cpu_ptr(rxcache->cache, cpu)->cls[i];
+			while (c->cnt < rxcache->depth) {
+				if ((skb = osl_alloc_skb(osh, rxcache->size[i])) == NULL)
+					break;
+				c->skb[c->cnt++] = skb;
+			}
+		}
+	}
+
+	osh->rxcache = rxcache;
+	return 0;
+}
+
+void
+osl_rxcache_cleanup(osl_t *osh)
+{
+	osl_rxcache_t *rxcache;
+	osl_rxcache_class_t *c;
+	uint i;
+	int cpu;
+
+	if ((osh == NULL) || ((rxcache = osh->rxcache) == NULL))
+		return;
+
+	osh->rxcache = NULL;
+	for_each_possible_cpu(cpu) {
+		for (i = 0; i < rxcache->nclass; i++) {
+			c = &per_cpu_ptr(rxcache->cache, cpu)->cls[i];
+			while (c->cnt > 0)
+				dev_kfree_skb(c->skb[--c->cnt]);
+		}
+	}
+	free_percpu(rxcache->cache);
+	kfree(rxcache);
+}
+
+void
+osl_rxcache_stats(osl_t *osh, void *b)
+{
+	struct bcmstrbuf *bb = b;
+	osl_rxcache_t *rxcache;
+	osl_rxcache_class_t *c;
+	uint i, cnt, hits, misses, refills;
+	int cpu;
+
+	if ((osh == NULL) || ((rxcache = osh->rxcache) == NULL))
+		return;
+
+	bcm_bprintf(bb, "rxcache: depth %u\n", rxcache->depth);
+	for (i = 0; i < rxcache->nclass; i++) {
+		cnt = hits = misses = refills = 0;
+		for_each_possible_cpu(cpu) {
+			c = &per_cpu_ptr(rxcache->cache, cpu)->cls[i];
+			cnt += c->cnt;
+			hits += c->hits;
+			misses += c->misses;
+			refills += c->refills;
+		}
+		bcm_bprintf(bb, "  size %u cached %u hits %u misses %u refills %u\n",
+		            rxcache->size[i], cnt, hits, misses, refills);
+	}
+}
+
+void
+osl_rxcache_clearcounts(osl_t *osh)
+{
+	osl_rxcache_class_t *c;
+	uint i;
+	int cpu;
+
+	if ((osh == NULL) || (osh->rxcache == NULL))
+		return;
+
+	for_each_possible_cpu(cpu) {
+		for (i = 0; i < osh->rxcache->nclass; i++) {
+			c = &per_cpu_ptr(osh->rxcache->cache, cpu)->cls[i];
+			c->hits = c->misses = c->refills = 0;
+		}
+	}
+}
+#endif /* OSL_RXCACHE */
 /* Convert a driver packet to native(OS) packet
  * In the process, packettag is zeroed out before sending up
  * IP code depends on skb->cb to be setup correctly with various options
@@ -726,6 +948,44 @@ osl_pktget(osl_t *osh, uint len)
 	return ((void*) skb);
 }
 
+#ifdef OSL_RXCACHE
+/* Return a new rx packet from the smallest cache class that fits len. Sizes
+ * the cache does not cover, and empty classes, go to osl_pktget().
+ */
+#ifdef BCMDBG_CTRACE
+void * BCMFASTPATH
+osl_pktget_rx(osl_t *osh, uint len, int line, char *file)
+#else
+void * BCMFASTPATH
+osl_pktget_rx(osl_t *osh, uint len)
+#endif /* BCMDBG_CTRACE */
+{
+	osl_rxcache_t *rxcache = osh->rxcache;
+	struct sk_buff *skb = NULL;
+	uint i;
+
+	if ((rxcache != NULL) && ((i = osl_rxcache_class(rxcache, len)) < rxcache->nclass))
+		skb = osl_rxcache_get(rxcache, i);
+	if (skb == NULL)
+#ifdef BCMDBG_CTRACE
+		return osl_pktget(osh, len, line, file);
+#else
+		return osl_pktget(osh, len);
+#endif /* BCMDBG_CTRACE */
+
+	skb->tail += len;
+	skb->len  += len;
+	skb->priority = 0;
+
+#ifdef BCMDBG_CTRACE
+	ADD_CTRACE(osh, skb, file, line);
+#endif
+	atomic_inc(&osh->cmn->pktalloced);
+
+	return ((void*) skb);
+}
+#endif /* OSL_RXCACHE */
+
 #ifdef CTFPOOL
 static inline void
 osl_pktfastfree(osl_t *osh, struct sk_buff *skb)
@@ -1306,6 +1566,12 @@ osl_delay(uint usec)
 	}
 }
 
+uint64
+osl_sysuptime_us(void)
+{
+	return (uint64)ktime_to_us(ktime_get());
+}
+
 void
 osl_sleep(uint ms)
 {
@@ -400,10 +400,12 @@ static unsigned long wl_lock_eq(struct bcm_cfg80211 *cfg);
 static void wl_unlock_eq(struct bcm_cfg80211 *cfg, unsigned long flags);
 static void wl_init_eq_lock(struct bcm_cfg80211 *cfg);
 static void wl_init_event_handler(struct bcm_cfg80211 *cfg);
-static struct wl_event_q *wl_deq_event(struct bcm_cfg80211 *cfg);
+static void wl_deinit_eq(struct bcm_cfg80211 *cfg);
+static struct wl_event_q *wl_deq_event(struct bcm_cfg80211 *cfg, struct list_head *batch);
 static s32 wl_enq_event(struct bcm_cfg80211 *cfg, struct net_device *ndev, u32 type,
 	const wl_event_msg_t *msg, void *data);
-static void wl_put_event(struct wl_event_q *e);
+static s32 wl_enq_escan_result(struct bcm_cfg80211 *cfg, const wl_event_msg_t *msg, void *data);
+static void wl_put_event(struct bcm_cfg80211 *cfg, struct wl_event_q *e);
 static void wl_wakeup_event(struct bcm_cfg80211 *cfg);
 static s32 wl_notify_connect_status_ap(struct bcm_cfg80211 *cfg, struct net_device *ndev,
 	const wl_event_msg_t *e, void *data);
@@ -509,6 +511,8 @@ wl_cfg80211_reg_notifier(struct wiphy *wiphy, struct regulatory_request *request
 #endif /* CONFIG_CFG80211_INTERNAL_REGDB */
 
 static s32 wl_inform_bss(struct bcm_cfg80211 *cfg);
+static wl_scan_results_t *wl_escan_get_results(struct bcm_cfg80211 *cfg);
+static void wl_escan_reset_buf(struct bcm_cfg80211 *cfg);
 static s32 wl_inform_single_bss(struct bcm_cfg80211 *cfg, struct wl_bss_info *bi, bool roam);
 static s32 wl_update_bss_info(struct bcm_cfg80211 *cfg, struct net_device *ndev, bool roam);
 static chanspec_t wl_cfg80211_get_shared_freq(struct wiphy *wiphy);
@@ -2203,14 +2207,10 @@ wl_do_escan(struct bcm_cfg80211 *cfg, struct wiphy *wiphy, struct net_device *nd
 {
 	s32 err = BCME_OK;
 	s32 passive_scan;
-	wl_scan_results_t *results;
 	WL_SCAN(("Enter \n"));
 	mutex_lock(&cfg->usr_sync);
 
-	results = wl_escan_get_buf(cfg, FALSE);
-	results->version = 0;
-	results->count = 0;
-	results->buflen = WL_SCAN_RESULTS_FIXED_SIZE;
+	wl_escan_reset_buf(cfg);
 
 	cfg->escan_info.ndev = ndev;
 	cfg->escan_info.wiphy = wiphy;
@@ -9225,21 +9225,280 @@ static s32 wl_notify_escan_complete(struct bcm_cfg80211 *cfg,
 	return err;
 }
 
-static s32 wl_escan_handler(struct bcm_cfg80211 *cfg, bcm_struct_cfgdev *cfgdev,
-	const wl_event_msg_t *e, void *data)
+static u16 wl_escan_bss_hash(wl_bss_info_t *bi)
+{
+	u32 hash = 0;
+	u32 i;
+
+	for (i = 0; i < ETHER_ADDR_LEN; i++)
+		hash = (hash * 31) + bi->BSSID.octet[i];
+	for (i = 0; (i < bi->SSID_len) && (i < DOT11_MAX_SSID_LEN); i++)
+		hash = (hash * 31) + bi->SSID[i];
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+	return (u16)(hash & (ESCAN_BSS_HASH_SIZE - 1));
+}
+
+static void wl_escan_reset_buf(struct bcm_cfg80211 *cfg)
+{
+	struct escan_info *escan = &cfg->escan_info;
+	wl_scan_results_t *list = (wl_scan_results_t *)escan->escan_buf;
+
+	list->version = 0;
+	list->count = 0;
+	list->buflen = WL_SCAN_RESULTS_FIXED_SIZE;
+	escan->bss_cnt = 0;
+	escan->stale_len = 0;
+	memset(escan->bss_hash, 0xff, sizeof(escan->bss_hash));
+}
+
+static void wl_escan_index_bss(struct escan_info *escan, u32 offset, u16 hash)
+{
+	struct escan_bss *ent = &escan->bss[escan->bss_cnt];
+
+	ent->offset = offset;
+	ent->stale = 0;
+	ent->next = escan->bss_hash[hash];
+	escan->bss_hash[hash] = escan->bss_cnt++;
+}
+
+/* Squeeze stale bss_info out of escan_buf and re-index the rest */
+static void wl_escan_compact_buf(struct bcm_cfg80211 *cfg)
+{
+	struct escan_info *escan = &cfg->escan_info;
+	wl_scan_results_t *list = (wl_scan_results_t *)escan->escan_buf;
+	wl_bss_info_t *bi;
+	u32 dst = WL_SCAN_RESULTS_FIXED_SIZE;
+	u32 offset, len;
+	u16 i, cnt;
+
+	if (escan->stale_len == 0)
+		return;
+
+	cnt = escan->bss_cnt;
+	escan->bss_cnt = 0;
+	memset(escan->bss_hash, 0xff, sizeof(escan->bss_hash));
+	/* Entries are in buffer order and only move down, so re-index in place */
+	for (i = 0; i < cnt; i++) {
+		if (escan->bss[i].stale)
+			continue;
+		offset = escan->bss[i].offset;
+		bi = (wl_bss_info_t *)(escan->escan_buf + offset);
+		len = dtoh32(bi->length);
+		if (offset != dst)
+			memmove(escan->escan_buf + dst, bi, len);
+		bi = (wl_bss_info_t *)(escan->escan_buf + dst);
+		wl_escan_index_bss(escan, dst, wl_escan_bss_hash(bi));
+		dst += len;
+	}
+	WL_SCAN(("escan buf compacted %d -> %d bytes, %d -> %d bss\n",
+		list->buflen, dst, list->count, escan->bss_cnt));
+	list->buflen = dst;
+	list->count = escan->bss_cnt;
+	escan->stale_len = 0;
+}
+
+/* Append a bss_info to escan_buf, compacting first if it doesn't fit */
+static s32 wl_escan_add_bss(struct bcm_cfg80211 *cfg, wl_bss_info_t *bi, u16 hash)
+{
+	struct escan_info *escan = &cfg->escan_info;
+	wl_scan_results_t *list = (wl_scan_results_t *)escan->escan_buf;
+	u32 bi_length = dtoh32(bi->length);
+
+	if ((bi_length > ESCAN_BUF_SIZE - list->buflen) || (escan->bss_cnt == ESCAN_BSS_MAX))
+		wl_escan_compact_buf(cfg);
+	if ((bi_length > ESCAN_BUF_SIZE - list->buflen) || (escan->bss_cnt == ESCAN_BSS_MAX))
+		return BCME_NOMEM;
+
+	memcpy(escan->escan_buf + list->buflen, bi, bi_length);
+	wl_escan_index_bss(escan, list->buflen, hash);
+	list->version = dtoh32(bi->version);
+	list->buflen += bi_length;
+	list->count++;
+	return BCME_OK;
+}
+
+/* Flat result list for wl_inform_bss() and friends */
+static wl_scan_results_t *wl_escan_get_results(struct bcm_cfg80211 *cfg)
+{
+	wl_escan_compact_buf(cfg);
+	return (wl_scan_results_t *)cfg->escan_info.escan_buf;
+}
+
+/* One partial escan result, called with usr_sync held */
+static s32
+wl_escan_partial_result(struct bcm_cfg80211 *cfg, wl_escan_result_t *escan_result)
 {
 	s32 err = BCME_OK;
-	s32 status = ntoh32(e->status);
+	s32 status = WLC_E_STATUS_PARTIAL;
 	wl_bss_info_t *bi;
-	wl_escan_result_t *escan_result;
 	wl_bss_info_t *bss = NULL;
 	wl_scan_results_t *list;
 	wifi_p2p_ie_t * p2p_ie;
-	struct net_device *ndev = NULL;
 	u32 bi_length;
-	u32 i;
+	u16 i, hash;
 	u8 *p2p_dev_addr = NULL;
 
+	if (dtoh16(escan_result->bss_count) != 1) {
+		WL_ERR(("Invalid bss_count %d: ignoring\n", escan_result->bss_count));
+		return err;
+	}
+	bi = escan_result->bss_info;
+	if (!bi) {
+		WL_ERR(("Invalid escan bss info (NULL pointer)\n"));
+		return err;
+	}
+	bi_length = dtoh32(bi->length);
+	if (bi_length != (dtoh32(escan_result->buflen) - WL_ESCAN_RESULTS_FIXED_SIZE)) {
+		WL_ERR(("Invalid bss_info length %d: ignoring\n", bi_length));
+		return err;
+	}
+	if (wl_escan_check_sync_id(status, escan_result->sync_id,
+		cfg->escan_info.cur_sync_id) < 0)
+		return err;
+
+	if (!(bcmcfg_to_wiphy(cfg)->interface_modes & BIT(NL80211_IFTYPE_ADHOC))) {
+		if (dtoh16(bi->capability) & DOT11_CAP_IBSS) {
+			WL_DBG(("Ignoring IBSS result\n"));
+			return err;
+		}
+	}
+
+	if (wl_get_drv_status_all(cfg, FINDING_COMMON_CHANNEL)) {
+		p2p_dev_addr = wl_cfgp2p_retreive_p2p_dev_addr(bi, bi_length);
+		if (p2p_dev_addr && !memcmp(p2p_dev_addr,
+			cfg->afx_hdl->tx_dst_addr.octet, ETHER_ADDR_LEN)) {
+			s32 channel = wf_chspec_ctlchan(
+				wl_chspec_driver_to_host(bi->chanspec));
+
+			if ((channel > MAXCHANNEL) || (channel <= 0))
+				channel = WL_INVALID;
+			else
+				WL_ERR(("ACTION FRAME SCAN : Peer " MACDBG " found,"
+					" channel : %d\n",
+					MAC2STRDBG(cfg->afx_hdl->tx_dst_addr.octet),
+					channel));
+
+			wl_clr_p2p_status(cfg, SCANNING);
+			cfg->afx_hdl->peer_chan = channel;
+			complete(&cfg->act_frm_scan);
+			return err;
+		}
+
+	} else {
+		struct escan_info *escan = &cfg->escan_info;
+
+		list = (wl_scan_results_t *)escan->escan_buf;
+		if (scan_req_match(cfg)) {
+			/* p2p scan && allow only probe response */
+			if ((cfg->p2p->search_state != WL_P2P_DISC_ST_SCAN) &&
+				(bi->flags & WL_BSS_FLAGS_FROM_BEACON))
+				return err;
+			if ((p2p_ie = wl_cfgp2p_find_p2pie(((u8 *) bi) + bi->ie_offset,
+				bi->ie_length)) == NULL) {
+					WL_ERR(("Couldn't find P2PIE in probe"
+						" response/beacon\n"));
+					return err;
+			}
+		}
+		hash = wl_escan_bss_hash(bi);
+		for (i = escan->bss_hash[hash]; i != ESCAN_BSS_NONE;
+			i = escan->bss[i].next) {
+			if (escan->bss[i].stale)
+				continue;
+			bss = (wl_bss_info_t *)(escan->escan_buf + escan->bss[i].offset);
+
+			if (!bcmp(&bi->BSSID, &bss->BSSID, ETHER_ADDR_LEN) &&
+				(CHSPEC_BAND(wl_chspec_driver_to_host(bi->chanspec))
+				== CHSPEC_BAND(wl_chspec_driver_to_host(bss->chanspec))) &&
+				bi->SSID_len == bss->SSID_len &&
+				!bcmp(bi->SSID, bss->SSID, bi->SSID_len)) {
+
+				/* do not allow beacon data to update
+				*the data recd from a probe response
+				*/
+				if (!(bss->flags & WL_BSS_FLAGS_FROM_BEACON) &&
+					(bi->flags & WL_BSS_FLAGS_FROM_BEACON))
+					return err;
+
+				WL_DBG(("%s("MACDBG"), i=%d prev: RSSI %d"
+					" flags 0x%x, new: RSSI %d flags 0x%x\n",
+					bss->SSID, MAC2STRDBG(bi->BSSID.octet), i,
+					bss->RSSI, bss->flags, bi->RSSI, bi->flags));
+
+				if ((bss->flags & WL_BSS_FLAGS_RSSI_ONCHANNEL) ==
+					(bi->flags & WL_BSS_FLAGS_RSSI_ONCHANNEL)) {
+					/* preserve max RSSI if the measurements are
+					* both on-channel or both off-channel
+					*/
+					WL_SCAN(("%s("MACDBG"), same onchan"
+					", RSSI: prev %d new %d\n",
+					bss->SSID, MAC2STRDBG(bi->BSSID.octet),
+					bss->RSSI, bi->RSSI));
+					bi->RSSI = MAX(bss->RSSI, bi->RSSI);
+				} else if ((bss->flags & WL_BSS_FLAGS_RSSI_ONCHANNEL) &&
+					(bi->flags & WL_BSS_FLAGS_RSSI_ONCHANNEL) == 0) {
+					/* preserve the on-channel rssi measurement
+					* if the new measurement is off channel
+					*/
+					WL_SCAN(("%s("MACDBG"), prev onchan"
+					", RSSI: prev %d new %d\n",
+					bss->SSID, MAC2STRDBG(bi->BSSID.octet),
+					bss->RSSI, bi->RSSI));
+					bi->RSSI = bss->RSSI;
+					bi->flags |= WL_BSS_FLAGS_RSSI_ONCHANNEL;
+				}
+				if (dtoh32(bss->length) != bi_length) {
+					u32 prev_len = dtoh32(bss->length);
+
+					WL_SCAN(("bss info replacement"
+						" is occured(bcast:%d->probresp%d)\n",
+						bss->ie_length, bi->ie_length));
+					WL_DBG(("%s("MACDBG"), replacement!(%d -> %d)\n",
+					bss->SSID, MAC2STRDBG(bi->BSSID.octet),
+					prev_len, bi_length));
+
+					if (list->buflen - escan->stale_len - prev_len +
+						bi_length > ESCAN_BUF_SIZE) {
+						WL_ERR(("Buffer is too small: keep the"
+							" previous result of this AP\n"));
+						/* Only update RSSI */
+						bss->RSSI = bi->RSSI;
+						bss->flags |= (bi->flags
+							& WL_BSS_FLAGS_RSSI_ONCHANNEL);
+						return err;
+					}
+
+					/* Append the new copy, the old one is squeezed
+					 * out at scan completion (or when out of room)
+					 */
+					escan->bss[i].stale = 1;
+					escan->stale_len += prev_len;
+					wl_escan_add_bss(cfg, bi, hash);
+					return err;
+				}
+				list->version = dtoh32(bi->version);
+				memcpy((u8 *)bss, (u8 *)bi, bi_length);
+				return err;
+			}
+		}
+		if (wl_escan_add_bss(cfg, bi, hash) != BCME_OK) {
+			WL_ERR(("Buffer is too small: ignoring\n"));
+			return err;
+		}
+	}
+
+	return err;
+}
+
+static s32 wl_escan_handler(struct bcm_cfg80211 *cfg, bcm_struct_cfgdev *cfgdev,
+	const wl_event_msg_t *e, void *data)
+{
+	s32 err = BCME_OK;
+	s32 status = ntoh32(e->status);
+	wl_escan_result_t *escan_result;
+	struct net_device *ndev = NULL;
+
 	WL_DBG((" enter event type : %d, status : %d \n",
 		ntoh32(e->event_type), ntoh32(e->status)));
 
@@ -9263,164 +9522,21 @@ static s32 wl_escan_handler(struct bcm_cfg80211 *cfg, bcm_struct_cfgdev *cfgdev,
 	escan_result = (wl_escan_result_t *)data;
 
 	if (status == WLC_E_STATUS_PARTIAL) {
+		u32 datalen = ntoh32(e->datalen), off = 0, len;
+
 		WL_INFO(("WLC_E_STATUS_PARTIAL \n"));
 		if (!escan_result) {
 			WL_ERR(("Invalid escan result (NULL pointer)\n"));
 			goto exit;
 		}
-		if (dtoh16(escan_result->bss_count) != 1) {
-			WL_ERR(("Invalid bss_count %d: ignoring\n", escan_result->bss_count));
-			goto exit;
-		}
-		bi = escan_result->bss_info;
-		if (!bi) {
-			WL_ERR(("Invalid escan bss info (NULL pointer)\n"));
-			goto exit;
-		}
-		bi_length = dtoh32(bi->length);
-		if (bi_length != (dtoh32(escan_result->buflen) - WL_ESCAN_RESULTS_FIXED_SIZE)) {
-			WL_ERR(("Invalid bss_info length %d: ignoring\n", bi_length));
-			goto exit;
-		}
-		if (wl_escan_check_sync_id(status, escan_result->sync_id,
-			cfg->escan_info.cur_sync_id) < 0)
-			goto exit;
-
-		if (!(bcmcfg_to_wiphy(cfg)->interface_modes & BIT(NL80211_IFTYPE_ADHOC))) {
-			if (dtoh16(bi->capability) & DOT11_CAP_IBSS) {
-				WL_DBG(("Ignoring IBSS result\n"));
-				goto exit;
-			}
-		}
-
-		if (wl_get_drv_status_all(cfg, FINDING_COMMON_CHANNEL)) {
-			p2p_dev_addr = wl_cfgp2p_retreive_p2p_dev_addr(bi, bi_length);
-			if (p2p_dev_addr && !memcmp(p2p_dev_addr,
-				cfg->afx_hdl->tx_dst_addr.octet, ETHER_ADDR_LEN)) {
-				s32 channel = wf_chspec_ctlchan(
-					wl_chspec_driver_to_host(bi->chanspec));
-
-				if ((channel > MAXCHANNEL) || (channel <= 0))
-					channel = WL_INVALID;
-				else
-					WL_ERR(("ACTION FRAME SCAN : Peer " MACDBG " found,"
-						" channel : %d\n",
-						MAC2STRDBG(cfg->afx_hdl->tx_dst_addr.octet),
-						channel));
-
-				wl_clr_p2p_status(cfg, SCANNING);
-				cfg->afx_hdl->peer_chan = channel;
-				complete(&cfg->act_frm_scan);
-				goto exit;
-			}
-
-		} else {
-			int cur_len = WL_SCAN_RESULTS_FIXED_SIZE;
-			list = wl_escan_get_buf(cfg, FALSE);
-			if (scan_req_match(cfg)) {
-				/* p2p scan && allow only probe response */
-				if ((cfg->p2p->search_state != WL_P2P_DISC_ST_SCAN) &&
-					(bi->flags & WL_BSS_FLAGS_FROM_BEACON))
-					goto exit;
-				if ((p2p_ie = wl_cfgp2p_find_p2pie(((u8 *) bi) + bi->ie_offset,
-					bi->ie_length)) == NULL) {
-						WL_ERR(("Couldn't find P2PIE in probe"
-							" response/beacon\n"));
-						goto exit;
-				}
-			}
-			for (i = 0; i < list->count; i++) {
-				bss = bss ? (wl_bss_info_t *)((uintptr)bss + dtoh32(bss->length))
-					: list->bss_info;
-
-				if (!bcmp(&bi->BSSID, &bss->BSSID, ETHER_ADDR_LEN) &&
-					(CHSPEC_BAND(wl_chspec_driver_to_host(bi->chanspec))
-					== CHSPEC_BAND(wl_chspec_driver_to_host(bss->chanspec))) &&
-					bi->SSID_len == bss->SSID_len &&
-					!bcmp(bi->SSID, bss->SSID, bi->SSID_len)) {
-
-					/* do not allow beacon data to update
-					*the data recd from a probe response
-					*/
-					if (!(bss->flags & WL_BSS_FLAGS_FROM_BEACON) &&
-						(bi->flags & WL_BSS_FLAGS_FROM_BEACON))
-						goto exit;
-
-					WL_DBG(("%s("MACDBG"), i=%d prev: RSSI %d"
-						" flags 0x%x, new: RSSI %d flags 0x%x\n",
-						bss->SSID, MAC2STRDBG(bi->BSSID.octet), i,
-						bss->RSSI, bss->flags, bi->RSSI, bi->flags));
-
-					if ((bss->flags & WL_BSS_FLAGS_RSSI_ONCHANNEL) ==
-						(bi->flags & WL_BSS_FLAGS_RSSI_ONCHANNEL)) {
-						/* preserve max RSSI if the measurements are
-						* both on-channel or both off-channel
-						*/
-						WL_SCAN(("%s("MACDBG"), same onchan"
-						", RSSI: prev %d new %d\n",
-						bss->SSID, MAC2STRDBG(bi->BSSID.octet),
-						bss->RSSI, bi->RSSI));
-						bi->RSSI = MAX(bss->RSSI, bi->RSSI);
-					} else if ((bss->flags & WL_BSS_FLAGS_RSSI_ONCHANNEL) &&
-						(bi->flags & WL_BSS_FLAGS_RSSI_ONCHANNEL) == 0) {
-						/* preserve the on-channel rssi measurement
-						* if the new measurement is off channel
-						*/
-						WL_SCAN(("%s("MACDBG"), prev onchan"
-						", RSSI: prev %d new %d\n",
-						bss->SSID, MAC2STRDBG(bi->BSSID.octet),
-						bss->RSSI, bi->RSSI));
-						bi->RSSI = bss->RSSI;
-						bi->flags |= WL_BSS_FLAGS_RSSI_ONCHANNEL;
-					}
-					if (dtoh32(bss->length) != bi_length) {
-						u32 prev_len = dtoh32(bss->length);
-
-						WL_SCAN(("bss info replacement"
-							" is occured(bcast:%d->probresp%d)\n",
-							bss->ie_length, bi->ie_length));
-						WL_DBG(("%s("MACDBG"), replacement!(%d -> %d)\n",
-						bss->SSID, MAC2STRDBG(bi->BSSID.octet),
-						prev_len, bi_length));
-
-						if (list->buflen - prev_len + bi_length
-							> ESCAN_BUF_SIZE) {
-							WL_ERR(("Buffer is too small: keep the"
-								" previous result of this AP\n"));
-							/* Only update RSSI */
-							bss->RSSI = bi->RSSI;
-							bss->flags |= (bi->flags
-								& WL_BSS_FLAGS_RSSI_ONCHANNEL);
-							goto exit;
-						}
-
-						if (i < list->count - 1) {
-							/* memory copy required by this case only */
-							memmove((u8 *)bss + bi_length,
-								(u8 *)bss + prev_len,
-								list->buflen - cur_len - prev_len);
-						}
-						list->buflen -= prev_len;
-						list->buflen += bi_length;
-					}
-					list->version = dtoh32(bi->version);
-					memcpy((u8 *)bss, (u8 *)bi, bi_length);
-					goto exit;
-				}
-				cur_len += dtoh32(bss->length);
-			}
-			if (bi_length > ESCAN_BUF_SIZE - list->buflen) {
-				WL_ERR(("Buffer is too small: ignoring\n"));
-				goto exit;
-			}
-
-			memcpy(&(((char *)list)[list->buflen]), bi, bi_length);
-			list->version = dtoh32(bi->version);
-			list->buflen += bi_length;
-			list->count++;
-
-		}
-
+		/* wl_enq_escan_result may have queued several results back to back */
+		do {
+			escan_result = (wl_escan_result_t *)((u8 *)data + off);
+			len = dtoh32(escan_result->buflen);
+			wl_escan_partial_result(cfg, escan_result);
+			off += ROUNDUP(len, 4);
+		} while ((len >= WL_ESCAN_RESULTS_FIXED_SIZE) &&
+			(off + WL_ESCAN_RESULTS_FIXED_SIZE <= datalen));
 	}
 	else if (status == WLC_E_STATUS_SUCCESS) {
 		cfg->escan_info.escan_state = WL_ESCAN_STATE_IDLE;
@@ -9716,6 +9832,7 @@ static s32 wl_init_scan(struct bcm_cfg80211 *cfg)
 	cfg->evt_handler[WLC_E_ESCAN_RESULT] = wl_escan_handler;
 	cfg->escan_info.escan_state = WL_ESCAN_STATE_IDLE;
 	wl_escan_init_sync_id(cfg);
+	wl_escan_reset_buf(cfg);
 
 	/* Init scan_timeout timer */
 	init_timer(&cfg->scan_timeout);
@@ -9773,6 +9890,7 @@ static void wl_deinit_priv(struct bcm_cfg80211 *cfg)
 	DNGL_FUNC(dhd_cfg80211_deinit, (cfg));
 	wl_destroy_event_handler(cfg);
 	wl_flush_eq(cfg);
+	wl_deinit_eq(cfg);
 	wl_link_down(cfg);
 	del_timer_sync(&cfg->scan_timeout);
 	wl_deinit_priv_mem(cfg);
@@ -10071,8 +10189,11 @@ static s32 wl_event_handler(void *data)
 	struct wl_event_q *e;
 	tsk_ctl_t *tsk = (tsk_ctl_t *)data;
 	bcm_struct_cfgdev *cfgdev = NULL;
+	struct list_head batch;
+	u32 start;
 
 	cfg = (struct bcm_cfg80211 *)tsk->parent;
+	INIT_LIST_HEAD(&batch);
 
 	WL_ERR(("tsk Enter, tsk = 0x%p\n", tsk));
 
@@ -10080,7 +10201,7 @@ static s32 wl_event_handler(void *data)
 		SMP_RD_BARRIER_DEPENDS();
 		if (tsk->terminated)
 			break;
-		while ((e = wl_deq_event(cfg))) {
+		while ((e = wl_deq_event(cfg, &batch))) {
 			WL_DBG(("event type (%d), if idx: %d\n", e->etype, e->emsg.ifidx));
 			/* All P2P device address related events comes on primary interface since
 			 * there is no corresponding bsscfg for P2P interface. Map it to p2p0
@@ -10113,11 +10234,20 @@ static s32 wl_event_handler(void *data)
 #endif /* WL_CFG80211_P2P_DEV_IF */
 			}
 			if (e->etype < WLC_E_LAST && cfg->evt_handler[e->etype]) {
+				struct wl_evt_stat *st = &cfg->evt_stat[e->etype];
+
+				start = OSL_SYSUPTIME_US();
 				cfg->evt_handler[e->etype] (cfg, cfgdev, &e->emsg, e->edata);
+				start = OSL_SYSUPTIME_US() - start;
+				st->cnt++;
+				st->total_us += start;
+				if (start > st->max_us)
+					st->max_us = start;
+				dhd_event_stat_done((dhd_pub_t *)(cfg->pub), e->etype, e->rx_us);
 			} else {
 				WL_DBG(("Unknown Event (%d): ignoring\n", e->etype));
 			}
-			wl_put_event(e);
+			wl_put_event(cfg, e);
 		}
 		DHD_OS_WAKE_UNLOCK(cfg->pub);
 	}
@@ -10164,6 +10294,15 @@ wl_cfg80211_event(struct net_device *ndev, const wl_event_msg_t * e, void *data)
 		WL_DBG((" PNOEVENT: PNO_NET_LOST\n"));
 	}
 
+	if (event_type == WLC_E_ESCAN_RESULT) {
+		s32 ret = wl_enq_escan_result(cfg, e, data);
+
+		if (ret == 0)
+			wl_wakeup_event(cfg);
+		if (ret != -EINVAL)
+			return;
+	}
+
 	if (likely(!wl_enq_event(cfg, ndev, event_type, e, data)))
 		wl_wakeup_event(cfg);
 }
@@ -10172,6 +10311,40 @@ static void wl_init_eq(struct bcm_cfg80211 *cfg)
 {
 	wl_init_eq_lock(cfg);
 	INIT_LIST_HEAD(&cfg->eq_list);
+	cfg->evq_rate_start = jiffies;
+
+	/* Without the pool every event is kzalloc'd */
+	cfg->evq_cache = kmem_cache_create("wl_event_q",
+		sizeof(struct wl_event_q) + WL_EVQ_INLINE_LEN, 0, 0, NULL);
+	if (cfg->evq_cache)
+		cfg->evq_pool = mempool_create_slab_pool(WL_EVQ_POOL_MIN, cfg->evq_cache);
+	if (!cfg->evq_pool)
+		WL_ERR(("event pool alloc failed\n"));
+
+	/* Escan results are merged into entries of a fixed, larger size */
+	cfg->evq_escan_cache = kmem_cache_create("wl_event_q_escan",
+		WL_ESCAN_COALESCE_SIZE, 0, 0, NULL);
+	if (cfg->evq_escan_cache)
+		cfg->evq_escan_pool = mempool_create_slab_pool(WL_EVQ_ESCAN_POOL_MIN,
+			cfg->evq_escan_cache);
+	if (!cfg->evq_escan_pool)
+		WL_ERR(("escan event pool alloc failed\n"));
+}
+
+static void wl_deinit_eq(struct bcm_cfg80211 *cfg)
+{
+	if (cfg->evq_pool)
+		mempool_destroy(cfg->evq_pool);
+	cfg->evq_pool = NULL;
+	if (cfg->evq_cache)
+		kmem_cache_destroy(cfg->evq_cache);
+	cfg->evq_cache = NULL;
+	if (cfg->evq_escan_pool)
+		mempool_destroy(cfg->evq_escan_pool);
+	cfg->evq_escan_pool = NULL;
+	if (cfg->evq_escan_cache)
+		kmem_cache_destroy(cfg->evq_escan_cache);
+	cfg->evq_escan_cache = NULL;
 }
 
 static void wl_flush_eq(struct bcm_cfg80211 *cfg)
@@ -10183,30 +10356,49 @@ static void wl_flush_eq(struct bcm_cfg80211 *cfg)
 	while (!list_empty(&cfg->eq_list)) {
 		e = list_first_entry(&cfg->eq_list, struct wl_event_q, eq_list);
 		list_del(&e->eq_list);
-		kfree(e);
+		wl_put_event(cfg, e);
 	}
 	wl_unlock_eq(cfg, flags);
 }
 
 /*
-* retrieve first queued event from head
+* retrieve first queued event from head. The whole queue is moved to batch
+* under one lock hold and handed out from there.
 */
 
-static struct wl_event_q *wl_deq_event(struct bcm_cfg80211 *cfg)
+static struct wl_event_q *wl_deq_event(struct bcm_cfg80211 *cfg, struct list_head *batch)
 {
 	struct wl_event_q *e = NULL;
 	unsigned long flags;
 
-	flags = wl_lock_eq(cfg);
-	if (likely(!list_empty(&cfg->eq_list))) {
-		e = list_first_entry(&cfg->eq_list, struct wl_event_q, eq_list);
+	if (list_empty(batch)) {
+		flags = wl_lock_eq(cfg);
+		if (likely(!list_empty(&cfg->eq_list))) {
+			list_splice_init(&cfg->eq_list, batch);
+			cfg->evq_batches++;
+		}
+		wl_unlock_eq(cfg, flags);
+	}
+	if (likely(!list_empty(batch))) {
+		e = list_first_entry(batch, struct wl_event_q, eq_list);
 		list_del(&e->eq_list);
 	}
-	wl_unlock_eq(cfg, flags);
 
 	return e;
 }
 
+/* Queue counters, called with eq_lock held */
+static void wl_evq_count(struct bcm_cfg80211 *cfg)
+{
+	cfg->evq_enq++;
+	cfg->evq_rate_cnt++;
+	if (time_after(jiffies, cfg->evq_rate_start + HZ)) {
+		cfg->evq_rate = cfg->evq_rate_cnt * HZ / (jiffies - cfg->evq_rate_start);
+		cfg->evq_rate_cnt = 0;
+		cfg->evq_rate_start = jiffies;
+	}
+}
+
 /*
  * push event to tail of the queue
  */
@@ -10226,26 +10418,118 @@ wl_enq_event(struct bcm_cfg80211 *cfg, struct net_device *ndev, u32 event,
 	if (data)
 		data_len = ntoh32(msg->datalen);
 	evtq_size = sizeof(struct wl_event_q) + data_len;
-	aflags = (in_atomic()) ? GFP_ATOMIC : GFP_KERNEL;
-	e = kzalloc(evtq_size, aflags);
+	if ((data_len <= WL_EVQ_INLINE_LEN) && cfg->evq_pool &&
+		(e = mempool_alloc(cfg->evq_pool, GFP_ATOMIC))) {
+		memset(e, 0, sizeof(struct wl_event_q));
+		e->pool = cfg->evq_pool;
+	} else {
+		aflags = (in_atomic()) ? GFP_ATOMIC : GFP_KERNEL;
+		e = kzalloc(evtq_size, aflags);
+	}
 	if (unlikely(!e)) {
 		WL_ERR(("event alloc failed\n"));
+		cfg->evq_drop++;
 		return -ENOMEM;
 	}
 	e->etype = event;
+	e->rx_us = ((dhd_pub_t *)(cfg->pub))->evt_rx_us;
 	memcpy(&e->emsg, msg, sizeof(wl_event_msg_t));
 	if (data)
 		memcpy(e->edata, data, data_len);
 	flags = wl_lock_eq(cfg);
 	list_add_tail(&e->eq_list, &cfg->eq_list);
+	wl_evq_count(cfg);
 	wl_unlock_eq(cfg, flags);
 
 	return err;
 }
 
-static void wl_put_event(struct wl_event_q *e)
+/*
+ * Partial escan results are appended to the escan entry at the queue tail when
+ * it is from the same scan and has room, so a burst of results costs one
+ * wakeup and one wl_escan_handler pass. Each result is padded to 4 bytes and
+ * emsg.datalen covers all of them. Returns 1 if merged, 0 if queued as a new
+ * entry, -EINVAL if this is not a partial result that can be merged.
+ */
+static s32
+wl_enq_escan_result(struct bcm_cfg80211 *cfg, const wl_event_msg_t *msg, void *data)
 {
-	kfree(e);
+	wl_escan_result_t *escan_result = (wl_escan_result_t *)data;
+	struct wl_event_q *e;
+	mempool_t *pool = NULL;
+	u32 len, rlen, used, size;
+	unsigned long flags;
+	gfp_t aflags;
+
+	if (!data || (ntoh32(msg->status) != WLC_E_STATUS_PARTIAL))
+		return -EINVAL;
+	len = dtoh32(escan_result->buflen);
+	if ((len < WL_ESCAN_RESULTS_FIXED_SIZE) || (len > ntoh32(msg->datalen)))
+		return -EINVAL;
+	rlen = ROUNDUP(len, 4);
+
+	flags = wl_lock_eq(cfg);
+	if (!list_empty(&cfg->eq_list)) {
+		e = list_entry(cfg->eq_list.prev, struct wl_event_q, eq_list);
+		used = ntoh32(e->emsg.datalen);
+		if (e->ecap && (e->ecount < WL_ESCAN_COALESCE_MAX) &&
+			(used + rlen <= e->ecap) &&
+			(e->emsg.ifidx == msg->ifidx) &&
+			(e->emsg.bsscfgidx == msg->bsscfgidx) &&
+			(((wl_escan_result_t *)e->edata)->sync_id == escan_result->sync_id)) {
+			memcpy(e->edata + used, data, len);
+			e->emsg.datalen = hton32(used + rlen);
+			e->ecount++;
+			cfg->evq_merged++;
+			wl_evq_count(cfg);
+			wl_unlock_eq(cfg, flags);
+			return 1;
+		}
+	}
+	wl_unlock_eq(cfg, flags);
+
+	/* Room for more results from the escan pool, or just this one when
+	 * the result is too big for it or the pool is dry
+	 */
+	size = WL_ESCAN_COALESCE_SIZE;
+	e = NULL;
+	if ((size >= OFFSETOF(struct wl_event_q, edata) + rlen) && cfg->evq_escan_pool &&
+		(e = mempool_alloc(cfg->evq_escan_pool, GFP_ATOMIC)))
+		pool = cfg->evq_escan_pool;
+	if (!e) {
+		aflags = (in_atomic()) ? GFP_ATOMIC : GFP_KERNEL;
+		size = OFFSETOF(struct wl_event_q, edata) + rlen;
+		e = kmalloc(size, aflags);
+	}
+	if (unlikely(!e)) {
+		WL_ERR(("event alloc failed\n"));
+		cfg->evq_drop++;
+		return -ENOMEM;
+	}
+	memset(e, 0, sizeof(struct wl_event_q));
+	e->pool = pool;
+	e->etype = WLC_E_ESCAN_RESULT;
+	e->ecap = size - OFFSETOF(struct wl_event_q, edata);
+	e->ecount = 1;
+	e->rx_us = ((dhd_pub_t *)(cfg->pub))->evt_rx_us;
+	memcpy(&e->emsg, msg, sizeof(wl_event_msg_t));
+	e->emsg.datalen = hton32(rlen);
+	memcpy(e->edata, data, len);
+
+	flags = wl_lock_eq(cfg);
+	list_add_tail(&e->eq_list, &cfg->eq_list);
+	wl_evq_count(cfg);
+	wl_unlock_eq(cfg, flags);
+
+	return 0;
+}
+
+static void wl_put_event(struct bcm_cfg80211 *cfg, struct wl_event_q *e)
+{
+	if (e->pool)
+		mempool_free(e, e->pool);
+	else
+		kfree(e);
 }
 
 static s32 wl_config_ifmode(struct bcm_cfg80211 *cfg, struct net_device *ndev, s32 iftype)
@@ -11805,6 +12089,46 @@ static const struct file_operations fops_debuglevel = {
 	.llseek = NULL,
 };
 
+/* cat /sys/kernel/debug/dhd/event_stats : event queue counters and handler time per event */
+static ssize_t
+wl_event_stats_read(struct file *file, char __user *user_buf,
+	size_t count, loff_t *ppos)
+{
+	struct bcm_cfg80211 *cfg = g_bcm_cfg;
+	struct wl_evt_stat *st;
+	size_t size = 128 + WLC_E_LAST * 48;
+	char *tbuf;
+	int len, i;
+	ssize_t ret;
+
+	if (!cfg)
+		return -EINVAL;
+	if (!(tbuf = kmalloc(size, GFP_KERNEL)))
+		return -ENOMEM;
+
+	len = snprintf(tbuf, size, "queued %u merged %u dropped %u batches %u rate %u/s\n"
+		"event count avg_us max_us\n", cfg->evq_enq, cfg->evq_merged,
+		cfg->evq_drop, cfg->evq_batches, cfg->evq_rate);
+	for (i = 0; i < WLC_E_LAST; i++) {
+		st = &cfg->evt_stat[i];
+		if (st->cnt == 0)
+			continue;
+		len += snprintf(tbuf + len, size - len, "%d %u %u %u\n", i, st->cnt,
+			(u32)div_u64(st->total_us, st->cnt), st->max_us);
+	}
+
+	ret = simple_read_from_buffer(user_buf, count, ppos, tbuf, len);
+	kfree(tbuf);
+	return ret;
+}
+
+static const struct file_operations fops_event_stats = {
+	.open = NULL,
+	.read = wl_event_stats_read,
+	.owner = THIS_MODULE,
+	.llseek = NULL,
+};
+
 static s32 wl_setup_debugfs(struct bcm_cfg80211 *cfg)
 {
 	s32 err = 0;
@@ -11826,7 +12150,12 @@ static s32 wl_setup_debugfs(struct bcm_cfg80211 *cfg)
 	if (!_dentry || IS_ERR(_dentry)) {
 		WL_ERR(("failed to create debug_level debug file\n"));
 		wl_free_debugfs(cfg);
+		goto exit;
 	}
+	_dentry = debugfs_create_file("event_stats", S_IRUSR,
+		cfg->debugfs, cfg, &fops_event_stats);
+	if (!_dentry || IS_ERR(_dentry))
+		WL_ERR(("failed to create event_stats debug file\n"));
 exit:
 	return err;
 }
@@ -34,6 +34,7 @@
 #include <linux/wireless.h>
 #include <net/cfg80211.h>
 #include <linux/rfkill.h>
+#include <linux/mempool.h>
 
 #include <wl_cfgp2p.h>
 
@@ -302,10 +303,30 @@ struct wl_ie {
 struct wl_event_q {
 	struct list_head eq_list;
 	u32 etype;
+	mempool_t *pool;	/* evq_pool or evq_escan_pool, NULL if kmalloc'd */
+	u16 ecount;		/* escan results merged into edata */
+	u32 ecap;		/* room in edata for merging escan results, 0 = none */
+	u32 rx_us;		/* dhd_pub evt_rx_us when queued */
 	wl_event_msg_t emsg;
 	s8 edata[1];
 };
 
+/* Event data up to this size is carried in a slab entry from evq_pool */
+#define WL_EVQ_INLINE_LEN	512
+#define WL_EVQ_POOL_MIN		16	/* entries held in reserve for atomic enqueue */
+
+/* Partial escan results merged into one queue entry, see wl_enq_escan_result */
+#define WL_ESCAN_COALESCE_SIZE	4096	/* entry size including header */
+#define WL_ESCAN_COALESCE_MAX	16
+#define WL_EVQ_ESCAN_POOL_MIN	4	/* WL_ESCAN_COALESCE_SIZE entries held in reserve */
+
+/* Handler time per event type */
+struct wl_evt_stat {
+	u32 cnt;
+	u32 max_us;
+	u64 total_us;
+};
+
 /* security information with currently associated ap */
 struct wl_security {
 	u32 wpa_versions;
@@ -384,6 +405,16 @@ struct wl_pmk_list {
 
 
 #define ESCAN_BUF_SIZE (64 * 1024)
+#define ESCAN_BSS_HASH_SIZE	64	/* Buckets of the BSSID+SSID index of escan_buf */
+#define ESCAN_BSS_MAX		512	/* bss_info kept in escan_buf, stale ones included */
+#define ESCAN_BSS_NONE		0xffff
+
+/* Index entry of one bss_info in escan_buf, entries are in escan_buf order */
+struct escan_bss {
+	u32 offset;	/* from the start of escan_buf */
+	u16 next;	/* next entry in the same hash bucket */
+	u16 stale;	/* superseded by a copy appended later */
+};
 
 struct escan_info {
 	u32 escan_state;
@@ -395,6 +426,10 @@ struct escan_info {
 #else
 	u8 escan_buf[ESCAN_BUF_SIZE];
 #endif /* STATIC_WL_PRIV_STRUCT */
+	struct escan_bss bss[ESCAN_BSS_MAX];
+	u16 bss_hash[ESCAN_BSS_HASH_SIZE];	/* First entry of each bucket */
+	u16 bss_cnt;		/* Entries used in bss[] */
+	u32 stale_len;		/* Bytes of stale bss_info in escan_buf */
 	struct wiphy *wiphy;
 	struct net_device *ndev;
 };
@@ -480,6 +515,18 @@ struct bcm_cfg80211 {
 	struct cfg80211_scan_request *scan_request;	/* scan request object */
 	EVENT_HANDLER evt_handler[WLC_E_LAST];
 	struct list_head eq_list;	/* used for event queue */
+	struct kmem_cache *evq_cache;	/* event queue entries with inline data */
+	mempool_t *evq_pool;
+	struct kmem_cache *evq_escan_cache;	/* WL_ESCAN_COALESCE_SIZE entries */
+	mempool_t *evq_escan_pool;
+	u32 evq_enq;		/* events queued */
+	u32 evq_drop;		/* events dropped for lack of memory */
+	u32 evq_merged;		/* escan results appended to a queued entry */
+	u32 evq_batches;	/* queue splices taken by the event handler */
+	u32 evq_rate;		/* events/s over the last window of a second or more */
+	u32 evq_rate_cnt;
+	unsigned long evq_rate_start;	/* jiffies */
+	struct wl_evt_stat evt_stat[WLC_E_LAST];
 	struct list_head net_list;     /* used for struct net_info */
 	spinlock_t eq_lock;	/* for event queue synchronization */
 	spinlock_t cfgdrv_lock;	/* to protect scan status (and others if needed) */
@@ -913,7 +960,7 @@ extern void wl_cfg80211_update_power_mode(struct net_device *dev);
 #define WL_SCANTYPE_P2P		0x2
 #define wl_escan_set_sync_id(a, b) ((a) = htod16(0x1234))
 #define wl_escan_set_type(a, b)
-#define wl_escan_get_buf(a, b) ((wl_scan_results_t *) (a)->escan_info.escan_buf)
+#define wl_escan_get_buf(a, b) wl_escan_get_results(a)
 #define wl_escan_check_sync_id(a, b, c) 0
 #define wl_escan_print_sync_id(a, b, c)
 #define wl_escan_increment_sync_id(a, b)